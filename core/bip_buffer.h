@@ -0,0 +1,189 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ *
+ * This file implements a bip-buffer
+ * (https://www.codeproject.com/articles/3479/the-bip-buffer-the-circular-buffer-with-a-twist)
+ * as single producer / single consumer FIFO. In contrast to DmaFifo, a reservation never wraps
+ * around the end of the buffer: if it doesn't fit behind the written data, it is placed at the
+ * beginning of the buffer and the end of the valid data is marked by a watermark. Thus, the
+ * producer can write directly into the buffer and the consumer always gets the biggest contiguous
+ * range of data, which can be processed by a single DMA transfer.
+ *
+ * Producer-functions:
+ * - reserve()
+ * - commit()
+ * - put_range()
+ *
+ * Consumer functions:
+ * - peek_range()
+ * - drop_range()
+ * - drop()
+ *
+ * Functions for both:
+ * - used()
+ * - is_empty()
+ *
+ * The write-index and the watermark are only written by the producer, the read-index only by the
+ * consumer. All of them are published with release-stores and read with acquire-loads.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <expected>
+#include <span>
+
+#include "err.h"
+#include "libc.h"
+
+template<typename T, size_t N>
+class BipBuffer {
+public:
+    static_assert(N > 1, "N must be bigger than 1");
+
+    constexpr explicit BipBuffer() noexcept
+        : buf(), res_start(0), res_len(0), res_wrapped(false), range_len(0), write(0), read(0),
+        last(N) {}
+    constexpr ~BipBuffer() noexcept {}
+
+    // Must only be called from the producer! Reserves a contiguous range of len elements, which
+    // is only visible to the consumer after calling commit(). A previous reservation which wasn't
+    // committed is discarded.
+    std::expected<std::span<T>, Err> reserve(size_t len) noexcept
+    {
+        size_t w = write.load(std::memory_order::relaxed);
+        size_t r = read.load(std::memory_order::acquire);
+
+        if (len == 0)
+            return std::unexpected{Err::OutOfRange};
+
+        res_wrapped = false;
+        if (w >= r) {
+            if ((N - w) >= len) {
+                res_start = w;
+            } else if (r > len) {
+                // Doesn't fit behind the data anymore -> start at the beginning of the buffer. The
+                // write-index must not reach the read-index, otherwise the buffer would look empty.
+                res_start = 0;
+                res_wrapped = true;
+            } else {
+                res_len = 0;
+                return std::unexpected{Err::NoMem};
+            }
+        } else if ((r - w) > len) {
+            res_start = w;
+        } else {
+            res_len = 0;
+            return std::unexpected{Err::NoMem};
+        }
+
+        res_len = len;
+        return std::expected<std::span<T>, Err>{std::span<T>{&buf[res_start], len}};
+    }
+
+    // Must only be called from the producer! Makes the first len elements of the reservation
+    // visible to the consumer, len may be smaller than the reserved size.
+    Err commit(size_t len) noexcept
+    {
+        if (len > res_len)
+            return Err::OutOfRange;
+
+        if (len == 0) {
+            res_len = 0;
+            return Err::Ok;
+        }
+
+        // the watermark has to be visible before the wrapped write-index
+        if (res_wrapped)
+            last.store(write.load(std::memory_order::relaxed), std::memory_order::release);
+
+        write.store(res_start + len, std::memory_order::release);
+        res_len = 0;
+        return Err::Ok;
+    }
+
+    // must only be called from the producer!
+    Err put_range(std::span<const T> data) noexcept
+    {
+        std::expected<std::span<T>, Err> res = reserve(data.size());
+
+        if (!res.has_value())
+            return res.error();
+
+        libc::memcpy(res.value().data(), data.data(), data.size() * sizeof(T));
+        return commit(data.size());
+    }
+
+    // Must only be called from the consumer! Returns the biggest contiguous range of stored data.
+    std::expected<std::span<T>, Err> peek_range() noexcept
+    {
+        size_t w = write.load(std::memory_order::acquire);
+        size_t r = read.load(std::memory_order::relaxed);
+        size_t end = w;
+
+        if (w < r) {
+            end = last.load(std::memory_order::acquire);
+            if (r == end) {
+                // everything up to the watermark was read, continue at the beginning
+                r = 0;
+                end = w;
+                read.store(0, std::memory_order::release);
+            }
+        }
+
+        range_len = end - r;
+        if (range_len == 0)
+            return std::unexpected{Err::Empty};
+
+        return std::expected<std::span<T>, Err>{std::span<T>{&buf[r], range_len}};
+    }
+
+    // must only be called from the consumer!
+    void drop_range() noexcept { drop(range_len); }
+
+    // Must only be called from the consumer! Drops the first len elements of the range returned by
+    // peek_range().
+    Err drop(size_t len) noexcept
+    {
+        if (len > range_len)
+            return Err::OutOfRange;
+
+        range_len -= len;
+        read.store(read.load(std::memory_order::relaxed) + len, std::memory_order::release);
+        return Err::Ok;
+    }
+
+    inline bool is_empty() const noexcept { return used() == 0; }
+    inline size_t used() const noexcept
+    {
+        size_t r = read.load(std::memory_order::acquire);
+        size_t w = write.load(std::memory_order::acquire);
+
+        if (w >= r)
+            return w - r;
+        else
+            return last.load(std::memory_order::acquire) - r + w;
+    }
+
+    constexpr size_t size() const noexcept { return N; }
+
+private:
+    std::array<T, N> buf;
+
+    // producer only
+    size_t res_start;
+    size_t res_len;
+    bool res_wrapped;
+
+    // consumer only
+    size_t range_len;
+
+    std::atomic<size_t> write;
+    std::atomic<size_t> read;
+    std::atomic<size_t> last; // end of the valid data if the write-index wrapped around
+};
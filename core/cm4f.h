@@ -7,11 +7,24 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
+#ifdef HOST_SIM
+// The host simulation (see sim/sim.h) emulates PRIMASK, WFI and the FPSCR register.
+namespace sim {
+uint32_t set_primask(uint32_t primask) noexcept;
+void wait_for_interrupt() noexcept;
+uint32_t& fpscr() noexcept;
+}
+#endif
+
 namespace cm4f {
 inline uint32_t get_fpscr(void) noexcept
 {
+#ifdef HOST_SIM
+    return sim::fpscr();
+#else
     uint32_t ret;
     __asm__ __volatile__(
         "VMRS %0, fpscr"
@@ -19,18 +32,86 @@ inline uint32_t get_fpscr(void) noexcept
         ::);
 
     return ret;
+#endif
 }
 
 inline void set_fpscr(uint32_t val) noexcept
 {
+#ifdef HOST_SIM
+    sim::fpscr() = val;
+#else
     __asm__ __volatile__(
         "VMSR fpscr, %0"
         :: "r" (val)
         :  "vfpcc");
+#endif
+}
+
+// disables all interrupts and returns the previous value of PRIMASK which has to be passed to
+// restore_irq() afterwards, this allows nesting of critical sections
+inline uint32_t disable_irq(void) noexcept
+{
+#ifdef HOST_SIM
+    return sim::set_primask(1);
+#else
+    uint32_t primask;
+    __asm__ __volatile__(
+        "MRS %0, primask\n"
+        "CPSID i"
+        : "=r" (primask)
+        :: "memory");
+
+    return primask;
+#endif
+}
+
+inline void restore_irq(uint32_t primask) noexcept
+{
+#ifdef HOST_SIM
+    sim::set_primask(primask);
+#else
+    __asm__ __volatile__(
+        "MSR primask, %0"
+        :: "r" (primask)
+        : "memory");
+#endif
+}
+
+inline void enable_irq(void) noexcept
+{
+#ifdef HOST_SIM
+    sim::set_primask(0);
+#else
+    __asm__ __volatile__("CPSIE i" ::: "memory");
+#endif
+}
+
+// sleeps until an interrupt is pending, this also works if the interrupts are disabled by PRIMASK
+inline void wait_for_interrupt(void) noexcept
+{
+#ifdef HOST_SIM
+    sim::wait_for_interrupt();
+#else
+    __asm__ __volatile__("WFI" ::: "memory");
+#endif
+}
+
+// Returns the address of the bit-band alias of a bit within the peripheral region. Writing 0 or 1
+// to the alias clears or sets the bit by a read-modify-write which the bus performs atomically,
+// thus the other bits of the register (e.g. flags set by the hardware meanwhile) are preserved.
+constexpr uintptr_t bitband(uintptr_t addr, size_t bit) noexcept
+{
+    constexpr uintptr_t PERIPH_BASE = 0x40000000;
+    constexpr uintptr_t PERIPH_BITBAND_BASE = 0x42000000;
+
+    return PERIPH_BITBAND_BASE + (addr - PERIPH_BASE) * 32 + bit * 4;
 }
 
 inline float sqrt(float val) noexcept
 {
+#ifdef HOST_SIM
+    return __builtin_sqrtf(val);
+#else
     __asm__ __volatile__(
         "VSQRT.f32 %0, %1"
         : "=t" (val)
@@ -38,5 +119,6 @@ inline float sqrt(float val) noexcept
         :);
 
     return val;
+#endif
 }
 }
@@ -9,8 +9,10 @@ CORE_DIR = $(ROOT)/core
 
 INCLUDES += $(CORE_DIR)
 
-SRCS += $(CORE_DIR)/libc.cpp
+SRCS_NOLTO += $(CORE_DIR)/cm4f.cpp
 
-SRCS_NOLTO += \
-	$(CORE_DIR)/libc_no_lto.cpp \
-	$(CORE_DIR)/cm4f.cpp
+# the host simulation uses the libc of the host
+ifneq ($(HOST_SIM),1)
+SRCS += $(CORE_DIR)/libc.cpp
+SRCS_NOLTO += $(CORE_DIR)/libc_no_lto.cpp
+endif
@@ -99,6 +99,30 @@ public:
         }
     }
 
+    // Must only be called from the consumer! Returns all the stored data at once. If the data wraps
+    // around the end of the buffer, the 2nd range contains the part at the beginning of the buffer,
+    // otherwise it is empty. drop_range() drops both ranges.
+    std::expected<std::array<std::span<T>, 2>, Err> peek_ranges() noexcept
+    {
+        size_t h;
+        size_t t;
+
+        if (is_empty())
+            return std::unexpected{Err::Empty};
+
+        h = head.load(std::memory_order::seq_cst);
+        t = tail.load(std::memory_order::seq_cst);
+
+        range_end = h;
+        if (h > t) {
+            return std::expected<std::array<std::span<T>, 2>, Err>{
+                std::array<std::span<T>, 2>{std::span<T>{&buf[t], h - t}, std::span<T>{}}};
+        } else {
+            return std::expected<std::array<std::span<T>, 2>, Err>{
+                std::array<std::span<T>, 2>{std::span<T>{&buf[t], N - t}, std::span<T>{&buf[0], h}}};
+        }
+    }
+
     // must only be called from the consumer!
     void drop_range() noexcept { tail.store(range_end, std::memory_order::seq_cst); }
 
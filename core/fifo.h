@@ -4,14 +4,18 @@
  * Created by lebakassemmerl 2022
  * E-Mail: hotschi@gmx.at
  * 
- * This file implements a single producer / single consumer FIFO in form of a ringbuffer. Intended
- * usage is for example a queue within a bus-driver (e.g. SPI). It is designed with a lockfree
- * approach but I am ABSOLUTELY NOT SURE if there aren't any bugs inside (probably there are).
- * However was tested with the test test/test_fifo.cpp. If it is used in a different way than
- * intended, it probably will result in undefined behavior!
+ * This file implements a wait-free single producer / single consumer FIFO in form of a ringbuffer.
+ * Intended usage is for example a queue within a bus-driver (e.g. SPI) or between an interrupt
+ * and the main loop. The head-index is only written by the producer, the tail-index only by the
+ * consumer, thus no read-modify-write operations are needed: each side publishes its index with a
+ * release-store and reads the index of the other side with an acquire-load. Both indices are
+ * free-running and only masked when accessing the buffer, thus all N slots are usable. It was
+ * tested with the test test/test_fifo.cpp. If it is used in a different way than intended, it
+ * probably will result in undefined behavior!
  * 
  * Producer-functions:
  * - push()
+ * - push_n()
  * - emplace()
  * 
  * Consumer functions:
@@ -19,6 +23,7 @@
  * - peek_ref()
  * - pop_elem()
  * - pop()
+ * - pop_n()
  * 
  * Functions for both:
  * - used()
@@ -29,12 +34,13 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <atomic>
-#include <bitset>
 #include <expected>
 #include <functional>
 #include <cstddef>
+#include <span>
 #include <utility>
 
 #include "err.h"
@@ -45,168 +51,132 @@ class Fifo {
 public:
     static_assert(hlp::is_powerof2<N>(), "N must be power of 2");
 
-    constexpr explicit Fifo() noexcept : buf(), ready(), head(0), tail(0) {}
+    constexpr explicit Fifo() noexcept : buf(), head(0), tail(0) {}
     constexpr ~Fifo() noexcept {}
 
     Err push(const T& val) noexcept
     {
-        size_t idx;
+        size_t h = head.load(std::memory_order::relaxed);
 
-        if (is_full())
+        if ((h - tail.load(std::memory_order::acquire)) == N)
             return Err::NoMem;
 
-        // 1st, we increment the head-index in order to reserve space within the FIFO
-        idx = fetch_add(head, 1);
-
-        // after reserving the space, we actually copy the data
-        buf[idx] = val;
-
-        // when the copying is done, we mark the slot as ready
-        ready[idx];
+        buf[h & MASK] = val;
 
+        // publish the element after it was copied
+        head.store(h + 1, std::memory_order::release);
         return Err::Ok;
     }
 
     template<typename... Args>
     Err emplace(Args&&... args) noexcept
     {
-        size_t idx;
+        size_t h = head.load(std::memory_order::relaxed);
 
-        if (is_full())
+        if ((h - tail.load(std::memory_order::acquire)) == N)
             return Err::NoMem;
 
-        // 1st, we increment the head-index in order to reserve space within the FIFO
-        idx = fetch_add(head, 1);
-    
-        // same explaination as in push()
-        new(&buf[idx]) T{std::forward<Args>(args)...};
-        
-        // when the copying is done, we mark the slot as ready
-        ready[idx] = true;
+        new(&buf[h & MASK]) T{std::forward<Args>(args)...};
 
+        head.store(h + 1, std::memory_order::release);
         return Err::Ok;
     }
 
+    // pushes as many elements as fit into the FIFO and returns the number of pushed elements
+    size_t push_n(std::span<const T> vals) noexcept
+    {
+        size_t h = head.load(std::memory_order::relaxed);
+        size_t cnt = std::min(vals.size(), N - (h - tail.load(std::memory_order::acquire)));
+
+        for (size_t i = 0; i < cnt; i++)
+            buf[(h + i) & MASK] = vals[i];
+
+        // all the elements are published at once
+        head.store(h + cnt, std::memory_order::release);
+        return cnt;
+    }
+
     std::expected<T, Err> peek() noexcept
     {
-        if (!can_dequeue())
+        size_t t = tail.load(std::memory_order::relaxed);
+
+        if (head.load(std::memory_order::acquire) == t)
             return std::unexpected{Err::Empty};
 
-        // This function can only work properly (without ending in undefined behavior) if this FIFO
-        // is used as a single producer / single consumer data-structure. Otherwise the referenced
-        // object from the FIFO cannot be valid since the tail-pointer could change and the
-        // head-pointer too.
-        return std::expected<T, Err>{buf[tail.load()]};
+        return std::expected<T, Err>{buf[t & MASK]};
     }
 
+    // The referenced element stays valid until it is popped, this only works if this FIFO is used
+    // as a single producer / single consumer data-structure.
     std::expected<std::reference_wrapper<T>, Err> peek_ref() noexcept
     {
-        size_t idx;
+        size_t t = tail.load(std::memory_order::relaxed);
 
-        if (!can_dequeue())
+        if (head.load(std::memory_order::acquire) == t)
             return std::unexpected{Err::Empty};
 
-        // if the FIFO is not empty, we first get the index to the next valid element
-        idx = tail.load(std::memory_order::acquire);
-
-        // after getting the index, we check it the slot is ready
-        if (ready[idx]) {
-            return std::expected<std::reference_wrapper<T>, Err>{
-                std::reference_wrapper<T>{buf[idx]}};
-        } else {
-            return std::unexpected{Err::Busy};
-        }
+        return std::expected<std::reference_wrapper<T>, Err>{
+            std::reference_wrapper<T>{buf[t & MASK]}};
     }
 
     std::expected<T, Err> pop_elem() noexcept
     {
-        size_t old;
-        size_t ny;
+        size_t t = tail.load(std::memory_order::relaxed);
         T ret;
 
-        if (!can_dequeue())
+        if (head.load(std::memory_order::acquire) == t)
             return std::unexpected{Err::Empty};
 
-        old = tail.load(std::memory_order::seq_cst);
-        do {
-            // Since we are only copying data out of the buffer, this should be okay and not destroy
-            // anything within the FIFO. We try to copy out the data until we get a valid
-            // tail-pointer.
-            ret = buf[old];
-            ny = (old + 1) & (N - 1);
-        } while (!tail.compare_exchange_weak(old, ny, std::memory_order::seq_cst));
-
-        // after 'pulling' out the data from the FIFO, set the ready bit back to 0
-        ready[old];
+        ret = buf[t & MASK];
+
+        // release the slot after the element was copied out
+        tail.store(t + 1, std::memory_order::release);
         return std::expected<T, Err>{ret};
     }
 
     Err pop() noexcept
     {
-        size_t idx;
+        size_t t = tail.load(std::memory_order::relaxed);
 
-        if (!can_dequeue())
+        if (head.load(std::memory_order::acquire) == t)
             return Err::Empty;
 
-        // increment the index..
-        idx = fetch_add(tail, 1);
-        // ..then clear the corresponding ready bit
-        ready[idx];
-
+        tail.store(t + 1, std::memory_order::release);
         return Err::Ok;
     }
 
-    inline bool is_full() const noexcept { return used() == (N - 1); }
-    inline bool is_empty() const noexcept { return used() == 0; }
-    inline size_t free() const noexcept { return (N - 1 - used()); }
-    inline size_t used() const noexcept
+    // pops up to vals.size() elements and returns the number of popped elements
+    size_t pop_n(std::span<T> vals) noexcept
     {
-        // To get the 'worst-case-scenario', where it is more likely that the queue is full, we have
-        // to read tail first.
-        size_t t = tail.load(std::memory_order::seq_cst);
-        size_t h = head.load(std::memory_order::seq_cst);
-
-        if (h >= t)
-            return h - t;
-        else
-            return N + h - t;
-    }
+        size_t t = tail.load(std::memory_order::relaxed);
+        size_t cnt = std::min(vals.size(), head.load(std::memory_order::acquire) - t);
 
-    inline bool can_dequeue() const noexcept
-    {
-        // To get the 'worst-case-scenario', where it is more likely that the queue is full, we have
-        // to read tail first.
-        size_t t = tail.load(std::memory_order::seq_cst);
-        size_t h = head.load(std::memory_order::seq_cst);
-        bool not_empty;
-
-        if (h >= t)
-            not_empty = (h - t) > 0;
-        else
-            not_empty = (N + h - t) > 0;
-
-        // if the FIFO is not empty, we check if the next pending element is ready
-        if (not_empty)
-            return ready[t];
-        else
-            return false;
+        for (size_t i = 0; i < cnt; i++)
+            vals[i] = buf[(t + i) & MASK];
+
+        tail.store(t + cnt, std::memory_order::release);
+        return cnt;
     }
 
-private:
-    inline size_t fetch_add(std::atomic<size_t>& a, size_t val) noexcept
+    inline bool is_full() const noexcept { return used() == N; }
+    inline bool is_empty() const noexcept { return used() == 0; }
+    inline size_t free() const noexcept { return N - used(); }
+    inline size_t used() const noexcept
     {
-        size_t ny;
-        size_t old = a.load(std::memory_order::seq_cst);
-
-        do {
-            ny = (old + val) & (N - 1);
-        } while (!a.compare_exchange_weak(old, ny, std::memory_order::seq_cst));
+        // Read tail first, head can only increase meanwhile which results in the worst case for the
+        // producer. If both indices changed in between, the difference could exceed N.
+        size_t t = tail.load(std::memory_order::acquire);
+        size_t h = head.load(std::memory_order::acquire);
 
-        return old;
+        return std::min(h - t, N);
     }
 
+    inline bool can_dequeue() const noexcept { return !is_empty(); }
+
+private:
+    static constexpr size_t MASK = N - 1;
+
     std::array<T, N> buf;
-    std::bitset<N> ready;
-    std::atomic<size_t> head;
-    std::atomic<size_t> tail;
+    std::atomic<size_t> head; // only written by the producer
+    std::atomic<size_t> tail; // only written by the consumer
 };
@@ -14,6 +14,7 @@ namespace libc {
 extern "C" {
     void* memset(void* str, uint8_t val, size_t nr_bytes);
     void* memcpy(void* dst, const void* src, size_t nr_bytes);
+    void* memmove(void* dst, const void* src, size_t nr_bytes);
     size_t strlen(const char* str);
 }
 }
\ No newline at end of file
@@ -10,47 +10,228 @@
 
 #include "libc.h"
 
+// GCC would otherwise detect the copy-loops and replace them with a call to memcpy/memset
+#pragma GCC optimize("no-tree-loop-distribute-patterns")
+
 extern void hard_fault(void);
 
+namespace {
+// words are accessed through this type in order to not violate the strict aliasing rules
+typedef uint32_t __attribute__((__may_alias__)) word;
+
+constexpr size_t WORD_SIZE = sizeof(word);
+constexpr size_t WORD_MASK = WORD_SIZE - 1;
+constexpr size_t BLOCK_SIZE = 8 * WORD_SIZE;
+
+// below this size, aligning the pointers is more expensive than copying bytewise
+constexpr size_t SMALL_COPY = 16;
+
+inline size_t misalignment(const void* ptr)
+{
+    return reinterpret_cast<size_t>(ptr) & WORD_MASK;
+}
+
+// Copies whole words from an aligned source to an aligned destination, a block of 8 words is
+// loaded into registers first which allows the compiler to use LDM/STM.
+inline void copy_words(word*& d, const word*& s, size_t nr_words)
+{
+    for (; nr_words >= 8; nr_words -= 8) {
+        word w0 = s[0];
+        word w1 = s[1];
+        word w2 = s[2];
+        word w3 = s[3];
+        word w4 = s[4];
+        word w5 = s[5];
+        word w6 = s[6];
+        word w7 = s[7];
+
+        d[0] = w0;
+        d[1] = w1;
+        d[2] = w2;
+        d[3] = w3;
+        d[4] = w4;
+        d[5] = w5;
+        d[6] = w6;
+        d[7] = w7;
+
+        s += 8;
+        d += 8;
+    }
+
+    for (; nr_words > 0; nr_words--)
+        *d++ = *s++;
+}
+
+// Copies whole words to an aligned destination from a source which is misaligned by off bytes. The
+// source is only read by aligned words which are merged (little endian) instead of using slow
+// unaligned accesses. Only words which contain at least one byte of the source are read.
+inline void copy_words_shifted(word*& d, const uint8_t* src, size_t off, size_t nr_words)
+{
+    const word* s = reinterpret_cast<const word*>(src - off);
+    const unsigned rshift = static_cast<unsigned>(off * 8);
+    const unsigned lshift = 32 - rshift;
+    word w0 = *s++;
+
+    for (; nr_words >= 4; nr_words -= 4) {
+        word w1 = s[0];
+        word w2 = s[1];
+        word w3 = s[2];
+        word w4 = s[3];
+
+        d[0] = (w0 >> rshift) | (w1 << lshift);
+        d[1] = (w1 >> rshift) | (w2 << lshift);
+        d[2] = (w2 >> rshift) | (w3 << lshift);
+        d[3] = (w3 >> rshift) | (w4 << lshift);
+
+        w0 = w4;
+        s += 4;
+        d += 4;
+    }
+
+    for (; nr_words > 0; nr_words--) {
+        word w1 = *s++;
+
+        *d++ = (w0 >> rshift) | (w1 << lshift);
+        w0 = w1;
+    }
+}
+}
+
 namespace libc {
 extern "C" {
     void* memset(void* str, uint8_t val, size_t nr_bytes)
     {
-        constexpr int INT_SIZE = sizeof(unsigned);
+        uint8_t* d8 = reinterpret_cast<uint8_t*>(str);
+        word* d;
+        word val_big;
+
+        if (nr_bytes < SMALL_COPY) {
+            while (nr_bytes-- > 0)
+                *d8++ = val;
+
+            return str;
+        }
 
-        unsigned val_big = 0;
-        uint8_t* str_small;
-        size_t i;
+        // align the destination
+        for (; misalignment(d8) != 0; nr_bytes--)
+            *d8++ = val;
 
-        for (int i = 0; i < INT_SIZE; i++)
-            val_big += static_cast<unsigned>(val) << (i * 8);
+        val_big = static_cast<word>(val) * 0x01010101UL;
+        d = reinterpret_cast<word*>(d8);
 
-        for (i = 0; i < (nr_bytes / INT_SIZE); i++)
-            reinterpret_cast<uint32_t*>(str)[i] = val_big;
+        for (; nr_bytes >= BLOCK_SIZE; nr_bytes -= BLOCK_SIZE) {
+            d[0] = val_big;
+            d[1] = val_big;
+            d[2] = val_big;
+            d[3] = val_big;
+            d[4] = val_big;
+            d[5] = val_big;
+            d[6] = val_big;
+            d[7] = val_big;
+            d += 8;
+        }
 
-        str_small = &reinterpret_cast<uint8_t*>(str)[INT_SIZE * i];
-        for (i = 0; i < (nr_bytes & (INT_SIZE - 1)); i++)
-            str_small[i] = val;
+        for (; nr_bytes >= WORD_SIZE; nr_bytes -= WORD_SIZE)
+            *d++ = val_big;
+
+        d8 = reinterpret_cast<uint8_t*>(d);
+        while (nr_bytes-- > 0)
+            *d8++ = val;
 
         return str;
     }
 
     void* memcpy(void* dst, const void* src, size_t nr_bytes)
     {
-        constexpr int INT_SIZE = sizeof(unsigned);
+        uint8_t* d8 = reinterpret_cast<uint8_t*>(dst);
+        const uint8_t* s8 = reinterpret_cast<const uint8_t*>(src);
+        size_t off;
+        word* d;
+
+        if (nr_bytes < SMALL_COPY) {
+            while (nr_bytes-- > 0)
+                *d8++ = *s8++;
+
+            return dst;
+        }
+
+        // align the destination, the source may still be misaligned afterwards
+        for (; misalignment(d8) != 0; nr_bytes--)
+            *d8++ = *s8++;
+
+        d = reinterpret_cast<word*>(d8);
+        off = misalignment(s8);
+        if (off == 0) {
+            const word* s = reinterpret_cast<const word*>(s8);
+            copy_words(d, s, nr_bytes / WORD_SIZE);
+        } else {
+            copy_words_shifted(d, s8, off, nr_bytes / WORD_SIZE);
+        }
+
+        s8 += nr_bytes & ~WORD_MASK;
+        d8 = reinterpret_cast<uint8_t*>(d);
+        nr_bytes &= WORD_MASK;
+        while (nr_bytes-- > 0)
+            *d8++ = *s8++;
+
+        return dst;
+    }
+
+    void* memmove(void* dst, const void* src, size_t nr_bytes)
+    {
+        uint8_t* d8 = reinterpret_cast<uint8_t*>(dst);
+        const uint8_t* s8 = reinterpret_cast<const uint8_t*>(src);
+
+        // If the destination is below the source or the buffers don't overlap, copying forwards is
+        // safe, since memcpy never writes a word before reading the source bytes located there.
+        if ((reinterpret_cast<size_t>(d8) - reinterpret_cast<size_t>(s8)) >= nr_bytes)
+            return memcpy(dst, src, nr_bytes);
+
+        // copy backwards, starting at the end of the buffers
+        d8 += nr_bytes;
+        s8 += nr_bytes;
+
+        if ((nr_bytes >= SMALL_COPY) && (misalignment(d8) == misalignment(s8))) {
+            word* d;
+            const word* s;
+
+            for (; misalignment(d8) != 0; nr_bytes--)
+                *--d8 = *--s8;
+
+            d = reinterpret_cast<word*>(d8);
+            s = reinterpret_cast<const word*>(s8);
+            for (; nr_bytes >= BLOCK_SIZE; nr_bytes -= BLOCK_SIZE) {
+                word w0 = s[-1];
+                word w1 = s[-2];
+                word w2 = s[-3];
+                word w3 = s[-4];
+                word w4 = s[-5];
+                word w5 = s[-6];
+                word w6 = s[-7];
+                word w7 = s[-8];
+
+                d[-1] = w0;
+                d[-2] = w1;
+                d[-3] = w2;
+                d[-4] = w3;
+                d[-5] = w4;
+                d[-6] = w5;
+                d[-7] = w6;
+                d[-8] = w7;
+
+                s -= 8;
+                d -= 8;
+            }
 
-        size_t i;
-        uint8_t* dst_small;
-        const uint8_t* src_small;
+            for (; nr_bytes >= WORD_SIZE; nr_bytes -= WORD_SIZE)
+                *--d = *--s;
 
-        for (i = 0; i < (nr_bytes / INT_SIZE); i++)
-            reinterpret_cast<unsigned*>(dst)[i] = reinterpret_cast<const unsigned*>(src)[i];
+            d8 = reinterpret_cast<uint8_t*>(d);
+            s8 = reinterpret_cast<const uint8_t*>(s);
+        }
 
-        dst_small = &reinterpret_cast<uint8_t*>(dst)[INT_SIZE * i];
-        src_small = &reinterpret_cast<const uint8_t*>(src)[INT_SIZE * i];
-        
-        for (i = 0; i < (nr_bytes & (INT_SIZE - 1)); i++)
-            dst_small[i] = src_small[i];
+        while (nr_bytes-- > 0)
+            *--d8 = *--s8;
 
         return dst;
     }
@@ -14,6 +14,16 @@
 
 #include "helpers.h"
 
+#ifdef HOST_SIM
+// Within the host simulation (see sim/sim.h) every register access is forwarded to the simulated
+// bus, which invokes the behavioral model of the accessed peripheral.
+namespace sim {
+void bus_write(volatile void* addr, uint32_t val, size_t size) noexcept;
+uint32_t bus_read(const volatile void* addr, size_t size) noexcept;
+[[noreturn]] void fault(const char* msg) noexcept;
+}
+#endif
+
 template<typename T> requires std::unsigned_integral<T>
 class BitField {
 public:
@@ -55,27 +65,45 @@ public:
     ~Reserved() = delete;
 
 protected:
+    constexpr void store(T val) noexcept
+    {
+#ifdef HOST_SIM
+        sim::bus_write(&reg, val, sizeof(T));
+#else
+        reg = val;
+#endif
+    }
+
+    constexpr T load() const noexcept
+    {
+#ifdef HOST_SIM
+        return static_cast<T>(sim::bus_read(&reg, sizeof(T)));
+#else
+        return reg;
+#endif
+    }
+
     volatile T reg;
 };
 
 template<typename T> requires std::unsigned_integral<T>
 class WriteOnly : public Reserved<T> {
 public:
-    constexpr void set(T val) noexcept { this->reg = val; }
-    constexpr void set(const BitField<T>& bf) { this->reg = bf.get_value(); }
+    constexpr void set(T val) noexcept { this->store(val); }
+    constexpr void set(const BitField<T>& bf) { this->store(bf.get_value()); }
 };
 
 template<typename T> requires std::unsigned_integral<T>
 class ReadOnly : public Reserved<T> {
 public:
-    constexpr T get() const noexcept { return this->reg; }
+    constexpr T get() const noexcept { return this->load(); }
 };
 
 // to avoid virtual inheritance, we only inherit from WriteOnly and implement the get function twice
 template<typename T> requires std::unsigned_integral<T>
 class ReadWrite : public WriteOnly<T> {
 public:
-    constexpr T get() const noexcept { return this->reg; }
+    constexpr T get() const noexcept { return this->load(); }
     constexpr volatile T& get_ref() volatile noexcept { return this->reg; }
     constexpr void modify(const BitField<T>& b)
     {
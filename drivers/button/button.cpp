@@ -11,6 +11,7 @@
 #include "err.h"
 #include "event_timer.h"
 #include "helpers.h"
+#include "int_pin.h"
 #include "pin.h"
 
 constexpr uint16_t SAMPLE_TIME = 10; // 10ms
@@ -47,7 +48,8 @@ Err Button::enable_event(ButtonEvent ev) noexcept
     if (!is_initialized())
         return Err::NotInitialized;
 
-    // if no event is active, we have to start the timer
+    // if no event is active, we have to start the timer, in the interrupt-driven mode it is
+    // stopped again once the level is stable
     if (!event_active())
         et.start_event(timer_event);
 
@@ -65,6 +67,9 @@ Err Button::disable_event(ButtonEvent ev) noexcept
         shift_reg = 0;
         long_press_cnt = 0;
         et.stop_event(timer_event);
+
+        if (irq_pin)
+            irq_pin->disable_interrupt();
     }
 
     return Err::Ok;
@@ -76,11 +81,18 @@ void Button::timer_cb(void* cookie) noexcept
     btn->handle_timer_event();
 }
 
+void Button::edge_cb(IntEdge edge, void* cookie) noexcept
+{
+    Button* btn = reinterpret_cast<Button*>(cookie);
+    btn->wake_up();
+}
+
 void Button::handle_timer_event() noexcept
 {
     constexpr uint8_t SHREG_MASK = hlp::mask<uint8_t>(SAMPLES - 1, 0);
 
     bool new_event = false;
+    bool pressed;
     bool high;
     bool low;
 
@@ -96,7 +108,8 @@ void Button::handle_timer_event() noexcept
         return;
     }
 
-    if ((low && is_active_low()) || (high && !is_active_low())) {
+    pressed = (low && is_active_low()) || (high && !is_active_low());
+    if (pressed) {
         // button is pressed
         if (prev_event == ButtonEvent::Pressed) {
             long_press_cnt++;
@@ -109,17 +122,39 @@ void Button::handle_timer_event() noexcept
             prev_event = ButtonEvent::Pressed;
             new_event = true;
         }
-    } else if ((low && !is_active_low()) || (high && is_active_low())) {
+    } else {
         // button is not pressed
-
         long_press_cnt = 0;
-        if (prev_event == ButtonEvent::Released)
-            return;
-
-        prev_event = ButtonEvent::Released;
-        new_event = true;
+        if (prev_event != ButtonEvent::Released) {
+            prev_event = ButtonEvent::Released;
+            new_event = true;
+        }
     }
 
     if (new_event && (status & static_cast<uint8_t>(prev_event)))
         btn_cb(prev_event, cookie);
+
+    // A pressed button has to be sampled until the long press elapsed, unless it was already
+    // reported or isn't enabled at all. In all other cases nothing changes until the next edge.
+    if (irq_pin && (!pressed || (prev_event == ButtonEvent::LongPress)
+        || ((status & static_cast<uint8_t>(ButtonEvent::LongPress)) == 0)))
+        sleep(pressed);
+}
+
+void Button::wake_up() noexcept
+{
+    irq_pin->disable_interrupt();
+    et.start_event(timer_event);
+}
+
+void Button::sleep(bool pressed) noexcept
+{
+    bool high = pressed != is_active_low();
+
+    et.stop_event(timer_event);
+    irq_pin->enable_interrupt(high ? IntEdge::Falling : IntEdge::Rising, this, Button::edge_cb);
+
+    // the edge may have occurred between the last sample and enabling the interrupt
+    if (pin.read() != high)
+        wake_up();
 }
@@ -3,6 +3,12 @@
 /*
  * Created by lebakassemmerl 2023
  * E-Mail: hotschi@gmx.at
+ *
+ * A button on a Pin is sampled every 10ms as long as an event is enabled. A button on an IntPin is
+ * interrupt-driven instead: the sampling only runs after an edge of the pin until the level is
+ * debounced (and a long press was detected or the button was released), afterwards the sampling is
+ * stopped and the edge interrupt of the pin is armed again. Thus, an untouched button doesn't cost
+ * anything. The events are the same in both modes.
  */
 
 #pragma once
@@ -12,6 +18,7 @@
 #include "err.h"
 #include "event_timer.h"
 #include "helpers.h"
+#include "int_pin.h"
 #include "pin.h"
 
 enum class ButtonEvent : uint8_t {
@@ -24,9 +31,10 @@ enum class ButtonEvent : uint8_t {
 class Button {
 public:
     constexpr explicit Button(Pin& pin, EventTimer& et, bool active_low) noexcept
-        : shift_reg(0), long_press_cnt(0), prev_event(ButtonEvent::None),
-        status(static_cast<uint8_t>(active_low) << ACTIVE_LOW_BIT), btn_cb(nullptr),
-        cookie(nullptr), timer_event(), et(et), pin(pin) {}
+        : Button(pin, nullptr, et, active_low) {}
+
+    constexpr explicit Button(IntPin& pin, EventTimer& et, bool active_low) noexcept
+        : Button(pin, &pin, et, active_low) {}
 
     Err init(void* cookie, void (*btn_event)(ButtonEvent ev, void* cookie) noexcept) noexcept;
     Err enable_event(ButtonEvent ev) noexcept;
@@ -38,8 +46,16 @@ private:
     static constexpr uint8_t ACTIVE_LOW = hlp::bit<uint8_t>(ACTIVE_LOW_BIT);
     static constexpr uint8_t EVENT_MASK = hlp::mask<uint8_t>(2, 0);
 
+    constexpr explicit Button(Pin& pin, IntPin* irq_pin, EventTimer& et, bool active_low) noexcept
+        : shift_reg(0), long_press_cnt(0), prev_event(ButtonEvent::None),
+        status(static_cast<uint8_t>(active_low) << ACTIVE_LOW_BIT), btn_cb(nullptr),
+        cookie(nullptr), timer_event(), et(et), pin(pin), irq_pin(irq_pin) {}
+
     static void timer_cb(void* cookie) noexcept;
+    static void edge_cb(IntEdge edge, void* cookie) noexcept;
     void handle_timer_event() noexcept;
+    void wake_up() noexcept;
+    void sleep(bool pressed) noexcept;
 
     inline bool is_initialized() const noexcept { return (status & INITIALIZED) > 0; }
     inline bool is_active_low() const noexcept { return (status & ACTIVE_LOW) > 0; }
@@ -56,4 +72,5 @@ private:
     EventTimer::Event timer_event;
     EventTimer& et;
     Pin& pin;
+    IntPin* const irq_pin; // nullptr if the button is polled
 };
@@ -7,6 +7,7 @@
 
 BUTTON_DIR = $(ROOT)/drivers/button
 
-SRCS += $(BUTTON_DIR)/button.cpp
+SRCS += $(BUTTON_DIR)/button.cpp \
+	$(BUTTON_DIR)/button_group.cpp
 
 INCLUDES += $(BUTTON_DIR)
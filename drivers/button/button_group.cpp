@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ */
+
+#include <bit>
+#include <expected>
+
+#include "button.h"
+#include "button_group.h"
+#include "err.h"
+#include "event_timer.h"
+#include "helpers.h"
+#include "pin.h"
+
+constexpr uint16_t SAMPLE_TIME = 10; // 10ms, with 4 samples this results in 40ms debounce time
+constexpr uint8_t LONG_BUTTON_PRESS = 150; // 10ms * 150 = 1.5s
+
+Err ButtonGroup::init(void* cookie,
+    void (*btn_cb)(size_t idx, ButtonEvent ev, void* cookie) noexcept) noexcept
+{
+    std::expected<EventTimer::Event, Err> ev;
+    uint8_t mask = 0;
+
+    if (!btn_cb)
+        return Err::NullPtr;
+
+    if (initialized)
+        return Err::AlreadyInitialized;
+
+    if (pins.empty() || (pins.size() > MAX_BUTTONS))
+        return Err::OutOfRange;
+
+    for (Pin* p : pins) {
+        if (!p)
+            return Err::NullPtr;
+
+        if (!p->same_port(*pins[0]) || ((mask & p->mask()) > 0))
+            return Err::OutOfRange;
+
+        mask |= p->mask();
+    }
+
+    ev = et.register_event(SAMPLE_TIME, this, ButtonGroup::timer_cb);
+    if (!ev.has_value())
+        return ev.error();
+
+    for (size_t i = 0; i < pins.size(); i++) {
+        pins[i]->make_input();
+        pins[i]->set_pull_mode(active_low ? PullMode::PullUp : PullMode::PullDown);
+        lane_idx[static_cast<size_t>(std::countr_zero(pins[i]->mask()))] = static_cast<uint8_t>(i);
+    }
+
+    lanes = mask;
+    invert = active_low ? mask : 0;
+    timer_event = std::move(ev.value());
+    this->btn_cb = btn_cb;
+    this->cookie = cookie;
+
+    initialized = true;
+    return Err::Ok;
+}
+
+Err ButtonGroup::enable_event(ButtonEvent ev) noexcept
+{
+    if (!initialized)
+        return Err::NotInitialized;
+
+    // if no event is active, we have to start the timer
+    if (events == 0)
+        et.start_event(timer_event);
+
+    events = static_cast<uint8_t>(events | static_cast<uint8_t>(ev));
+    return Err::Ok;
+}
+
+Err ButtonGroup::disable_event(ButtonEvent ev) noexcept
+{
+    if (!initialized)
+        return Err::NotInitialized;
+
+    events = static_cast<uint8_t>(events & ~static_cast<uint8_t>(ev));
+    if (events == 0) {
+        et.stop_event(timer_event);
+        state = 0;
+        cnt0 = 0;
+        cnt1 = 0;
+        long_reported = 0;
+        hold_cnt.fill(0);
+    }
+
+    return Err::Ok;
+}
+
+bool ButtonGroup::is_pressed(size_t idx) const noexcept
+{
+    if (idx >= pins.size())
+        return false;
+
+    return (state & pins[idx]->mask()) > 0;
+}
+
+void ButtonGroup::timer_cb(void* cookie) noexcept
+{
+    ButtonGroup* grp = reinterpret_cast<ButtonGroup*>(cookie);
+    grp->handle_timer_event();
+}
+
+void ButtonGroup::handle_timer_event() noexcept
+{
+    uint8_t sample = static_cast<uint8_t>((pins[0]->read_port() ^ invert) & lanes);
+    uint8_t debounced = state;
+    uint8_t delta = static_cast<uint8_t>(sample ^ debounced);
+    uint8_t toggled;
+    uint8_t held;
+
+    // Every lane which differs from its debounced state counts up, all the others are reset. The
+    // lanes whose counter wraps around from 3 to 0 (4 equal samples) toggle.
+    cnt1 = static_cast<uint8_t>((cnt1 ^ cnt0) & delta);
+    cnt0 = static_cast<uint8_t>(~cnt0 & delta);
+    toggled = static_cast<uint8_t>(delta & ~(cnt0 | cnt1));
+    debounced ^= toggled;
+    state = debounced;
+
+    if (toggled != 0) {
+        long_reported = static_cast<uint8_t>(long_reported & ~toggled);
+        notify(static_cast<uint8_t>(toggled & debounced), ButtonEvent::Pressed);
+        notify(static_cast<uint8_t>(toggled & ~debounced), ButtonEvent::Released);
+    }
+
+    if ((events & static_cast<uint8_t>(ButtonEvent::LongPress)) == 0)
+        return;
+
+    // only the lanes which are held down and didn't report the long press yet are visited
+    held = static_cast<uint8_t>(debounced & ~long_reported);
+
+    while (held != 0) {
+        size_t lane = static_cast<size_t>(std::countr_zero(held));
+        uint8_t bit = hlp::bit<uint8_t>(static_cast<uint8_t>(lane));
+
+        held &= static_cast<uint8_t>(held - 1);
+        hold_cnt[lane] = ((toggled & bit) > 0) ? 0 : static_cast<uint8_t>(hold_cnt[lane] + 1);
+        if (hold_cnt[lane] > LONG_BUTTON_PRESS) {
+            long_reported = static_cast<uint8_t>(long_reported | bit);
+            notify(bit, ButtonEvent::LongPress);
+        }
+    }
+}
+
+void ButtonGroup::notify(uint8_t mask, ButtonEvent ev) noexcept
+{
+    if ((events & static_cast<uint8_t>(ev)) == 0)
+        return;
+
+    while (mask != 0) {
+        size_t lane = static_cast<size_t>(std::countr_zero(mask));
+
+        mask &= static_cast<uint8_t>(mask - 1);
+        btn_cb(lane_idx[lane], ev, cookie);
+    }
+}
@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ *
+ * Up to 8 buttons located at the same port, e.g. a keypad. Every 10ms the input register of the
+ * port is read once and all the buttons are debounced at once by a vertical counter: each lane
+ * (pin) has a 2-bit counter whose bits are stored in two bytes, thus a single sequence of bitwise
+ * operations counts all the lanes. A lane toggles its debounced state after 4 equal samples which
+ * differ from it. The callback is only invoked for the lanes which toggled (or reached a long
+ * press), with the index of the button within the pins passed to the constructor.
+ *
+ * All the buttons are released initially, a button which is pressed during init() is reported as
+ * pressed once it's debounced.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+#include "button.h"
+#include "err.h"
+#include "event_timer.h"
+#include "helpers.h"
+#include "pin.h"
+
+class ButtonGroup {
+public:
+    static constexpr size_t MAX_BUTTONS = 8;
+
+    constexpr explicit ButtonGroup(std::span<Pin* const> pins, EventTimer& et, bool active_low)
+        noexcept : state(0), cnt0(0), cnt1(0), lanes(0), long_reported(0), invert(0), events(0),
+        initialized(false), hold_cnt(), lane_idx(), btn_cb(nullptr), cookie(nullptr),
+        timer_event(), et(et), pins(pins), active_low(active_low) {}
+
+    // fails with OutOfRange if there are more than MAX_BUTTONS pins or not all of them are
+    // located at the same port
+    Err init(void* cookie,
+        void (*btn_cb)(size_t idx, ButtonEvent ev, void* cookie) noexcept) noexcept;
+    Err enable_event(ButtonEvent ev) noexcept;
+    Err disable_event(ButtonEvent ev) noexcept;
+
+    // the debounced state of the button, true if it is pressed
+    bool is_pressed(size_t idx) const noexcept;
+
+private:
+    static void timer_cb(void* cookie) noexcept;
+    void handle_timer_event() noexcept;
+    void notify(uint8_t mask, ButtonEvent ev) noexcept;
+
+    volatile uint8_t state; // debounced state of the lanes, a set bit means pressed
+    uint8_t cnt0; // low bits of the vertical counters
+    uint8_t cnt1; // high bits of the vertical counters
+    uint8_t lanes; // the pins of the port which belong to the group
+    uint8_t long_reported;
+    uint8_t invert;
+    volatile uint8_t events;
+    bool initialized;
+    std::array<uint8_t, MAX_BUTTONS> hold_cnt; // ticks since the lane was pressed
+    std::array<uint8_t, MAX_BUTTONS> lane_idx; // index of the pin for every lane
+
+    void (*btn_cb)(size_t idx, ButtonEvent ev, void* cookie) noexcept;
+    void* cookie;
+
+    EventTimer::Event timer_event;
+    EventTimer& et;
+    std::span<Pin* const> pins;
+    const bool active_low;
+};
@@ -5,27 +5,34 @@
  * E-Mail: hotschi@gmx.at
  */
 
+#include <algorithm>
 #include <atomic>
+#include <bit>
 #include <cstddef>
 #include <cstdint>
 #include <expected>
 
+#include "cm4f.h"
 #include "err.h"
 #include "event_timer.h"
+#include "helpers.h"
 #include "timer32.h"
 
 void EventTimer::init(const Cs& cs) noexcept
 {
     t32.init(EventTimer::timer_cb, this);
     t32.set_frequency(1000, cs);
+    cyc_per_ms = cs.m_clk() / 1000;
 
     initialized = true;
 }
 
 std::expected<EventTimer::Event, Err> EventTimer::register_event(
-    uint16_t interval_ms, void* cookie, void (*elapsed_cb)(void* cookie) noexcept) noexcept
+    uint32_t interval_ms, void* cookie, void (*elapsed_cb)(void* cookie) noexcept,
+    EventMode mode) noexcept
 {
-    uint8_t idx;
+    size_t pos;
+    Index idx;
 
     if (interval_ms == 0)
         return std::unexpected{Err::OutOfRange};
@@ -33,80 +40,318 @@ std::expected<EventTimer::Event, Err> EventTimer::register_event(
     if (!elapsed_cb)
         return std::unexpected{Err::NullPtr};
 
-    idx = ev_list.used.fetch_add(1, std::memory_order::seq_cst);
-    if (idx >= ev_list.events.size()) {
+    pos = used.fetch_add(1, std::memory_order::seq_cst);
+    if (pos >= events.size()) {
         // We are out of range and incremented the index before. If we do this too oftent, the index
         // wraps around and becomes valid again. Thus, we reset the index to a safe value which is
         // bigger than the size of the event-array.
-        ev_list.used.store(static_cast<uint8_t>(ev_list.events.size() + 1));
+        used.store(events.size() + 1);
         return std::unexpected{Err::NoMem};
     }
 
-    ev_list.events[idx].elapsed = elapsed_cb;
-    ev_list.events[idx].cookie = cookie;
-    ev_list.events[idx].interval = interval_ms;
-    ev_list.events[idx].cnt = 0;
+    idx = static_cast<Index>(pos);
+    events[idx].elapsed = elapsed_cb;
+    events[idx].cookie = cookie;
+    events[idx].interval = interval_ms;
+    events[idx].mode = mode;
 
     return std::expected<EventTimer::Event, Err>{EventTimer::Event{idx}};
 }
 
 Err EventTimer::start_event(const Event& ev) noexcept
 {
+    uint32_t primask;
+
     if (!initialized)
         return Err::NotInitialized;
 
-    auto old = ev_list.enabled.load();
-
-    using T = decltype(old);
-
-    T ny;
-    do {
-        ny = old | (static_cast<T>(1U) << static_cast<T>(ev.ev));
-    } while (!ev_list.enabled.compare_exchange_weak(old, ny, std::memory_order::seq_cst));
+    if (ev.ev >= events.size())
+        return Err::OutOfRange;
 
-    if (!t32.is_running())
+    primask = cm4f::disable_irq();
+    arm(ev.ev);
+    if (in_tick) {
+        // started by a callback, the deadline is calculated at the end of the interrupt
+    } else if (!t32.is_running()) {
+        // the timer was stopped, thus no time elapsed since the last processed tick
+        deadline = next_deadline();
+        t32.set_period((deadline - now) * cyc_per_ms);
         t32.start();
+    } else if (!t32.is_pending()) {
+        // Move the deadline forward if the event elapses before. If the timer is pending, the
+        // deadline is calculated again within the interrupt anyway.
+        uint32_t at = events[ev.ev].expires + 1;
+        if (static_cast<int32_t>(at - deadline) < 0) {
+            t32.set_period((at - now) * cyc_per_ms - elapsed_cycles());
+            deadline = at;
+        }
+    }
+    cm4f::restore_irq(primask);
 
     return Err::Ok;
 }
 
 Err EventTimer::stop_event(const Event& ev) noexcept
 {
+    uint32_t primask;
+
     if (!initialized)
         return Err::NotInitialized;
 
-    auto old = ev_list.enabled.load();
+    if (ev.ev >= events.size())
+        return Err::OutOfRange;
 
-    using T = decltype(old);
-
-    T ny;
-    do {
-        ny = old & ~(static_cast<T>(1U) << static_cast<T>(ev.ev));
-    } while (!ev_list.enabled.compare_exchange_weak(old, ny, std::memory_order::seq_cst));
+    primask = cm4f::disable_irq();
+    if (events[ev.ev].slot != NO_SLOT) {
+        unlink(ev.ev);
+        armed--;
+    }
 
-    if (ny == 0)
+    // A callback may start another event right away, thus the timer keeps running until the end of
+    // the interrupt. Stopping it would make the next start take the time of the stop for the time
+    // of the last processed tick.
+    if ((armed == 0) && !in_tick)
         t32.stop();
+    cm4f::restore_irq(primask);
+
+    return Err::Ok;
+}
 
+Err EventTimer::set_interval(const Event& ev, uint32_t interval_ms) noexcept
+{
+    if (interval_ms == 0)
+        return Err::OutOfRange;
+
+    if (ev.ev >= events.size())
+        return Err::OutOfRange;
+
+    // an armed event elapses at the previously configured time, the new interval is used afterwards
+    events[ev.ev].interval = interval_ms;
     return Err::Ok;
 }
 
+std::expected<bool, Err> EventTimer::is_running(const Event& ev) const noexcept
+{
+    if (ev.ev >= events.size())
+        return std::unexpected{Err::OutOfRange};
+
+    return std::expected<bool, Err>{events[ev.ev].slot != NO_SLOT};
+}
+
 void EventTimer::timer_cb(void *cookie) noexcept
 {
     EventTimer *et = reinterpret_cast<EventTimer*>(cookie);
+    et->handle_deadline();
+}
+
+void EventTimer::handle_deadline() noexcept
+{
+    uint32_t overshoot;
+
+    // process all the ticks up to the deadline, there are no events before the last one except
+    // if the first level wrapped around
+    in_tick = true;
+    while (now != deadline)
+        tick();
+    in_tick = false;
+
+    if (armed == 0) {
+        t32.stop();
+        return;
+    }
+
+    // the counter was reloaded at the deadline, take the cycles elapsed since then into account
+    overshoot = t32.get_period() - t32.get_counter();
+    if (t32.is_pending())
+        overshoot += t32.get_period();
+
+    schedule(overshoot);
+}
+
+void EventTimer::schedule(uint32_t overshoot) noexcept
+{
+    uint32_t cycles;
+
+    deadline = next_deadline();
+    cycles = (deadline - now) * cyc_per_ms;
+    t32.set_period((cycles > overshoot) ? (cycles - overshoot) : 1);
+}
 
-    auto enabled = et->ev_list.enabled.load();
-    for (uint8_t i = 0; i < et->ev_list.used.load(); i++) {
-        using T = decltype(enabled);
+uint32_t EventTimer::next_deadline() const noexcept
+{
+    const size_t idx0 = now & (L0_SLOTS - 1);
+    const size_t words = l0_used.size();
+    uint32_t delta = L0_SLOTS - 1;
 
-        EventEntry& ev = et->ev_list.events[i];
+    // search the next non-empty slot of the first level starting at the current one, the word of
+    // the current slot is checked twice: first the upper part, after wrapping around the lower one
+    for (size_t i = 0; i <= words; i++) {
+        const size_t w = ((idx0 / 32) + i) % words;
+        uint32_t bits = l0_used[w];
 
-        if ((enabled & (static_cast<T>(1UL) << static_cast<T>(i))) == 0)
-            continue;
+        if (i == 0)
+            bits &= ~static_cast<uint32_t>(0) << (idx0 & 31);
+        else if (i == words)
+            bits &= hlp::bit<uint32_t>(static_cast<uint32_t>(idx0 & 31)) - 1;
 
-        ev.cnt++;
-        if (ev.cnt >= ev.interval) {
-            ev.cnt = 0;
-            ev.elapsed(ev.cookie);
+        if (bits != 0) {
+            delta = static_cast<uint32_t>((w * 32 + std::countr_zero(bits) - idx0) & (L0_SLOTS - 1));
+            break;
         }
     }
+
+    // wake up for the next cascade if there are events on the higher levels
+    if (upper > 0)
+        delta = std::min(delta, static_cast<uint32_t>((L0_SLOTS - idx0) & (L0_SLOTS - 1)));
+
+    // the tick at now + delta is processed at the end of this millisecond
+    return now + delta + 1;
+}
+
+uint32_t EventTimer::elapsed_cycles() noexcept
+{
+    // the counter counts down to the deadline
+    return (deadline - now) * cyc_per_ms - t32.get_counter();
+}
+
+void EventTimer::tick() noexcept
+{
+    const size_t idx0 = now & (L0_SLOTS - 1);
+    Index idx;
+
+    // Each time the first level wrapped around, the next slot of the level above is moved down. If
+    // this level wrapped around too, the next level is cascaded as well and so on.
+    if (idx0 == 0) {
+        for (size_t level = 1; level < LEVELS; level++) {
+            cascade(level);
+            if (((now >> (L0_BITS + (level - 1) * LN_BITS)) & (LN_SLOTS - 1)) != 0)
+                break;
+        }
+    }
+
+    // move all events of the current slot to the expired-list, this allows the callbacks to start
+    // or stop any event (including the currently elapsed ones)
+    idx = slots[idx0];
+    slots[idx0] = NONE;
+    l0_used[idx0 / 32] &= ~hlp::bit<uint32_t>(static_cast<uint32_t>(idx0 & 31));
+    slots[EXPIRED] = idx;
+    while (idx != NONE) {
+        events[idx].slot = EXPIRED;
+        idx = events[idx].next;
+    }
+
+    now = now + 1;
+
+    while ((idx = slots[EXPIRED]) != NONE) {
+        EventEntry& e = events[idx];
+
+        unlink(idx);
+        if (e.mode == EventMode::Periodic) {
+            // calculate the next expiry based on the last one to avoid drifting
+            e.expires = e.expires + e.interval;
+            insert(idx);
+        } else {
+            armed--;
+        }
+
+        e.elapsed(e.cookie);
+    }
+}
+
+void EventTimer::cascade(size_t level) noexcept
+{
+    const size_t shift = L0_BITS + (level - 1) * LN_BITS;
+    const size_t slot = L0_SLOTS + (level - 1) * LN_SLOTS + ((now >> shift) & (LN_SLOTS - 1));
+    Index idx = slots[slot];
+
+    slots[slot] = NONE;
+    while (idx != NONE) {
+        Index next = events[idx].next;
+
+        upper--;
+        insert(idx);
+        idx = next;
+    }
+}
+
+void EventTimer::arm(Index idx) noexcept
+{
+    EventEntry& e = events[idx];
+    uint32_t elapsed_ms = 0;
+
+    if (e.slot != NO_SLOT)
+        unlink(idx);
+    else
+        armed++;
+
+    // The ticks since now weren't processed yet, since we run tickless. Within the interrupt (or if
+    // the timer is stopped) now is the current tick.
+    if (!in_tick && t32.is_running())
+        elapsed_ms = t32.is_pending() ? (deadline - now) : (elapsed_cycles() / cyc_per_ms);
+
+    // now is the tick which is processed next, thus the event elapses after interval ticks
+    e.expires = now + elapsed_ms + e.interval - 1;
+    insert(idx);
+}
+
+void EventTimer::insert(Index idx) noexcept
+{
+    const uint32_t expires = events[idx].expires;
+    const uint32_t delta = expires - now;
+    size_t level = 1;
+    size_t shift = L0_BITS;
+
+    if (delta < L0_SLOTS) {
+        push(static_cast<uint16_t>(expires & (L0_SLOTS - 1)), idx);
+        return;
+    }
+
+    // find the lowest level whose range covers the delta, the last level covers the rest
+    while ((level < (LEVELS - 1)) && (delta >= (1UL << (shift + LN_BITS)))) {
+        level++;
+        shift += LN_BITS;
+    }
+
+    push(static_cast<uint16_t>(L0_SLOTS + (level - 1) * LN_SLOTS
+        + ((expires >> shift) & (LN_SLOTS - 1))), idx);
+}
+
+void EventTimer::unlink(Index idx) noexcept
+{
+    EventEntry& e = events[idx];
+
+    if (e.prev != NONE)
+        events[e.prev].next = e.next;
+    else
+        slots[e.slot] = e.next;
+
+    if (e.next != NONE)
+        events[e.next].prev = e.prev;
+
+    if ((e.slot < L0_SLOTS) && (slots[e.slot] == NONE))
+        l0_used[e.slot / 32] &= ~hlp::bit<uint32_t>(static_cast<uint32_t>(e.slot & 31));
+    else if ((e.slot >= L0_SLOTS) && (e.slot < EXPIRED))
+        upper--;
+
+    e.next = NONE;
+    e.prev = NONE;
+    e.slot = NO_SLOT;
+}
+
+void EventTimer::push(uint16_t slot, Index idx) noexcept
+{
+    EventEntry& e = events[idx];
+
+    e.slot = slot;
+    e.prev = NONE;
+    e.next = slots[slot];
+    if (e.next != NONE)
+        events[e.next].prev = idx;
+
+    slots[slot] = idx;
+
+    if (slot < L0_SLOTS)
+        l0_used[slot / 32] |= hlp::bit<uint32_t>(static_cast<uint32_t>(slot & 31));
+    else if (slot < EXPIRED)
+        upper++;
 }
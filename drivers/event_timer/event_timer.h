@@ -2,12 +2,24 @@
  * Created by lebakassemmerl 2023
  * E-Mail: hotschi@gmx.at
  * 
- * This EventTimer configures a hardware-timer to fire an interrupt every 1ms. The API is designed
- * to register multiple Events which will fire after a configured amount of milliseconds (interval).
- * Be aware, that the callbacks of this EventTimer are running in interrupt-context!
- * 
+ * This EventTimer uses a hardware-timer with a resolution of 1ms. The API is designed to register
+ * multiple Events which will fire after a configured amount of milliseconds (interval). Be aware,
+ * that the callbacks of this EventTimer are running in interrupt-context!
+ *
+ * The armed events are kept in a hierarchical timer wheel: the first level has one slot per
+ * millisecond for the next 256ms, every further level covers 64 slots of the whole range of the
+ * level below. Thus a tick only processes a single slot of the first level and once every 256ms
+ * the events of one slot of a higher level are moved down (cascaded). The cost of a tick doesn't
+ * depend on the number of armed events but only on the events which actually elapse.
+ *
+ * The timer runs tickless: instead of an interrupt every millisecond, the hardware-timer is
+ * programmed to the next slot of the first level which contains an event (or to the next cascade
+ * if only the higher levels contain events). On such an interrupt all the milliseconds up to the
+ * deadline are processed at once. If no event is armed, the hardware-timer is stopped.
+ *
  * The API is only safe to use if the events are registered outside of an interrupt-context,
- * otherwise this could end up in undefined behavior.
+ * otherwise this could end up in undefined behavior. Starting and stopping events is allowed from
+ * any context, also from within an elapsed-callback.
  */
 
 #pragma once
@@ -15,25 +27,40 @@
 #include <array>
 #include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <expected>
+#include <limits>
+#include <span>
 #include <utility>
 
 #include "cs.h"
 #include "timer32.h"
 
 class EventTimer {
+    struct EventEntry;
 public:
+    // the events are addressed with 16 bits, the highest index marks an invalid one
+    using Index = uint16_t;
+
+    // upper limit for the number of events of a StaticEventTimer
+    static constexpr size_t MAX_EVENTS = std::numeric_limits<Index>::max();
+
+    enum class EventMode : uint8_t {
+        Periodic = 0,
+        OneShot = 1,
+    };
+
     class Event {
     public:
         // allow creating an invalid instance of an event
-        constexpr explicit Event() noexcept : ev(0xFF) {}
+        constexpr explicit Event() noexcept : ev(INVALID) {}
 
         // moving the event is okay since the event is still valid then
         constexpr Event(const Event&& other) noexcept : ev(std::move(other.ev)) {}
 
         // If we call a move constructor on a non-constant reference, we additionally set the
-        // event-ID to 0xFF which is an invalid value.
-        constexpr Event(Event&& other) noexcept : ev(std::exchange(other.ev, 0xFF)) {}
+        // event-ID to INVALID.
+        constexpr Event(Event&& other) noexcept : ev(std::exchange(other.ev, INVALID)) {}
 
         // move-assignement is also allowed
         constexpr Event& operator=(const Event&& other) noexcept
@@ -48,42 +75,105 @@ public:
 
         friend class EventTimer;
     private:
-        constexpr explicit Event(uint8_t idx) noexcept : ev(idx) {}
+        static constexpr Index INVALID = std::numeric_limits<Index>::max();
 
-        uint8_t ev;
-    };
+        constexpr explicit Event(Index idx) noexcept : ev(idx) {}
 
-    constexpr explicit EventTimer(Timer32& t32) noexcept
-        : initialized(false), ev_list(), t32(t32) {}
+        Index ev;
+    };
 
     void init(const Cs& cs) noexcept;
+
+    // (Re-)Starts the event, the first callback is called after interval milliseconds.
     Err start_event(const Event& ev) noexcept;
     Err stop_event(const Event& ev) noexcept;
+    Err set_interval(const Event& ev, uint32_t interval_ms) noexcept;
+    std::expected<bool, Err> is_running(const Event& ev) const noexcept;
+
     std::expected<EventTimer::Event, Err> register_event(
-        uint16_t interval_ms, void* cookie, void (*elapsed_cb)(void* cookie) noexcept) noexcept;
+        uint32_t interval_ms, void* cookie, void (*elapsed_cb)(void* cookie) noexcept,
+        EventMode mode = EventMode::Periodic) noexcept;
+protected:
+    // The events are stored by the StaticEventTimer, which passes its storage before it is
+    // constructed. Thus, the storage must not be accessed within this constructor.
+    constexpr explicit EventTimer(Timer32& t32, std::span<EventEntry> events) noexcept
+        : initialized(false), in_tick(false), used(0), armed(0), upper(0), cyc_per_ms(0), now(0),
+        deadline(0), events(events), slots(), l0_used(), t32(t32)
+    {
+        slots.fill(NONE);
+    }
+
+    EventTimer(const EventTimer&) = delete;
+    EventTimer& operator=(const EventTimer&) = delete;
+
 private:
+    static constexpr Index NONE = std::numeric_limits<Index>::max();
+    static constexpr uint16_t NO_SLOT = std::numeric_limits<uint16_t>::max();
+
+    // the first level has 2^8 slots, the others 2^6 which results in 8 + 4 * 6 = 32 bits
+    static constexpr size_t L0_BITS = 8;
+    static constexpr size_t LN_BITS = 6;
+    static constexpr size_t LEVELS = 5;
+    static constexpr size_t L0_SLOTS = 1 << L0_BITS;
+    static constexpr size_t LN_SLOTS = 1 << LN_BITS;
+    static constexpr size_t WHEEL_SLOTS = L0_SLOTS + (LEVELS - 1) * LN_SLOTS;
+
+    // an additional list which holds the elapsed events while their callbacks are called
+    static constexpr uint16_t EXPIRED = static_cast<uint16_t>(WHEEL_SLOTS);
+
     struct EventEntry {
         constexpr explicit EventEntry() noexcept
-            : interval(0), cnt(0), cookie(nullptr), elapsed(nullptr) {}
+            : interval(0), expires(0), cookie(nullptr), elapsed(nullptr), slot(NO_SLOT),
+            next(NONE), prev(NONE), mode(EventMode::Periodic) {}
 
-        uint16_t interval;
-        uint16_t cnt;
+        uint32_t interval;
+        uint32_t expires;
         void* cookie;
         void (*elapsed)(void* cookie) noexcept;
+        uint16_t slot; // NO_SLOT if the event isn't armed
+        Index next;
+        Index prev;
+        EventMode mode;
     };
 
-    template<typename T> requires std::unsigned_integral<T>
-    struct EventList {
-        constexpr explicit EventList() noexcept : enabled(0), used(0), events() {}
-
-        std::atomic<T> enabled;
-        std::atomic<uint8_t> used;
-        std::array<EventEntry, sizeof(T) * 8> events;
-    };
+    template<size_t N>
+    friend class StaticEventTimer;
 
     static void timer_cb(void* cookie) noexcept;
+    void handle_deadline() noexcept;
+    void schedule(uint32_t overshoot) noexcept;
+    uint32_t next_deadline() const noexcept;
+    uint32_t elapsed_cycles() noexcept;
+    void tick() noexcept;
+    void cascade(size_t level) noexcept;
+    void arm(Index idx) noexcept;
+    void insert(Index idx) noexcept;
+    void unlink(Index idx) noexcept;
+    void push(uint16_t slot, Index idx) noexcept;
 
     bool initialized;
-    EventList<uint32_t> ev_list;
+    bool in_tick;
+    std::atomic<size_t> used;
+    uint16_t armed;
+    uint16_t upper; // number of events within the levels above the first one
+    uint32_t cyc_per_ms;
+    uint32_t now; // the next tick which will be processed
+    uint32_t deadline; // the tick at which the hardware-timer fires next
+    std::span<EventEntry> events;
+    std::array<Index, WHEEL_SLOTS + 1> slots; // index of the first event of each slot
+    std::array<uint32_t, L0_SLOTS / 32> l0_used; // bitmap of the non-empty slots of the first level
     Timer32& t32;
 };
+
+// An EventTimer which can hold up to N events. The drivers take the EventTimer, thus they work with
+// any number of events.
+template<size_t N = 32>
+class StaticEventTimer : public EventTimer {
+    static_assert((N > 0) && (N < MAX_EVENTS), "StaticEventTimer: invalid number of events");
+public:
+    constexpr explicit StaticEventTimer(Timer32& t32) noexcept
+        : EventTimer(t32, std::span<EventEntry>{storage}), storage() {}
+
+private:
+    std::array<EventEntry, N> storage;
+};
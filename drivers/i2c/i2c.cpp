@@ -5,13 +5,21 @@
  * E-Mail: hotschi@gmx.at
  */
 
+#include <algorithm>
 #include <atomic>
 #include <cstdint>
 #include <span>
 
+#include "bitmap.h"
 #include "cs.h"
+#include "dma.h"
+#include "cm4f.h"
+#include "dwt.h"
 #include "err.h"
+#include "event_timer.h"
 #include "i2c.h"
+#include "pin.h"
+#include "profile.h"
 #include "usci.h"
 #include "uscib_regs.h"
 
@@ -49,6 +57,38 @@ Err I2cMaster::init(const Cs& clk) noexcept
         m->handle_interrupt();
     }, this);
 
+    if (tx_dma) {
+        Err ret = tx_dma->setup(DmaConfig{
+            tx_dma_src,
+            DmaDataWidth::Width8Bit,
+            DmaPtrIncrement::Incr8Bit,
+            DmaPtrIncrement::NoIncr,
+            reinterpret_cast<void*>(this),
+            [] (const uint8_t* src, uint8_t* dst, size_t len, void* inst) noexcept -> void {
+                I2cMaster* m = reinterpret_cast<I2cMaster*>(inst);
+                m->tx_dma_done();
+            }
+        });
+
+        if (ret != Err::Ok)
+            return ret;
+
+        ret = rx_dma->setup(DmaConfig{
+            rx_dma_src,
+            DmaDataWidth::Width8Bit,
+            DmaPtrIncrement::NoIncr,
+            DmaPtrIncrement::Incr8Bit,
+            reinterpret_cast<void*>(this),
+            [] (const uint8_t* src, uint8_t* dst, size_t len, void* inst) noexcept -> void {
+                I2cMaster* m = reinterpret_cast<I2cMaster*>(inst);
+                m->rx_dma_done();
+            }
+        });
+
+        if (ret != Err::Ok)
+            return ret;
+    }
+
     // setup was successful, enable the module
     usci.reg().ctlw0.modify(uscibregs::ctlw0::swrst.value(0));
 
@@ -57,12 +97,39 @@ Err I2cMaster::init(const Cs& clk) noexcept
     return  Err::Ok;
 }
 
+Err I2cMaster::init(const Cs& clk, EventTimer& timer) noexcept
+{
+    if (initialized)
+        return Err::AlreadyInitialized;
+
+    for (Backoff& b : backoffs) {
+        std::expected<EventTimer::Event, Err> ev = timer.register_event(BACKOFF_MS, &b,
+            [] (void* cookie) noexcept -> void {
+                // the device may be addressed again
+                Backoff* b = reinterpret_cast<Backoff*>(cookie);
+                b->master->submit();
+            }, EventTimer::EventMode::OneShot);
+
+        if (!ev.has_value())
+            return ev.error();
+
+        b.master = this;
+        b.ev = std::move(ev.value());
+    }
+
+    this->timer = &timer;
+
+    return init(clk);
+}
+
 Err I2cMaster::write(uint16_t addr,
         std::span<const uint8_t> data,
         void* cookie,
         void (*finished)(I2cJobType type, I2cErr err, std::span<uint8_t> rxbuf, void* cookie),
-        bool addr_10bit) noexcept
+        bool addr_10bit,
+        I2cPriority prio) noexcept
 {
+
     if (addr_10bit && (addr > 1023))
         return Err::OutOfRange;
     else if (addr > 127)
@@ -74,53 +141,34 @@ Err I2cMaster::write(uint16_t addr,
     if (!initialized)
         return Err::NotInitialized;
 
-    if (jobfifo.is_full())
-        return Err::NoMem;
-
-    jobfifo.emplace(
-        I2cJobType::Write, addr, addr_10bit, data, std::span<uint8_t>{}, cookie, finished);
-
-    if (transmitting.load(std::memory_order_relaxed))
-        return Err::Ok;
-
-    transmitting.store(true, std::memory_order_release);
-
-    start_job(addr, addr_10bit, false, static_cast<uint16_t>(data.size()));
-
-    return Err::Ok;
+    return enqueue(prio,
+        I2cJob{I2cJobType::Write, addr, addr_10bit, data, std::span<uint8_t>{}, cookie, finished});
 }
 
 Err I2cMaster::read(uint16_t addr,
         std::span<uint8_t> buffer,
         void* cookie,
         void (*finished)(I2cJobType type, I2cErr err, std::span<uint8_t> rxbuf, void* cookie),
-        bool addr_10bit) noexcept
+        bool addr_10bit,
+        I2cPriority prio) noexcept
 {
+
     if (addr_10bit && (addr > 1023))
         return Err::OutOfRange;
     else if (addr > 127)
         return Err::OutOfRange;
 
+    if (buffer.empty())
+        return Err::Empty;
+
     if (buffer.size() > 0xFFFF)
         return Err::Overflow;
 
     if (!initialized)
         return Err::NotInitialized;
 
-    if (jobfifo.is_full())
-        return Err::NoMem;
-
-    jobfifo.emplace(
-        I2cJobType::Read, addr, addr_10bit, std::span<uint8_t>{}, buffer, cookie, finished);
-
-    if (transmitting.load(std::memory_order_relaxed))
-        return Err::Ok;
-
-    transmitting.store(true, std::memory_order_release);
-
-    start_job(addr, addr_10bit, true, static_cast<uint16_t>(buffer.size()));
-
-    return Err::Ok;
+    return enqueue(prio,
+        I2cJob{I2cJobType::Read, addr, addr_10bit, std::span<uint8_t>{}, buffer, cookie, finished});
 }
 
 Err I2cMaster::write_read(uint16_t addr,
@@ -128,7 +176,8 @@ Err I2cMaster::write_read(uint16_t addr,
         std::span<uint8_t> rxbuf,
         void* cookie,
         void (*finished)(I2cJobType type, I2cErr err, std::span<uint8_t> rxbuf, void* cookie),
-        bool addr_10bit) noexcept
+        bool addr_10bit,
+        I2cPriority prio) noexcept
 {
     uint32_t txrx_bytes;
 
@@ -137,6 +186,9 @@ Err I2cMaster::write_read(uint16_t addr,
     else if (addr > 127)
         return Err::OutOfRange;
 
+    if (txbuf.empty() || rxbuf.empty())
+        return Err::Empty;
+
     txrx_bytes = txbuf.size() + rxbuf.size();
     if (txrx_bytes > 0xFFFF)
         return Err::Overflow;
@@ -144,23 +196,280 @@ Err I2cMaster::write_read(uint16_t addr,
     if (!initialized)
         return Err::NotInitialized;
 
-    if (jobfifo.is_full())
-        return Err::NoMem;
+    return enqueue(prio,
+        I2cJob{I2cJobType::WriteRead, addr, addr_10bit, txbuf, rxbuf, cookie, finished});
+}
+
+Err I2cMaster::scan(void* cookie, I2cScanCallback done) noexcept
+{
+    uint32_t primask;
+    Err ret;
+
+    if (!initialized)
+        return Err::NotInitialized;
+
+    primask = cm4f::disable_irq();
+    if (scan_done) {
+        cm4f::restore_irq(primask);
+        return Err::Busy;
+    }
+
+    found = Bitmap<128>{};
+    scan_addr = SCAN_FIRST;
+    scan_cookie = cookie;
+    scan_done = done;
+    cm4f::restore_irq(primask);
+
+    ret = probe();
+
+    if (ret != Err::Ok)
+        scan_done = nullptr;
+
+    return ret;
+}
+
+Err I2cMaster::recover(const Cs& clk, const Dwt& dwt, const Pin& scl, const Pin& sda) noexcept
+{
+    uint32_t half_period = clk.m_clk() / (2 * static_cast<uint32_t>(speed));
+    bool released;
+
+    // busy-waits for the given number of core clock cycles
+    auto wait = [&dwt] (uint32_t cycles) {
+        uint32_t start = dwt.cycles();
+
+        while ((dwt.cycles() - start) < cycles) {}
+    };
+
+    if (transmitting.load(std::memory_order_acquire))
+        return Err::Busy;
+
+    // the USCI releases the pins and forgets the aborted transfer
+    usci.reg().ctlw0.modify(uscibregs::ctlw0::swrst.value(1));
+
+    // SDA is only sensed while clocking since the device drives it. SCL is driven push-pull, there
+    // is no other master which could stretch the clock (see init()).
+    sda.make_input();
+    sda.set_pull_mode(PullMode::PullUp);
+    scl.set_high();
+    scl.make_output();
+    wait(half_period);
+
+    // the device shifts out the rest of its byte, SDA is released at the latest by the (missing)
+    // acknowledge of the 9th clock
+    for (uint8_t i = 0; (i < RECOVERY_CLOCKS) && !sda.read(); i++) {
+        scl.set_low();
+        wait(half_period);
+        scl.set_high();
+        wait(half_period);
+    }
 
-    jobfifo.emplace(I2cJobType::WriteRead, addr, addr_10bit, txbuf, rxbuf, cookie, finished);
+    released = sda.read();
+
+    if (released) {
+        // STOP condition: SDA rises while SCL is high
+        scl.set_low();
+        sda.set_low();
+        sda.make_output();
+        wait(half_period);
+        scl.set_high();
+        wait(half_period);
+        sda.make_input();
+        sda.set_pull_mode(PullMode::PullUp);
+        wait(half_period);
+    }
 
-    if (transmitting.load(std::memory_order_relaxed))
-        return Err::Ok;
+    scl.enable_primary_function();
+    sda.enable_primary_function();
 
-    transmitting.store(true, std::memory_order_release);
+    // the configuration survives the reset, an uninitialized USCI is set up by init()
+    if (initialized)
+        usci.reg().ctlw0.modify(uscibregs::ctlw0::swrst.value(0));
 
-    start_job(addr, addr_10bit, false, static_cast<uint16_t>(txrx_bytes));
+    return released ? Err::Ok : Err::Busy;
+}
+
+Err I2cMaster::enqueue(I2cPriority prio, const I2cJob& job) noexcept
+{
+    // the scan and the drivers on top of this one queue their next jobs from the job-callbacks,
+    // thus a queue may be fed from interrupt-context and thread-mode at the same time
+    uint32_t primask = cm4f::disable_irq();
+    Err ret = queues[static_cast<size_t>(prio)].push(job);
+    cm4f::restore_irq(primask);
+
+    if (ret != Err::Ok)
+        return ret;
+
+    submit();
 
     return Err::Ok;
 }
 
-void I2cMaster::start_job(uint16_t addr, bool addr_10bit, bool rx, uint16_t txrx_bytes) noexcept
+Err I2cMaster::probe() noexcept
+{
+    return write(scan_addr, std::span<const uint8_t>{}, this,
+        [] (I2cJobType type, I2cErr err, std::span<uint8_t> rxbuf, void* cookie) {
+            I2cMaster* m = reinterpret_cast<I2cMaster*>(cookie);
+            m->probe_next(err);
+        }, false, I2cPriority::Low);
+}
+
+void I2cMaster::probe_next(I2cErr err) noexcept
+{
+    I2cScanCallback done = scan_done;
+    Err ret = Err::Ok;
+
+    if (err == I2cErr::Ok)
+        found.set(scan_addr);
+
+    if (scan_addr < SCAN_LAST) {
+        scan_addr += 1;
+        ret = probe();
+
+        if (ret == Err::Ok)
+            return;
+    }
+
+    scan_done = nullptr;
+    done(ret, found, scan_cookie);
+}
+
+void I2cMaster::submit() noexcept
+{
+    uint32_t primask = cm4f::disable_irq();
+
+    if (!transmitting.load(std::memory_order_relaxed))
+        schedule();
+
+    cm4f::restore_irq(primask);
+}
+
+void I2cMaster::schedule() noexcept
 {
+    uint32_t primask = cm4f::disable_irq();
+
+    // The first job of the highest class whose device isn't backed off is started, the jobs of a
+    // backed off device are overtaken by the jobs of the other devices of the same class.
+    for (size_t i = 0; i < queues.size(); i++) {
+        std::expected<std::reference_wrapper<I2cJob>, Err> job = queues[i].peek_ref();
+
+        if (!job.has_value())
+            continue;
+
+        if (backed_off(job.value().get().addr) && !pick_ready(queues[i]))
+            continue;
+
+        active = static_cast<uint8_t>(i);
+        transmitting.store(true, std::memory_order_release);
+        start_job(current());
+
+        cm4f::restore_irq(primask);
+        return;
+    }
+
+    // no pending jobs (or all of them wait for their devices)
+    transmitting.store(false, std::memory_order_release);
+
+    cm4f::restore_irq(primask);
+}
+
+bool I2cMaster::pick_ready(Fifo<I2cJob, QUEUE_LEN>& queue) noexcept
+{
+    std::array<I2cJob, QUEUE_LEN> jobs;
+    size_t cnt = queue.pop_n(jobs);
+    size_t idx = 0;
+
+    while ((idx < cnt) && backed_off(jobs[idx].addr))
+        idx++;
+
+    // All jobs in front of the picked one belong to backed off devices, thus the jobs of each
+    // device keep their order.
+    if (idx < cnt)
+        std::rotate(jobs.begin(), jobs.begin() + idx, jobs.begin() + idx + 1);
+
+    queue.push_n(std::span<const I2cJob>{jobs.data(), cnt});
+    return idx < cnt;
+}
+
+bool I2cMaster::backed_off(uint16_t addr) const noexcept
+{
+    for (const Backoff& b : backoffs) {
+        if ((b.failures > 0) && (b.addr == addr))
+            return timer->is_running(b.ev).value_or(false);
+    }
+
+    return false;
+}
+
+bool I2cMaster::back_off(uint16_t addr) noexcept
+{
+    Backoff* entry = nullptr;
+    uint32_t interval = BACKOFF_MS;
+
+    if (!timer)
+        return false;
+
+    for (Backoff& b : backoffs) {
+        if ((b.failures > 0) && (b.addr == addr)) {
+            entry = &b;
+            break;
+        }
+    }
+
+    // take a free entry or the one of a device which isn't backed off anymore
+    for (size_t i = 0; (i < backoffs.size()) && !entry; i++) {
+        if (backoffs[i].failures == 0)
+            entry = &backoffs[i];
+    }
+
+    for (size_t i = 0; (i < backoffs.size()) && !entry; i++) {
+        if (!timer->is_running(backoffs[i].ev).value_or(true))
+            entry = &backoffs[i];
+    }
+
+    if (!entry)
+        return false;
+
+    if (entry->addr != addr)
+        entry->failures = 0;
+
+    for (uint8_t i = 0; (i < entry->failures) && (interval < MAX_BACKOFF_MS); i++)
+        interval *= 2;
+
+    if (interval > MAX_BACKOFF_MS)
+        interval = MAX_BACKOFF_MS;
+
+    entry->addr = addr;
+    if (entry->failures < UINT8_MAX)
+        entry->failures += 1;
+
+    timer->set_interval(entry->ev, interval);
+    timer->start_event(entry->ev);
+
+    return true;
+}
+
+void I2cMaster::clear_backoff(uint16_t addr) noexcept
+{
+    for (Backoff& b : backoffs) {
+        if (b.addr == addr)
+            b.failures = 0;
+    }
+}
+
+void I2cMaster::start_job(I2cJob& job) noexcept
+{
+    bool rx = job.type == I2cJobType::Read;
+
+    if (job.is_probe()) {
+        start_probe(job);
+        return;
+    }
+
+    if (tx_dma) {
+        start_dma_job(job);
+        return;
+    }
+
     // set the required interrupt-flags
     usci.reg().ie.set(
         uscibregs::ifg::nackifg.value(1) +                         // set NACK int.
@@ -171,15 +480,15 @@ void I2cMaster::start_job(uint16_t addr, bool addr_10bit, bool rx, uint16_t txrx
     );
 
     // set slave-address
-    usci.reg().i2csa.set(addr);
+    usci.reg().i2csa.set(job.addr);
 
     // number of bytes that will be written AND read
-    usci.reg().tbcnt.set(txrx_bytes);
+    usci.reg().tbcnt.set(static_cast<uint16_t>(job.txbuf.size() + job.rxbuf.size()));
 
     // setup the job-config
     usci.reg().ctlw0.modify(
         // set addressing-mode (7- or 10-bit)
-        uscibregs::ctlw0::sla10.value(static_cast<uint16_t>(addr_10bit)) +
+        uscibregs::ctlw0::sla10.value(static_cast<uint16_t>(job.addr_10bit)) +
         // set transmitter / receiver mode
         uscibregs::ctlw0::tr.value(static_cast<uint16_t>(!rx)) +
         // send out start-condition
@@ -187,66 +496,233 @@ void I2cMaster::start_job(uint16_t addr, bool addr_10bit, bool rx, uint16_t txrx
     );
 }
 
+void I2cMaster::start_dma_job(I2cJob& job) noexcept
+{
+    const uint8_t* rxreg = reinterpret_cast<const uint8_t*>(&usci.reg().rxbuf);
+    uint8_t* txreg = reinterpret_cast<uint8_t*>(&usci.reg().txbuf);
+    bool rx = job.type == I2cJobType::Read;
+
+    dma_seq = job_seq;
+
+    // TXIFG0 and RXIFG0 trigger the DMA, thus no stale flag of the previous job must be left
+    usci.reg().ifg.set(0);
+
+    usci.reg().ie.set(
+        uscibregs::ifg::nackifg.value(1) +  // enable NACK interrupt
+        uscibregs::ifg::alifg.value(1) +    // enable arbitration lost interrupt
+        uscibregs::ifg::cltoifg.value(1) +  // enable 'clock-low-timeout' interrupt
+        uscibregs::ifg::stpifg.value(1)     // enable stop-condition interrupt
+    );
+
+    usci.reg().i2csa.set(job.addr);
+
+    // The byte counter restarts with the repeated START, thus the STOP condition of a write_read is
+    // requested manually before its last byte. A byte counter of 0 disables the automatic STOP.
+    if (job.type == I2cJobType::WriteRead)
+        usci.reg().tbcnt.set(0);
+    else
+        usci.reg().tbcnt.set(static_cast<uint16_t>(rx ? job.rxbuf.size() : job.txbuf.size()));
+
+    // The last received byte is always fetched by the stop-condition interrupt, so the DMA never
+    // races with the end of the job.
+    if (!rx)
+        tx_dma->transfer_mem_to_periph(job.txbuf.data(), txreg, job.txbuf.size());
+    else if (job.rxbuf.size() > 1)
+        rx_dma->transfer_periph_to_mem(rxreg, job.rxbuf.data(), job.rxbuf.size() - 1);
+
+    usci.reg().ctlw0.modify(
+        uscibregs::ctlw0::sla10.value(static_cast<uint16_t>(job.addr_10bit)) +
+        uscibregs::ctlw0::tr.value(static_cast<uint16_t>(!rx)) +
+        uscibregs::ctlw0::txstt.value(1)
+    );
+}
+
+void I2cMaster::start_probe(I2cJob& job) noexcept
+{
+    // no stale flag of the previous job must be taken for the end of the probe
+    usci.reg().ifg.set(0);
+
+    // no byte is transferred, also not by the DMA
+    usci.reg().ie.set(
+        uscibregs::ifg::nackifg.value(1) +  // enable NACK interrupt
+        uscibregs::ifg::alifg.value(1) +    // enable arbitration lost interrupt
+        uscibregs::ifg::cltoifg.value(1) +  // enable 'clock-low-timeout' interrupt
+        uscibregs::ifg::stpifg.value(1)     // enable stop-condition interrupt
+    );
+
+    usci.reg().i2csa.set(job.addr);
+    usci.reg().tbcnt.set(0);
+
+    job.nacked = false;
+
+    // The STOP condition is requested along with the START, it follows the acknowledge of the
+    // address or its NACK.
+    usci.reg().ctlw0.modify(
+        uscibregs::ctlw0::sla10.value(static_cast<uint16_t>(job.addr_10bit)) +
+        uscibregs::ctlw0::tr.value(1) +
+        uscibregs::ctlw0::txstt.value(1) +
+        uscibregs::ctlw0::txstp.value(1)
+    );
+}
+
+void I2cMaster::finish_job(I2cErr err) noexcept
+{
+    I2cJob& job = current();
+
+    // a completion of the DMA which wasn't served yet belongs to this job
+    job_seq++;
+    if (tx_dma) {
+        tx_dma->cancel();
+        rx_dma->cancel();
+    }
+
+    // the device is reachable (again)
+    if (err == I2cErr::Ok)
+        clear_backoff(job.addr);
+
+    // invoke the job-callback (if registered)
+    if (job.finished)
+        job.finished(job.type, err, job.rxbuf, job.cookie);
+
+    // drop job from its queue and continue with the next one (if any)
+    queues[active].pop();
+    schedule();
+}
+
+void I2cMaster::tx_dma_done() noexcept
+{
+    // The USCI-interrupt is served before the one of the DMA at the same priority, thus the job
+    // may have finished already and the completion must not touch the next job.
+    if (!transmitting.load(std::memory_order_acquire) || (dma_seq != job_seq))
+        return;
+
+    I2cJob& job = current();
+
+    // The write-part of a write_read is completely handed over to the USCI, TXIFG0 signals that
+    // its last byte is shifted out and the repeated START can be issued.
+    if (job.type == I2cJobType::WriteRead)
+        usci.reg().ie.modify(uscibregs::ifg::txifg0.value(1));
+}
+
+void I2cMaster::rx_dma_done() noexcept
+{
+    // the job may have finished already, see tx_dma_done()
+    if (!transmitting.load(std::memory_order_acquire) || (dma_seq != job_seq))
+        return;
+
+    I2cJob& job = current();
+
+    // The last byte of the read-part of a write_read is currently received, thus it is the right
+    // time to request the stop-condition.
+    if (job.type == I2cJobType::WriteRead)
+        usci.reg().ctlw0.modify(uscibregs::ctlw0::txstp.value(1));
+}
+
 void I2cMaster::handle_interrupt() noexcept
 {
+    ScopedProbe probe{dwt, profile};
     uint16_t iflags = usci.reg().ifg.get();
-    usci.reg().ifg.set(0);
 
-    I2cJob& job = jobfifo.peek_ref().value().get();
+    if (tx_dma) {
+        // TXIFG0 and RXIFG0 are the DMA-triggers, thus only the events are cleared
+        usci.reg().ifg.modify(
+            uscibregs::ifg::nackifg.value(0) +
+            uscibregs::ifg::alifg.value(0) +
+            uscibregs::ifg::cltoifg.value(0) +
+            uscibregs::ifg::stpifg.value(0)
+        );
+    } else {
+        usci.reg().ifg.set(0);
+    }
+
+    I2cJob& job = current();
 
     auto handle_err = [&] (I2cErr err) {
-        if (job.retry_cnt >= I2cJob::MAX_RETRIES) {
-            // invoke callback
-            if (job.finished)
-                job.finished(job.type, err, job.rxbuf, job.cookie);
-
-            // drop failed job from FIFO
-            this->jobfifo.pop();
-            if (this->jobfifo.is_empty())
-                return;
-
-            I2cJob& new_job = this->jobfifo.peek_ref().value().get();
-            uint16_t txrx_bytes =
-                static_cast<uint16_t>(new_job.txbuf.size() + new_job.rxbuf.size());
-            this->start_job(
-                new_job.addr, new_job.addr_10bit, new_job.type == I2cJobType::Read, txrx_bytes);
+        if (this->tx_dma) {
+            // the USCI doesn't request any further bytes of the aborted transfer
+            this->tx_dma->cancel();
+            this->rx_dma->cancel();
+        }
+        this->job_seq++;
+
+        // The device is backed off even after the last retry, so its next jobs wait as well. A
+        // probe is expected to fail, thus it neither backs off nor is retried.
+        bool waiting = !job.is_probe() && this->back_off(job.addr);
+        bool failed;
+
+        job.buf_idx = 0;
+        job.retry_cnt += 1;
+        failed = job.is_probe() || job.failed();
+
+        if (!failed && !waiting) {
+            // retried right away with a repeated START
+            this->start_job(job);
+        } else if (err == I2cErr::Nack) {
+            // The device holds the bus after the NACK until a STOP or a repeated START. The bus
+            // is released before the job fails or waits for its device, see the STOP-interrupt.
+            job.nacked = true;
+            this->usci.reg().ie.set(
+                uscibregs::ifg::nackifg.value(1) +  // enable NACK interrupt
+                uscibregs::ifg::alifg.value(1) +    // enable arbitration lost interrupt
+                uscibregs::ifg::cltoifg.value(1) +  // enable 'clock-low-timeout' interrupt
+                uscibregs::ifg::stpifg.value(1)     // enable stop-condition interrupt
+            );
+            this->usci.reg().ctlw0.modify(uscibregs::ctlw0::txstp.value(1));
+        } else if (failed) {
+            // invoke callback and drop failed job from its queue
+            this->finish_job(err);
         } else {
-            uint16_t txrx_bytes = static_cast<uint16_t>(job.txbuf.size() + job.rxbuf.size());
-
-            job.buf_idx = 0;
-            job.retry_cnt += 1;
-            this->start_job(job.addr, job.addr_10bit, job.type == I2cJobType::Read, txrx_bytes);
+            // a backed off job stays queued while the jobs of the other devices go on
+            this->schedule();
         }
     };
 
-    if (iflags & uscibregs::ifg::nackifg.mask()) {
+    if (job.is_probe() && (iflags & uscibregs::ifg::nackifg.mask())) {
+        // the requested STOP condition follows the NACK, the bus is free once it was sent
+        job.nacked = true;
+
+        if (iflags & uscibregs::ifg::stpifg.mask())
+            finish_job(I2cErr::Nack);
+    } else if (iflags & uscibregs::ifg::nackifg.mask()) {
         handle_err(I2cErr::Nack);
     } else if (iflags & uscibregs::ifg::alifg.mask()) {
         handle_err(I2cErr::ArbitrationLost);
     } else if (iflags & uscibregs::ifg::cltoifg.mask()) {
         handle_err(I2cErr::ClockLowTimeout);
+    } else if ((iflags & uscibregs::ifg::stpifg.mask()) && job.nacked && !job.is_probe()) {
+        // the bus was released after a NACK, the job either failed or waits for its device
+        job.nacked = false;
+
+        if (job.failed())
+            finish_job(I2cErr::Nack);
+        else
+            schedule();
     } else if (iflags & uscibregs::ifg::stpifg.mask()) {
         // stop-condition interrupt, which means our job (no matter what type) has finished
 
-        // disable all interrupt flags, in case we don't have any pending jobs
-        usci.reg().ifg.set(0);
-
-        // invoke the job-callback (if registered)
-        if (job.finished)
-            job.finished(job.type, I2cErr::Ok, job.rxbuf, job.cookie);
-
-        // drop job from FIFO
-        jobfifo.pop();
-
-        // check if any jobs are pending
-        if (jobfifo.is_empty()) {
-            // no pending jobs
-            transmitting.store(false, std::memory_order_release);
-        } else {
-            I2cJob& job = jobfifo.peek_ref().value().get();
-            start_job(job.addr, job.addr_10bit, job.type ==I2cJobType::Read,
-                static_cast<uint16_t>(job.txbuf.size() + job.rxbuf.size()));
-        }
+        // the DMA leaves the last received byte to us
+        if (tx_dma && !job.rxbuf.empty())
+            job.rxbuf.back() = static_cast<uint8_t>(usci.reg().rxbuf.get());
+
+        finish_job(job.nacked ? I2cErr::Nack : I2cErr::Ok);
+    } else if (tx_dma) {
+        // The only byte-interrupt of the DMA-mode: the write-part of a write_read has finished
+        // -> switch to the read-part.
+        const uint8_t* rxreg = reinterpret_cast<const uint8_t*>(&usci.reg().rxbuf);
+        bool single = job.rxbuf.size() == 1;
+
+        usci.reg().ie.modify(uscibregs::ifg::txifg0.value(0));
+        usci.reg().ifg.modify(uscibregs::ifg::txifg0.value(0));
+
+        if (!single)
+            rx_dma->transfer_periph_to_mem(rxreg, job.rxbuf.data(), job.rxbuf.size() - 1);
+
+        usci.reg().ctlw0.modify(
+            uscibregs::ctlw0::tr.value(0) +     // switch from transmitter to receiver
+            uscibregs::ctlw0::txstt.value(1) +  // issue the repeated-start-condition
+            // a single byte is already the last one
+            uscibregs::ctlw0::txstp.value(static_cast<uint16_t>(single))
+        );
     } else if (iflags & uscibregs::ifg::rxifg0.mask()) {
         // we know, that we are in receive-mode since the RX interrupt flag was set
 
@@ -303,27 +779,5 @@ void I2cMaster::handle_interrupt() noexcept
                 uscibregs::ctlw0::txstt.value(1)    // issue the repeated-start-condition
             );
         }
-    } else if (iflags & uscibregs::ifg::stpifg.mask()) {
-        // stop-condition interrupt, which means our job (no matter what type) has finished
-
-        // disable all interrupt flags, in case we don't have any pending jobs
-        usci.reg().ifg.set(0);
-
-        // invoke the job-callback (if registered)
-        if (job.finished)
-            job.finished(job.type, I2cErr::Ok, job.rxbuf, job.cookie);
-
-        // drop job from FIFO
-        jobfifo.pop();
-
-        // check if any jobs are pending
-        if (jobfifo.is_empty()) {
-            // no pending jobs
-            transmitting.store(false, std::memory_order_release);
-        } else {
-            I2cJob& job = jobfifo.peek_ref().value().get();
-            start_job(job.addr, job.addr_10bit, job.type ==I2cJobType::Read,
-                static_cast<uint16_t>(job.txbuf.size() + job.rxbuf.size()));
-        }
     }
 }
@@ -7,14 +7,21 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <cstdint>
 #include <span>
 #include <unistd.h>
 
+#include "bitmap.h"
 #include "cs.h"
+#include "dma.h"
+#include "dwt.h"
 #include "err.h"
+#include "event_timer.h"
 #include "fifo.h"
+#include "pin.h"
+#include "profile.h"
 #include "usci.h"
 #include "uscib_regs.h"
 
@@ -30,39 +37,104 @@ enum class I2cSpeed : uint32_t {
     KHz400 = 400'000,
 };
 
+// The jobs are queued per priority class, a job of a higher class overtakes all queued jobs of the
+// lower ones (but not the one which is currently on the bus).
+enum class I2cPriority : uint8_t {
+    High,   // latency-critical jobs, e.g. reading an IMU
+    Normal,
+    Low,    // bulk transfers, e.g. writing an EEPROM
+};
+
 enum class I2cJobType {
     Write,
     Read,
     WriteRead,
 };
 
+// 'found' contains the 7-bit addresses which acknowledged their probe. 'err' is Err::NoMem if the
+// scan was aborted since a probe didn't fit into the queue of the Low class.
+typedef void (*I2cScanCallback)(Err err, const Bitmap<128>& found, void* cookie) noexcept;
+
 class I2cMaster {
 public:
     constexpr explicit I2cMaster(UsciB& usci, I2cSpeed speed)
-        : usci(usci), speed(speed), initialized(false), transmitting(false), jobfifo() {}
+        : usci(usci), speed(speed), tx_dma(nullptr), rx_dma(nullptr), tx_dma_src(0),
+        rx_dma_src(0), initialized(false), transmitting(false), active(0), job_seq(0), dma_seq(0),
+        timer(nullptr), backoffs(), queues(), found(), scan_addr(0), scan_cookie(nullptr),
+        scan_done(nullptr), dwt(nullptr), profile("i2c_irq") {}
+
+    // The data bytes are moved by the two DMA-channels instead of one interrupt per byte. The CPU
+    // is only interrupted by the STOP condition, the errors and the end of the DMA transfers, a
+    // write_read additionally by its repeated START. The sources have to select the triggers
+    // TXIFG0 and RXIFG0 of the given USCI, see the mapping in dma.h.
+    constexpr explicit I2cMaster(UsciB& usci, Dma& dma, I2cSpeed speed, uint8_t tx_dma_chan,
+        uint8_t rx_dma_chan, uint8_t tx_dma_src, uint8_t rx_dma_src) noexcept
+        : usci(usci), speed(speed), tx_dma(&dma[tx_dma_chan]), rx_dma(&dma[rx_dma_chan]),
+        tx_dma_src(tx_dma_src), rx_dma_src(rx_dma_src), initialized(false), transmitting(false),
+        active(0), job_seq(0), dma_seq(0), timer(nullptr), backoffs(), queues(), found(),
+        scan_addr(0), scan_cookie(nullptr), scan_done(nullptr), dwt(nullptr), profile("i2c_irq") {}
 
     Err init(const Cs& clk) noexcept;
 
+    // A failed job is retried immediately unless an EventTimer is given. With the timer the address
+    // of the failed job is backed off for BACKOFF_MS, doubled with every further failure up to
+    // MAX_BACKOFF_MS, while the jobs of the other devices go on. The timer has to be initialized.
+    Err init(const Cs& clk, EventTimer& timer) noexcept;
+
+    // The jobs may be queued from thread-mode and from interrupt-context (e.g. by the callback of
+    // the previous job) at the same time. A write without data only addresses the device (a probe),
+    // it isn't retried and doesn't back off the device if it isn't acknowledged.
     Err write(uint16_t addr,
         std::span<const uint8_t> data,
         void* cookie,
         void (*finished)(I2cJobType type, I2cErr err, std::span<uint8_t> rxbuf, void* cookie),
-        bool addr_10bit = false) noexcept;
+        bool addr_10bit = false,
+        I2cPriority prio = I2cPriority::Normal) noexcept;
 
     Err read(uint16_t addr,
         std::span<uint8_t> buffer,
         void* cookie,
         void (*finished)(I2cJobType type, I2cErr err, std::span<uint8_t> rxbuf, void* cookie),
-        bool addr_10bit = false) noexcept;
+        bool addr_10bit = false,
+        I2cPriority prio = I2cPriority::Normal) noexcept;
 
     Err write_read(uint16_t addr,
         std::span<const uint8_t> txbuf,
         std::span<uint8_t> rxbuf,
         void* cookie,
         void (*finished)(I2cJobType type, I2cErr err, std::span<uint8_t> rxbuf, void* cookie),
-        bool addr_10bit = false) noexcept;
+        bool addr_10bit = false,
+        I2cPriority prio = I2cPriority::Normal) noexcept;
+
+    // Probes the 7-bit addresses SCAN_FIRST to SCAN_LAST (the others are reserved) one after
+    // another with zero-length writes of the Low class, thus the jobs of the other classes overtake
+    // the scan. 'done' is invoked from interrupt-context once all addresses were probed.
+    Err scan(void* cookie, I2cScanCallback done) noexcept;
+
+    // Frees a bus whose SDA is held low by a device which was interrupted within a transfer, e.g.
+    // by a brown-out of the master. The USCI is held in reset while SCL is clocked as GPIO up to
+    // RECOVERY_CLOCKS times until the device releases SDA, followed by a STOP condition.
+    // Afterwards the pins are handed back to the USCI (the I2C-pins of all eUSCI_B are primary
+    // functions). This may be called before init() or while no job is on the bus, it blocks for
+    // about RECOVERY_CLOCKS + 2 SCL-periods and needs the enabled cycle counter of the DWT.
+    // Returns Err::Busy if SDA is still held low.
+    Err recover(const Cs& clk, const Dwt& dwt, const Pin& scl, const Pin& sda) noexcept;
+
+    // Measures the interrupt handler from now on, the cycle counter of the DWT has to be enabled.
+    // The DMA-callbacks are measured by the channels, see Dma::enable_profiling().
+    void enable_profiling(const Dwt& dwt) noexcept { this->dwt = &dwt; }
+    const ProfileSection& irq_profile() const noexcept { return profile; }
+
+    static constexpr uint16_t SCAN_FIRST = 0x08;
+    static constexpr uint16_t SCAN_LAST = 0x77;
+    static constexpr uint8_t RECOVERY_CLOCKS = 9;
+    static constexpr uint32_t BACKOFF_MS = 1;
+    static constexpr uint32_t MAX_BACKOFF_MS = 64;
 
 private:
+    static constexpr size_t MAX_BACKOFFS = 4;
+    static constexpr size_t QUEUE_LEN = 8;
+
     struct I2cJob {
         static constexpr uint8_t MAX_RETRIES = 3;
 
@@ -74,6 +146,7 @@ private:
 
         uint16_t buf_idx;
         uint8_t retry_cnt;
+        bool nacked; // the job goes on with the STOP condition which follows its NACK
 
         void* cookie;
         void (*finished)(I2cJobType type, I2cErr err, std::span<uint8_t> rxbuf, void* cookie);
@@ -83,19 +156,70 @@ private:
             void (*finished)(I2cJobType type, I2cErr err, std::span<uint8_t> rxbuf, void* cookie))
             noexcept
             : type(type), addr(addr), txbuf(txbuf), rxbuf(rxbuf), addr_10bit(addr_10bit),
-            buf_idx(0), retry_cnt(0), cookie(cookie), finished(finished) {}
+            buf_idx(0), retry_cnt(0), nacked(false), cookie(cookie), finished(finished) {}
 
         constexpr explicit I2cJob() noexcept : type(I2cJobType::Write), addr(0), txbuf(), rxbuf(),
-            addr_10bit(false), buf_idx(0), retry_cnt(0), cookie(nullptr), finished(nullptr) {}
+            addr_10bit(false), buf_idx(0), retry_cnt(0), nacked(false), cookie(nullptr),
+            finished(nullptr) {}
+
+        constexpr bool is_probe() const noexcept
+        {
+            return (type == I2cJobType::Write) && txbuf.empty();
+        }
+
+        constexpr bool failed() const noexcept
+        {
+            return retry_cnt > MAX_RETRIES;
+        }
+    };
+
+    // a device which failed recently, a free entry has no failures
+    struct Backoff {
+        I2cMaster* master;
+        uint16_t addr;
+        uint8_t failures;
+        EventTimer::Event ev; // running while the device is backed off
+
+        constexpr explicit Backoff() noexcept : master(nullptr), addr(0), failures(0), ev() {}
     };
 
-    void start_job(uint16_t addr, bool addr_10bit, bool rx, uint16_t txrx_bytes) noexcept;
+    I2cJob& current() noexcept { return queues[active].peek_ref().value().get(); }
+    Err enqueue(I2cPriority prio, const I2cJob& job) noexcept;
+    void submit() noexcept;
+    void schedule() noexcept;
+    bool pick_ready(Fifo<I2cJob, QUEUE_LEN>& queue) noexcept;
+    bool backed_off(uint16_t addr) const noexcept;
+    bool back_off(uint16_t addr) noexcept;
+    void clear_backoff(uint16_t addr) noexcept;
+    void start_job(I2cJob& job) noexcept;
+    void start_dma_job(I2cJob& job) noexcept;
+    void start_probe(I2cJob& job) noexcept;
+    Err probe() noexcept;
+    void probe_next(I2cErr err) noexcept;
+    void finish_job(I2cErr err) noexcept;
     void handle_interrupt() noexcept;
+    void tx_dma_done() noexcept;
+    void rx_dma_done() noexcept;
 
     UsciB& usci;
     I2cSpeed speed;
+    DmaChannel* tx_dma; // nullptr if the bytes are transferred by the interrupt handler
+    DmaChannel* rx_dma;
+    uint8_t tx_dma_src;
+    uint8_t rx_dma_src;
     bool initialized;
     std::atomic<bool> transmitting;
-    Fifo<I2cJob, 16> jobfifo;
+    uint8_t active; // the queue whose first job is on the bus
+    uint8_t job_seq; // incremented whenever a job leaves the bus
+    uint8_t dma_seq; // the job_seq of the job the DMA-transfers were started for
+    EventTimer* timer;
+    std::array<Backoff, MAX_BACKOFFS> backoffs;
+    std::array<Fifo<I2cJob, QUEUE_LEN>, 3> queues; // one per I2cPriority
+    Bitmap<128> found;
+    uint16_t scan_addr;
+    void* scan_cookie;
+    I2cScanCallback scan_done; // nullptr if no scan is running
+    const Dwt* dwt; // nullptr if the interrupt handler isn't measured
+    ProfileSection profile;
 };
 
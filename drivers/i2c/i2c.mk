@@ -10,3 +10,6 @@ I2C_DIR = $(ROOT)/drivers/i2c
 INCLUDES += $(I2C_DIR)
 SRCS += $(I2C_DIR)/i2c.cpp
 
+# the backoff of failed devices is timed by the EventTimer
+DRIVERS += event_timer
+
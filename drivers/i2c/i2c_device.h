@@ -0,0 +1,378 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ *
+ * Register-oriented access to a single device behind an I2cMaster, e.g. a sensor with 8-bit
+ * register addresses which auto-increments the register pointer within a transfer.
+ *
+ * All written registers are kept in a shadow of the register file. Registers which were marked
+ * with set_cached() (usually the configuration registers) are read from the shadow once their
+ * value is known, such a read never touches the bus. Volatile registers like measurement data are
+ * always read from the device.
+ *
+ * Only one write of a device is handed over to the I2cMaster at a time. Registers which are written
+ * meanwhile are collected and adjacent ones are merged into a single burst as soon as the previous
+ * write has finished. write_regs() with 'flush' set to false only collects the registers, thus a
+ * driver can merge a whole read-modify-write sequence into one transfer. Reads from the device are
+ * held back until all collected and outstanding writes are written, so they always return the
+ * written values.
+ */
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <type_traits>
+
+#include "bitmap.h"
+#include "cm4f.h"
+#include "err.h"
+#include "i2c.h"
+#include "libc.h"
+
+enum class I2cByteOrder : uint8_t {
+    LittleEndian,
+    BigEndian,
+};
+
+// Invoked from interrupt-context, except for a read which is served from the shadow where it is
+// invoked directly by read_regs(). 'reg' is the first register of the transfer, 'data' contains the
+// read registers or the written burst (which may contain more registers than a single write).
+typedef void (*I2cDeviceCallback)(I2cJobType type, I2cErr err, uint8_t reg,
+    std::span<uint8_t> data, void* cookie) noexcept;
+
+template<size_t N = 256>
+class I2cDevice {
+    static_assert((N > 0) && (N <= 256), "I2cDevice: the registers are addressed with 8 bits");
+public:
+    static constexpr size_t MAX_BURST = 16;
+    static constexpr size_t MAX_READS = 8;
+
+    constexpr explicit I2cDevice(I2cMaster& i2c, uint16_t addr, I2cByteOrder order, void* cookie,
+        I2cDeviceCallback cb, I2cPriority prio = I2cPriority::Normal) noexcept
+        : i2c(i2c), addr(addr), order(order), prio(prio), cookie(cookie), cb(cb), shadow(),
+        cached(), valid(), dirty(), burst(), burst_len(0), writing(false), reads(), rd_head(0),
+        rd_issued(0), rd_tail(0) {}
+
+    // Marks the given registers as cacheable, reads of them are served from the shadow as soon as
+    // their values are known.
+    Err set_cached(uint8_t reg, size_t cnt) noexcept
+    {
+        if ((reg + cnt) > N)
+            return Err::OutOfRange;
+
+        for (size_t i = reg; i < (reg + cnt); i++)
+            cached.set(i);
+
+        return Err::Ok;
+    }
+
+    // Forgets all cached values, e.g. after a reset of the device.
+    void invalidate() noexcept
+    {
+        uint32_t primask = cm4f::disable_irq();
+        valid = Bitmap<REGS>{};
+        cm4f::restore_irq(primask);
+    }
+
+    Err read_regs(uint8_t reg, std::span<uint8_t> buf) noexcept
+    {
+        uint32_t primask;
+        Err ret = Err::Ok;
+
+        if (buf.empty())
+            return Err::Empty;
+
+        if ((reg + buf.size()) > N)
+            return Err::OutOfRange;
+
+        if (is_cached(reg, buf.size())) {
+            libc::memcpy(buf.data(), &shadow[reg], buf.size());
+            cb(I2cJobType::Read, I2cErr::Ok, reg, buf, cookie);
+            return Err::Ok;
+        }
+
+        primask = cm4f::disable_irq();
+        if ((rd_head - rd_tail) == MAX_READS) {
+            ret = Err::NoMem;
+        } else {
+            reads[rd_head % MAX_READS] = RegRead{reg, buf};
+            rd_head++;
+
+            // collected registers are written before
+            if (!writing)
+                ret = write_burst();
+
+            // A read which is neither handed over nor held back by a write isn't issued by anyone,
+            // thus it is dropped and the caller has to try again.
+            if ((rd_issued != rd_head) && !writing) {
+                rd_head--;
+                if (ret == Err::Ok)
+                    ret = Err::NoMem;
+            }
+        }
+        cm4f::restore_irq(primask);
+
+        return ret;
+    }
+
+    Err write_regs(uint8_t reg, std::span<const uint8_t> data, bool flush = true) noexcept
+    {
+        uint32_t primask;
+        Err ret = Err::Ok;
+
+        if (data.empty())
+            return Err::Empty;
+
+        if ((reg + data.size()) > N)
+            return Err::OutOfRange;
+
+        primask = cm4f::disable_irq();
+        libc::memcpy(&shadow[reg], data.data(), data.size());
+        for (size_t i = reg; i < (reg + data.size()); i++) {
+            dirty.set(i);
+            valid.set(i);
+        }
+
+        if (flush && !writing)
+            ret = write_burst();
+        cm4f::restore_irq(primask);
+
+        return ret;
+    }
+
+    // Writes all registers which were collected by write_regs() without flushing.
+    Err flush() noexcept
+    {
+        uint32_t primask;
+        Err ret = Err::Ok;
+
+        primask = cm4f::disable_irq();
+        if (!writing)
+            ret = write_burst();
+        cm4f::restore_irq(primask);
+
+        return ret;
+    }
+
+    template<std::integral T>
+    Err write_reg(uint8_t reg, T val, bool flush = true) noexcept
+    {
+        std::array<uint8_t, sizeof(T)> data;
+        std::make_unsigned_t<T> v = static_cast<std::make_unsigned_t<T>>(val);
+
+        for (size_t i = 0; i < sizeof(T); i++) {
+            size_t idx = (order == I2cByteOrder::BigEndian) ? (sizeof(T) - 1 - i) : i;
+            data[idx] = static_cast<uint8_t>(v >> (i * 8));
+        }
+
+        return write_regs(reg, std::span<const uint8_t>{data}, flush);
+    }
+
+    // Reads the value of cacheable registers from the shadow, fails with Err::Empty if it isn't
+    // known yet.
+    template<std::integral T>
+    std::expected<T, Err> cached_reg(uint8_t reg) const noexcept
+    {
+        if ((reg + sizeof(T)) > N)
+            return std::unexpected{Err::OutOfRange};
+
+        if (!is_cached(reg, sizeof(T)))
+            return std::unexpected{Err::Empty};
+
+        return std::expected<T, Err>{value<T>(std::span<const uint8_t>{&shadow[reg], sizeof(T)})};
+    }
+
+    // Sets the bits of 'mask' of a cacheable register to the ones of 'val' without reading it from
+    // the device.
+    Err modify_reg(uint8_t reg, uint8_t mask, uint8_t val, bool flush = true) noexcept
+    {
+        std::expected<uint8_t, Err> old = cached_reg<uint8_t>(reg);
+
+        if (!old.has_value())
+            return old.error();
+
+        return write_reg<uint8_t>(reg, static_cast<uint8_t>((old.value() & ~mask) | (val & mask)),
+            flush);
+    }
+
+    // Converts the registers read by read_regs() into a value with the byte order of the device.
+    template<std::integral T>
+    T value(std::span<const uint8_t> data) const noexcept
+    {
+        size_t n = (data.size() < sizeof(T)) ? data.size() : sizeof(T);
+        std::make_unsigned_t<T> v = 0;
+
+        for (size_t i = 0; i < n; i++) {
+            size_t idx = (order == I2cByteOrder::BigEndian) ? (n - 1 - i) : i;
+            v |= static_cast<std::make_unsigned_t<T>>(
+                static_cast<std::make_unsigned_t<T>>(data[idx]) << (i * 8));
+        }
+
+        return static_cast<T>(v);
+    }
+
+private:
+    static constexpr size_t REGS = std::bit_ceil(N);
+
+    struct RegRead {
+        uint8_t reg;
+        std::span<uint8_t> buf;
+    };
+
+    bool is_cached(uint8_t reg, size_t cnt) const noexcept
+    {
+        for (size_t i = reg; i < (reg + cnt); i++) {
+            if (!cached.test(i).value_or(false) || !valid.test(i).value_or(false))
+                return false;
+        }
+
+        return true;
+    }
+
+    // Hands the first run of adjacent dirty registers over to the I2cMaster, has to be called with
+    // disabled interrupts. Only the error of the write is returned, held back reads which can't be
+    // handed over yet are retried with the next call.
+    Err write_burst() noexcept
+    {
+        size_t first = N;
+        Err ret;
+
+        for (size_t i = 0; i < N; i++) {
+            if (dirty.test(i).value_or(false)) {
+                first = i;
+                break;
+            }
+        }
+
+        if (first == N) {
+            issue_reads();
+            return Err::Ok;
+        }
+
+        burst[0] = static_cast<uint8_t>(first);
+        burst_len = 0;
+        while (((first + burst_len) < N) && (burst_len < MAX_BURST)
+            && dirty.test(first + burst_len).value_or(false)) {
+            burst[burst_len + 1] = shadow[first + burst_len];
+            dirty.clear(first + burst_len);
+            burst_len++;
+        }
+
+        ret = i2c.write(addr, std::span<const uint8_t>{burst.data(), burst_len + 1}, this,
+            [] (I2cJobType type, I2cErr err, std::span<uint8_t> rxbuf, void* cookie) {
+                I2cDevice* dev = reinterpret_cast<I2cDevice*>(cookie);
+                dev->write_done(err);
+            }, false, prio);
+
+        if (ret != Err::Ok) {
+            // keep the registers for the next attempt
+            for (size_t i = first; i < (first + burst_len); i++)
+                dirty.set(i);
+
+            return ret;
+        }
+
+        writing = true;
+        return Err::Ok;
+    }
+
+    // Hands all held back reads over to the I2cMaster, has to be called with disabled interrupts.
+    Err issue_reads() noexcept
+    {
+        Err ret;
+
+        while (rd_issued != rd_head) {
+            RegRead& rd = reads[rd_issued % MAX_READS];
+
+            ret = i2c.write_read(addr, std::span<const uint8_t>{&rd.reg, 1}, rd.buf, this,
+                [] (I2cJobType type, I2cErr err, std::span<uint8_t> rxbuf, void* cookie) {
+                    I2cDevice* dev = reinterpret_cast<I2cDevice*>(cookie);
+                    dev->read_done(err, rxbuf);
+                }, false, prio);
+
+            if (ret != Err::Ok)
+                return ret;
+
+            rd_issued++;
+        }
+
+        return Err::Ok;
+    }
+
+    void write_done(I2cErr err) noexcept
+    {
+        uint32_t primask;
+
+        // The device may hold the old or the new values now, thus the registers are read from the
+        // device again. Registers which were written meanwhile are written with the next burst.
+        if (err != I2cErr::Ok) {
+            for (size_t i = burst[0]; i < (burst[0] + burst_len); i++) {
+                if (!dirty.test(i).value_or(false))
+                    valid.clear(i);
+            }
+        }
+
+        cb(I2cJobType::Write, err, burst[0], std::span<uint8_t>{&burst[1], burst_len}, cookie);
+
+        // an interrupt of a higher priority may write or read registers as well
+        primask = cm4f::disable_irq();
+        writing = false;
+        write_burst();
+        cm4f::restore_irq(primask);
+    }
+
+    void read_done(I2cErr err, std::span<uint8_t> rxbuf) noexcept
+    {
+        uint8_t reg = reads[rd_tail % MAX_READS].reg;
+        bool pending = writing;
+        uint32_t primask;
+
+        for (size_t i = reg; (i < (reg + rxbuf.size())) && !pending; i++)
+            pending = dirty.test(i).value_or(false);
+
+        // a register which was written after the read was issued already holds the newer value
+        if ((err == I2cErr::Ok) && !pending) {
+            libc::memcpy(&shadow[reg], rxbuf.data(), rxbuf.size());
+            for (size_t i = reg; i < (reg + rxbuf.size()); i++)
+                valid.set(i);
+        }
+
+        rd_tail++;
+        cb(I2cJobType::Read, err, reg, rxbuf, cookie);
+
+        // reads which didn't fit into the queue of the I2cMaster are retried as it drains
+        primask = cm4f::disable_irq();
+        if (!writing && (rd_issued != rd_head))
+            write_burst();
+        cm4f::restore_irq(primask);
+    }
+
+    I2cMaster& i2c;
+    const uint16_t addr;
+    const I2cByteOrder order;
+    const I2cPriority prio;
+    void* cookie;
+    I2cDeviceCallback cb;
+
+    std::array<uint8_t, N> shadow;
+    Bitmap<REGS> cached;
+    Bitmap<REGS> valid;
+    Bitmap<REGS> dirty;
+
+    std::array<uint8_t, MAX_BURST + 1> burst; // register address followed by the data
+    size_t burst_len;
+    bool writing;
+
+    std::array<RegRead, MAX_READS> reads;
+    size_t rd_head;
+    size_t rd_issued;
+    size_t rd_tail;
+};
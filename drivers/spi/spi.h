@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <span>
 
@@ -24,6 +25,22 @@ enum class SpiTransferType : uint8_t {
     Write,
     Read,
     WriteRead,
+    WriteStream,
+    Group,
+};
+
+// One transfer of a transaction group (see SpiMaster::transaction()), either a Write, a Read or a
+// WriteRead. The buffer which isn't used by the type is ignored.
+struct SpiTransfer {
+    constexpr explicit SpiTransfer(SpiTransferType type, std::span<const uint8_t> txbuf,
+        std::span<uint8_t> rxbuf) noexcept : type(type), txbuf(txbuf), rxbuf(rxbuf) {}
+
+    constexpr explicit SpiTransfer() noexcept
+        : type(SpiTransferType::None), txbuf(), rxbuf() {}
+
+    SpiTransferType type;
+    std::span<const uint8_t> txbuf;
+    std::span<uint8_t> rxbuf;
 };
 
 typedef void (*SpiCallback)(
@@ -31,3 +48,8 @@ typedef void (*SpiCallback)(
     std::span<uint8_t> txbuf,
     std::span<uint8_t> rxbuf,
     void* context);
+
+// Invoked in interrupt-context whenever one of the two buffers of a stream has been sent out. The
+// callback refills 'buf' with at most 'len' bytes and returns the number of bytes to send from it
+// next, returning 0 ends the stream once the other buffer has been sent too.
+typedef size_t (*SpiStreamCallback)(uint8_t* buf, size_t len, void* context);
@@ -8,6 +8,7 @@
 #include <cstdint>
 #include <span>
 
+#include "cm4f.h"
 #include "cs.h"
 #include "dma.h"
 #include "err.h"
@@ -65,7 +66,11 @@ Err SpiMaster::init(const Cs& cs) noexcept
         DmaPtrIncrement::Incr8Bit,
         DmaPtrIncrement::NoIncr,
         reinterpret_cast<void*>(this),
-        [] (const uint8_t* src, uint8_t* dst, size_t len, void* inst) noexcept -> void {}
+        [] (const uint8_t* src, uint8_t* dst, size_t len, void* inst) noexcept -> void {
+            // only a stream is finished by the TX-channel, all other jobs by the RX-channel
+            SpiMaster* m = reinterpret_cast<SpiMaster*>(inst);
+            m->finish_stream(len);
+        }
     });
 
     if (ret != Err::Ok)
@@ -95,10 +100,7 @@ Err SpiMaster::write(std::span<const uint8_t> data, Pin* cs, void* context, SpiC
     if (data.empty())
         return Err::Empty;
 
-    if (job_fifo.free() == 0)
-        return Err::NoMem;
-
-    job_fifo.emplace(
+    return enqueue(SpiJob{
         SpiTransferType::Write,
         const_cast<uint8_t*>(data.data()),
         nullptr,
@@ -106,25 +108,15 @@ Err SpiMaster::write(std::span<const uint8_t> data, Pin* cs, void* context, SpiC
         cs,
         context,
         cb
-    );
-
-    if (!transm_going) {
-        transm_going = true;
-        start_transmission();
-    }
-
-    return Err::Ok;
+    });
 }
 
 Err SpiMaster::read(std::span<uint8_t> buffer, Pin* cs, void* context, SpiCallback cb) noexcept
 {
-    if (buffer.empty() == 0)
+    if (buffer.empty())
         return Err::Empty;
 
-    if (job_fifo.free() == 0)
-        return Err::NoMem;
-
-    job_fifo.emplace(
+    return enqueue(SpiJob{
         SpiTransferType::Read,
         nullptr,
         buffer.data(),
@@ -132,14 +124,7 @@ Err SpiMaster::read(std::span<uint8_t> buffer, Pin* cs, void* context, SpiCallba
         cs,
         context,
         cb
-    );
-
-    if (!transm_going) {
-        transm_going = true;
-        start_transmission();
-    }
-
-    return Err::Ok;
+    });
 }
 
 Err SpiMaster::write_read(
@@ -152,10 +137,7 @@ Err SpiMaster::write_read(
     if (txbuf.empty() || rxbuf.empty())
         return Err::Empty;
 
-    if (job_fifo.free() == 0)
-        return Err::NoMem;
-
-    job_fifo.emplace(
+    return enqueue(SpiJob{
         SpiTransferType::WriteRead,
         const_cast<uint8_t*>(txbuf.data()),
         rxbuf.data(),
@@ -163,14 +145,112 @@ Err SpiMaster::write_read(
         cs,
         context,
         cb
-    );
+    });
+}
 
-    if (!transm_going) {
+Err SpiMaster::write_stream(
+    std::span<uint8_t> buf_a,
+    std::span<uint8_t> buf_b,
+    Pin* cs,
+    void* context,
+    SpiStreamCallback refill,
+    SpiCallback cb) noexcept
+{
+    if (buf_a.empty() || buf_b.empty())
+        return Err::Empty;
+
+    if (!refill)
+        return Err::NullPtr;
+
+    if (buf_a.size() != buf_b.size())
+        return Err::NotSupported;
+
+    return enqueue(SpiJob{
+        SpiTransferType::WriteStream,
+        buf_a.data(),
+        buf_b.data(),
+        buf_a.size(),
+        cs,
+        context,
+        cb,
+        refill
+    });
+}
+
+Err SpiMaster::transaction(
+    std::span<const SpiTransfer> transfers,
+    Pin* cs,
+    void* context,
+    SpiCallback cb) noexcept
+{
+    if (transfers.empty())
+        return Err::Empty;
+
+    if (transfers.size() > MAX_GROUP_LEN)
+        return Err::OutOfRange;
+
+    for (const SpiTransfer& t : transfers) {
+        size_t len;
+
+        switch (t.type) {
+        case SpiTransferType::Write:
+            len = t.txbuf.size();
+            break;
+        case SpiTransferType::Read:
+            len = t.rxbuf.size();
+            break;
+        case SpiTransferType::WriteRead:
+            len = std::min(t.txbuf.size(), t.rxbuf.size());
+            break;
+        default:
+            return Err::NotSupported;
+        }
+
+        if (len == 0)
+            return Err::Empty;
+
+        if (len > MAX_GROUP_TRANSFER_LEN)
+            return Err::OutOfRange;
+    }
+
+    return enqueue(SpiJob{
+        SpiTransferType::Group,
+        nullptr,
+        nullptr,
+        transfers.size(),
+        cs,
+        context,
+        cb,
+        nullptr,
+        transfers.data()
+    });
+}
+
+Err SpiMaster::enqueue(const SpiJob& job) noexcept
+{
+    uint32_t primask;
+    Err ret;
+
+    // the drivers on top of this one queue their next jobs from the job-callbacks, thus the fifo
+    // may be fed from interrupt-context and thread-mode at the same time
+    primask = cm4f::disable_irq();
+    ret = job_fifo.push(job);
+    if ((ret == Err::Ok) && !transm_going) {
         transm_going = true;
         start_transmission();
     }
+    cm4f::restore_irq(primask);
 
-    return Err::Ok;
+    return ret;
+}
+
+size_t SpiMaster::stream_half_done(uint8_t* buf, size_t len, void* instance)
+{
+    SpiMaster* m = reinterpret_cast<SpiMaster*>(instance);
+    SpiJob& job = m->job_fifo.peek_ref().value().get();
+
+    // the buffer may be refilled up to its whole size, independent of the amount just sent
+    return job.refill(buf, job.len, job.context);
 }
 
 void SpiMaster::start_transmission() noexcept
@@ -204,15 +284,84 @@ void SpiMaster::start_transmission() noexcept
         rx_dma.transfer_periph_to_mem(rxreg, job.rxbuf, job.len);
         tx_dma.transfer_mem_to_periph(job.txbuf, txreg, job.len);
         break;
+    case SpiTransferType::WriteStream:
+        // The length of the stream is unknown in advance, thus it can't be finished by a dummy
+        // read like a write. The received bytes are just overwritten meanwhile.
+        tx_dma.transfer_ping_pong_mem_to_periph(job.txbuf, job.rxbuf, txreg, job.len,
+            SpiMaster::stream_half_done);
+        break;
+    case SpiTransferType::Group:
+        start_group(job);
+        break;
     default:
         // should never happen!
         break;
     }
 }
 
+void SpiMaster::start_group(const SpiJob& job) noexcept
+{
+    const uint8_t* rxreg = reinterpret_cast<uint8_t*>(&usci.rxbuf());
+    uint8_t* txreg = reinterpret_cast<uint8_t*>(&usci.txbuf());
+
+    tx_tasks.clear();
+    rx_tasks.clear();
+
+    // Every transfer of the group gets one task per direction, just like a single job: a write
+    // reads into the dummy and a read sends the idle byte. Both chains are sequenced by the DMA
+    // without any gap, the RX-chain finishes the group like a single job.
+    for (size_t i = 0; i < job.len; i++) {
+        const SpiTransfer& t = job.group[i];
+        uint32_t len;
+
+        switch (t.type) {
+        case SpiTransferType::Write:
+            len = static_cast<uint32_t>(t.txbuf.size());
+            tx_tasks.add(t.txbuf.data(), txreg, len, DmaPtrIncrement::Incr8Bit,
+                DmaPtrIncrement::NoIncr);
+            rx_tasks.add(rxreg, &rx_dummy, len, DmaPtrIncrement::NoIncr, DmaPtrIncrement::NoIncr);
+            break;
+        case SpiTransferType::Read:
+            len = static_cast<uint32_t>(t.rxbuf.size());
+            tx_tasks.add(&TX_IDLE, txreg, len, DmaPtrIncrement::NoIncr, DmaPtrIncrement::NoIncr);
+            rx_tasks.add(rxreg, t.rxbuf.data(), len, DmaPtrIncrement::NoIncr,
+                DmaPtrIncrement::Incr8Bit);
+            break;
+        case SpiTransferType::WriteRead:
+            len = static_cast<uint32_t>(std::min(t.txbuf.size(), t.rxbuf.size()));
+            tx_tasks.add(t.txbuf.data(), txreg, len, DmaPtrIncrement::Incr8Bit,
+                DmaPtrIncrement::NoIncr);
+            rx_tasks.add(rxreg, t.rxbuf.data(), len, DmaPtrIncrement::NoIncr,
+                DmaPtrIncrement::Incr8Bit);
+            break;
+        default:
+            // rejected by transaction()
+            break;
+        }
+    }
+
+    rx_dma.transfer_task_list(rx_tasks, DmaMode::PeripheralScatterGather);
+    tx_dma.transfer_task_list(tx_tasks, DmaMode::PeripheralScatterGather);
+}
+
+void SpiMaster::finish_stream(size_t len) noexcept
+{
+    if (!transm_going || (job_fifo.peek_ref().value().get().type != SpiTransferType::WriteStream))
+        return;
+
+    // The DMA has written the last byte to TXBUF, thus at most two bytes are still being shifted
+    // out. Reading RXBUF afterwards clears RXIFG and the overrun flag for the next job.
+    while ((usci.statw().get() & uscispiregs::statw::busy.mask()) > 0)
+        ;
+
+    usci.rxbuf().get();
+    int_handler(nullptr, nullptr, len);
+}
+
 void SpiMaster::int_handler(const uint8_t* src_buf, uint8_t* dst_buf, size_t len) noexcept
 {
     SpiJob& job = job_fifo.peek_ref().value().get();
+    uint32_t primask;
 
     // if a CS-pin was provided, we pull it high since the job has finished
     if (job.cs) {
@@ -230,15 +379,26 @@ void SpiMaster::int_handler(const uint8_t* src_buf, uint8_t* dst_buf, size_t len
         case SpiTransferType::WriteRead:
             job.cb(job.type, std::span{job.txbuf, len}, std::span{job.rxbuf, len}, job.context);
             break;
+        case SpiTransferType::WriteStream:
+            // the buffers have been refilled meanwhile, only the length is meaningful
+            job.cb(job.type, std::span{job.txbuf, 0}, std::span<uint8_t>{}, job.context);
+            break;
+        case SpiTransferType::Group:
+            // the transfers of the group are known by the caller
+            job.cb(job.type, std::span<uint8_t>{}, std::span<uint8_t>{}, job.context);
+            break;
         default:
             break;
         }
     }
 
+    // a higher prioritized interrupt may queue a job in between
+    primask = cm4f::disable_irq();
     job_fifo.pop();
     if (job_fifo.is_empty())
         transm_going = false;
     else
         start_transmission();
+    cm4f::restore_irq(primask);
 }
 
@@ -25,7 +25,8 @@ public:
         uint8_t tx_dma_chan, uint8_t rx_dma_chan, uint8_t tx_dma_src, uint8_t rx_dma_src) noexcept
         : initialized(false), transm_going(false), rx_dummy(0), desired_freq(freq_hz),
         actual_freq(0), mode(mode), usci(usci), tx_dma(dma[tx_dma_chan]), rx_dma(dma[rx_dma_chan]),
-        tx_dma_src(tx_dma_src), rx_dma_src(rx_dma_src), job_fifo() {}
+        tx_dma_src(tx_dma_src), rx_dma_src(rx_dma_src), job_fifo(),
+        tx_tasks(DmaDataWidth::Width8Bit), rx_tasks(DmaDataWidth::Width8Bit) {}
 
     Err init(const Cs& cs) noexcept;
 
@@ -34,29 +35,56 @@ public:
     Err write_read(std::span<const uint8_t> txbuf, std::span<uint8_t> rxbuf, Pin* cs, void* context,
         SpiCallback cb) noexcept;
 
+    // Writes a stream of arbitrary length through two buffers of the same size which are sent
+    // alternately (ping-pong DMA). Both buffers have to be filled completely before, afterwards
+    // 'refill' is invoked for every buffer which has been sent. 'cb' is invoked once the last byte
+    // has left the shift register. The received data is discarded.
+    Err write_stream(std::span<uint8_t> buf_a, std::span<uint8_t> buf_b, Pin* cs, void* context,
+        SpiStreamCallback refill, SpiCallback cb) noexcept;
+
+    // Executes up to MAX_GROUP_LEN transfers of at most MAX_GROUP_TRANSFER_LEN bytes each back to
+    // back as a single scatter-gather sequence of the DMA, e.g. the command, address and data
+    // phases of a flash chip. CS is held across all of them and 'cb' is invoked once after the last
+    // one with empty buffers. The transfers have to stay untouched until then.
+    Err transaction(std::span<const SpiTransfer> transfers, Pin* cs, void* context, SpiCallback cb)
+        noexcept;
+
+    static constexpr size_t MAX_GROUP_LEN = 8;
+    static constexpr size_t MAX_GROUP_TRANSFER_LEN = 1024;
+
     uint32_t get_actual_freq_hz() const noexcept { return actual_freq; }
     uint32_t get_desired_freq_hz() const noexcept { return desired_freq; }
+    size_t get_free_jobs() const noexcept { return job_fifo.free(); }
 private:
     struct SpiJob {
         SpiTransferType type;
         uint8_t* txbuf;
-        uint8_t* rxbuf;
+        uint8_t* rxbuf; // the second buffer of a stream
         size_t len;
 
         Pin* cs;
         void* context;
         SpiCallback cb;
+        SpiStreamCallback refill;
+        const SpiTransfer* group; // the transfers of a group, 'len' is their number
 
         constexpr explicit SpiJob() noexcept
             : type(SpiTransferType::None), txbuf(nullptr), rxbuf(nullptr), len(0), cs(nullptr),
-            context(nullptr), cb(nullptr) {}
+            context(nullptr), cb(nullptr), refill(nullptr), group(nullptr) {}
 
         constexpr explicit SpiJob(SpiTransferType type, uint8_t* txbuf, uint8_t* rxbuf,size_t len,
-            Pin* cs, void* context, SpiCallback cb) noexcept
-            : type(type), txbuf(txbuf), rxbuf(rxbuf), len(len), cs(cs), context(context), cb(cb) {}
+            Pin* cs, void* context, SpiCallback cb, SpiStreamCallback refill = nullptr,
+            const SpiTransfer* group = nullptr) noexcept
+            : type(type), txbuf(txbuf), rxbuf(rxbuf), len(len), cs(cs), context(context), cb(cb),
+            refill(refill), group(group) {}
     };
 
+    static size_t stream_half_done(uint8_t* buf, size_t len, void* instance);
+
+    Err enqueue(const SpiJob& job) noexcept;
     void start_transmission() noexcept;
+    void start_group(const SpiJob& job) noexcept;
+    void finish_stream(size_t len) noexcept;
     void int_handler(const uint8_t* src_buf, uint8_t* dst_buf, size_t len) noexcept;
 
     bool initialized;
@@ -74,4 +102,8 @@ private:
     uint8_t rx_dma_src;
 
     Fifo<SpiJob, 16> job_fifo;
+
+    // the DMA-sequence of the group which is currently transferred
+    DmaTaskList<MAX_GROUP_LEN> tx_tasks;
+    DmaTaskList<MAX_GROUP_LEN> rx_tasks;
 };
@@ -5,7 +5,10 @@
  * E-Mail: hotschi@gmx.at
  */
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <expected>
 #include <span>
 #include <string_view>
 
@@ -142,13 +145,15 @@ Err Uart::init(const Cs& cs) noexcept
 
 Err Uart::write(std::span<uint8_t> data) noexcept
 {
+    Err ret;
+
     if (!initialized)
         return Err::NotInitialized;
 
-    if (tx_fifo.is_full())
-        return Err::NoMem;
-
-    tx_fifo.put_range(data);
+    // the data is either queued completely or not at all
+    ret = tx_fifo.put_range(data);
+    if (ret != Err::Ok)
+        return ret;
 
     if (!tx_dma.transfer_going())
         queue_tx_job();
@@ -168,9 +173,22 @@ void Uart::queue_tx_job() noexcept
     if (tx_fifo.is_empty())
         return;
 
-    std::span<uint8_t> job = tx_fifo.peek_range().value();
-    tx_dma.transfer_mem_to_periph(
-        job.data(), reinterpret_cast<uint8_t*>(&usci.reg().txbuf), job.size());
+    uint8_t* txbuf = reinterpret_cast<uint8_t*>(&usci.reg().txbuf);
+    std::array<std::span<uint8_t>, 2> job = tx_fifo.peek_ranges().value();
+
+    if (job[1].empty()) {
+        tx_dma.transfer_mem_to_periph(job[0].data(), txbuf, job[0].size());
+        return;
+    }
+
+    // The data wraps around the end of the FIFO -> send both parts within one scatter-gather
+    // transfer, thus we get only a single interrupt.
+    tx_tasks.clear();
+    tx_tasks.add(job[0].data(), txbuf, job[0].size(), DmaPtrIncrement::Incr8Bit,
+        DmaPtrIncrement::NoIncr);
+    tx_tasks.add(job[1].data(), txbuf, job[1].size(), DmaPtrIncrement::Incr8Bit,
+        DmaPtrIncrement::NoIncr);
+    tx_dma.transfer_task_list(tx_tasks, DmaMode::PeripheralScatterGather);
 }
 
 void Uart::redirect_tx_handler(
@@ -187,13 +205,143 @@ void Uart::redirect_rx_handler(
     inst->rx_handler(dst_buf, len);
 }
 
+size_t Uart::redirect_rx_half_handler(uint8_t* buf, size_t len, void* instance) noexcept
+{
+    Uart* inst = reinterpret_cast<Uart*>(instance);
+    return inst->rx_half_handler(len);
+}
+
 void Uart::tx_handler(const uint8_t* buf, size_t len) noexcept
 {
     tx_fifo.drop_range();
     queue_tx_job();
 }
 
+Err Uart::start_receiving(void* cookie, void (*rx_cb)(size_t avail, void* cookie) noexcept) noexcept
+{
+    Err ret;
+
+    if (!initialized)
+        return Err::NotInitialized;
+
+    if (receiving)
+        return Err::Busy;
+
+    this->rx_cb = rx_cb;
+    this->rx_cookie = cookie;
+
+    rx_written.store(0, std::memory_order::relaxed);
+    rx_notified.store(0, std::memory_order::relaxed);
+    rx_read = 0;
+    rx_range = 0;
+    rx_last_seen = 0;
+
+    // The DMA fills the two halves of the ring-buffer alternately, so there is no gap between two
+    // halves where a received byte could get lost.
+    ret = rx_dma.transfer_ping_pong_periph_to_mem(
+        reinterpret_cast<const uint8_t*>(&usci.reg().rxbuf), &rx_buf[0], &rx_buf[RX_HALF_SIZE],
+        RX_HALF_SIZE, Uart::redirect_rx_half_handler);
+    if (ret != Err::Ok)
+        return ret;
+
+    receiving = true;
+    return Err::Ok;
+}
+
+void Uart::stop_receiving() noexcept
+{
+    if (receiving)
+        rx_dma.stop_ping_pong();
+}
+
+size_t Uart::rx_half_handler(size_t len) noexcept
+{
+    size_t written = rx_written.load(std::memory_order::relaxed) + len;
+
+    rx_written.store(written, std::memory_order::release);
+    rx_notified.store(written, std::memory_order::relaxed);
+
+    if (rx_cb)
+        rx_cb(written - rx_read, rx_cookie);
+
+    // keep the ring-buffer going with the same half
+    return RX_HALF_SIZE;
+}
+
 void Uart::rx_handler(uint8_t* buf, size_t len) noexcept
 {
+    // the reception was stopped and both halves are drained
+    receiving = false;
+}
+
+size_t Uart::rx_write_cnt() const noexcept
+{
+    size_t base;
+    size_t cur;
+
+    // If the DMA-interrupt switched the halves in between, we have to read the values again.
+    do {
+        base = rx_written.load(std::memory_order::acquire);
+        cur = rx_dma.ping_pong_transferred();
+    } while (base != rx_written.load(std::memory_order::acquire));
+
+    return base + cur;
+}
+
+size_t Uart::rx_available() const noexcept
+{
+    return rx_write_cnt() - rx_read;
+}
+
+std::expected<std::span<uint8_t>, Err> Uart::peek_range() noexcept
+{
+    size_t w = rx_write_cnt();
+    size_t idx;
+    size_t len;
+
+    if (w == rx_read)
+        return std::unexpected{Err::Empty};
+
+    if ((w - rx_read) > RX_BUF_SIZE) {
+        // The consumer was too slow and the DMA already overwrote data which wasn't read yet. We
+        // continue with the oldest data which is still valid.
+        rx_read = w - (w & (RX_HALF_SIZE - 1)) - RX_HALF_SIZE;
+        rx_range = 0;
+        return std::unexpected{Err::Overflow};
+    }
+
+    // return only the contiguous part up to the end of the buffer
+    idx = rx_read & (RX_BUF_SIZE - 1);
+    len = std::min(w - rx_read, RX_BUF_SIZE - idx);
+    rx_range = len;
+
+    return std::expected<std::span<uint8_t>, Err>{std::span<uint8_t>{&rx_buf[idx], len}};
+}
+
+void Uart::drop_range() noexcept
+{
+    rx_read += rx_range;
+    rx_range = 0;
+}
+
+void Uart::poll_rx_idle() noexcept
+{
+    size_t w;
+
+    if (!receiving)
+        return;
 
+    w = rx_write_cnt();
+    if (w != rx_last_seen) {
+        // the line is still active, the data will be reported once it becomes idle
+        rx_last_seen = w;
+        return;
+    }
+
+    // the line is idle -> report a partially filled half
+    if (w != rx_notified.load(std::memory_order::relaxed)) {
+        rx_notified.store(w, std::memory_order::relaxed);
+        if (rx_cb)
+            rx_cb(w - rx_read, rx_cookie);
+    }
 }
@@ -7,11 +7,15 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <expected>
 #include <span>
 #include <string_view>
 
 #include "cs.h"
+#include "dma.h"
 #include "err.h"
 #include "dma_fifo.h"
 #include "pin.h"
@@ -20,26 +24,64 @@
 
 class Uart {
 public:
+    // Size of the receive ring-buffer, the DMA alternately fills both halves of it.
+    static constexpr size_t RX_BUF_SIZE = 512;
+
     consteval explicit Uart(UsciA& usci, Dma& dma, size_t baud, uint8_t tx_dma_chan,
         uint8_t rx_dma_chan, uint8_t tx_dma_src, uint8_t rx_dma_src) noexcept
-        : initialized(false), tx_fifo(), usci(usci), baud(baud), tx_dma(dma[tx_dma_chan]),
+        : initialized(false), receiving(false), tx_fifo(), tx_tasks(DmaDataWidth::Width8Bit),
+        rx_buf(), rx_written(0), rx_read(0), rx_range(0), rx_last_seen(0), rx_notified(0),
+        rx_cookie(nullptr), rx_cb(nullptr), usci(usci), baud(baud), tx_dma(dma[tx_dma_chan]),
         rx_dma(dma[rx_dma_chan]), tx_dma_src(tx_dma_src), rx_dma_src(rx_dma_src) {}
 
     Err init(const Cs& cs) noexcept;
     Err write(std::span<uint8_t> data) noexcept;
     Err write(std::string_view text) noexcept;
+
+    // Starts the continuous DMA-reception into the ring-buffer. The callback is invoked whenever
+    // one half of the ring-buffer was filled and when poll_rx_idle() detects an idle line.
+    Err start_receiving(void* cookie, void (*rx_cb)(size_t avail, void* cookie) noexcept) noexcept;
+    void stop_receiving() noexcept;
+
+    // must only be called from the consumer!
+    std::expected<std::span<uint8_t>, Err> peek_range() noexcept;
+    void drop_range() noexcept;
+    size_t rx_available() const noexcept;
+
+    // Supposed to be called periodically (e.g. by an EventTimer event every few milliseconds). If
+    // no byte was received since the last call, the data received so far is reported.
+    void poll_rx_idle() noexcept;
 private:
+    static constexpr size_t RX_HALF_SIZE = RX_BUF_SIZE / 2;
+
     static void redirect_tx_handler(
         const uint8_t* src_buf, uint8_t* dst_buf, size_t len, void* instance) noexcept;
     static void redirect_rx_handler(
         const uint8_t* src_buf, uint8_t* dst_buf, size_t len, void* instance) noexcept;
+    static size_t redirect_rx_half_handler(uint8_t* buf, size_t len, void* instance) noexcept;
     void tx_handler(const uint8_t* buf, size_t len) noexcept;
     void rx_handler(uint8_t* buf, size_t len) noexcept;
+    size_t rx_half_handler(size_t len) noexcept;
+    size_t rx_write_cnt() const noexcept;
 
     void queue_tx_job() noexcept;
 
     bool initialized;
+    bool receiving;
     DmaFifo<uint8_t, 512> tx_fifo;
+    DmaTaskList<2> tx_tasks; // used if the data within the FIFO wraps around
+
+    // The RX-indices are free-running counters, the position within the buffer is obtained by
+    // masking them with the buffer size.
+    std::array<uint8_t, RX_BUF_SIZE> rx_buf;
+    std::atomic<size_t> rx_written; // bytes of all completely filled halves
+    size_t rx_read;
+    size_t rx_range;
+    size_t rx_last_seen;
+    std::atomic<size_t> rx_notified;
+    void* rx_cookie;
+    void (*rx_cb)(size_t avail, void* cookie) noexcept;
+
     UsciA& usci;
     uint32_t baud;
 
@@ -14,6 +14,27 @@
  * frequency because we "only" need to transfer only 1 byte per bit and still comply to the given
  * timings. If the provided SPI-module is setup to a different frequency than 6MHz, the
  * init-function will fail and this driver won't work.
+ *
+ * By default (W2812BMode::Encoded) the whole SPI-bitstream is kept in RAM, this takes 24 bytes per
+ * LED but the transfer runs without any CPU-intervention. In W2812BMode::Streaming only the 3 bytes
+ * of each color are stored and encoded into two small buffers of CHUNK_LEDS LEDs while they are
+ * streamed out with ping-pong DMA. Thus, an interrupt has to encode the next chunk while the other
+ * buffer is sent, which takes 256µs with CHUNK_LEDS = 8.
+ *
+ * Instead of modifying the LEDs directly, which is only possible while no frame is sent, a frame
+ * may be drawn into a separate buffer and handed over with present(). This needs a back buffer of
+ * 3 bytes per LED, which is only allocated with PRESENT set. The frame is copied into it right away
+ * and moved into the display buffer as soon as the previous one has been sent. Thus, the next
+ * frame may be drawn immediately (see W2812BMatrix).
+ *
+ * The LEDs keep their colors until they receive new ones, thus only the LEDs up to the last one
+ * which has changed since the previous frame are sent and a frame without any changes isn't sent
+ * at all. Every frame is followed by a reset (MOSI low for more than 50µs) which latches it.
+ *
+ * The colors are mapped through a table while being encoded, which optionally applies a gamma of
+ * 2.5 and the global brightness. Thus, neither of them costs anything per frame and the stored
+ * colors are never modified. A new brightness applies to the next frame. The encoded mode only
+ * keeps the colors in the back buffer, thus it supports a brightness only with PRESENT set.
  */
 
 #pragma once
@@ -24,41 +45,49 @@
 #include <cstdint>
 #include <cstddef>
 #include <span>
+#include <type_traits>
 
+#include "cm4f.h"
 #include "err.h"
 #include "helpers.h"
 #include "libc.h"
 #include "spi.h"
 #include "spi_master.h"
 
+enum class W2812BMode : uint8_t {
+    Encoded,
+    Streaming,
+};
+
 class Rgb {
 public:
     constexpr explicit Rgb() noexcept : r(0), g(0), b(0) {}
     constexpr explicit Rgb(uint8_t r, uint8_t g, uint8_t b) : r(r), g(g), b(b) {}
 
-    template<size_t N> friend class W2812B;
-private:
-    constexpr uint32_t to_raw() const noexcept
-    {
-        // We convert the raw-value to a format that matches our lookup table and generates the
-        // bytes in the correct order.
-        uint32_t raw = static_cast<uint32_t>(((g >> 4) & 0x0F) | ((g << 4) & 0xF0)) |
-                       (static_cast<uint32_t>(((r >> 4) & 0x0F) | ((r << 4) & 0xF0)) << 8) |
-                       (static_cast<uint32_t>(((b >> 4) & 0x0F) | ((b << 4) & 0xF0)) << 16);
-
-        return raw;
-    }
+    constexpr bool operator==(const Rgb& rhs) const noexcept = default;
 
+    template<size_t N, W2812BMode MODE, bool PRESENT> friend class W2812B;
+private:
     uint8_t r;
     uint8_t g;
     uint8_t b;
 };
 
-template<size_t N>
+template<size_t N, W2812BMode MODE = W2812BMode::Encoded, bool PRESENT = false>
 class W2812B {
+    static constexpr bool STREAMING = MODE == W2812BMode::Streaming;
+    static_assert(!STREAMING || (N >= 2), "a stream needs at least one LED per buffer");
 public:
-    constexpr explicit W2812B(SpiMaster& spi)
-        : spi(spi), fb(), transmitting(false), initialized(false) {}
+    constexpr explicit W2812B(SpiMaster& spi, bool gamma = false)
+        : spi(spi), fb(), back(), chunk(), level(), next_led(0), tx_leds(0), dirty(N),
+        pending(false), transmitting(false), initialized(false), gamma(gamma), brightness(0xFF)
+    {
+        // all LEDs are off initially, a zero byte wouldn't be a valid bit
+        if constexpr (!STREAMING)
+            fb.fill(LUT[0]);
+
+        calc_levels();
+    }
 
     Err init() noexcept
     {
@@ -102,7 +131,6 @@ public:
     Err set_color_for_all_leds(Rgb col) noexcept
     {
         uint32_t raw_color[WORDS_PER_LED];
-        uint32_t raw;
 
         if (!initialized)
             return Err::NotInitialized;
@@ -110,17 +138,20 @@ public:
         if (transmitting.load(std::memory_order::relaxed))
             return Err::Busy;
 
-        raw = col.to_raw();
-        for (size_t i = 0; i < WORDS_PER_LED; i++) {
-            raw_color[i] = LUT[raw & 0x0F];
-            raw >>= 4;
-        }
+        if constexpr (PRESENT)
+            back.fill(col);
 
-        for (size_t i = 0; i < (N * WORDS_PER_LED); i += WORDS_PER_LED) {
-            for (size_t j = 0; j < WORDS_PER_LED; j++)
-                fb[i + j] = raw_color[j];
+        if constexpr (STREAMING) {
+            fb.fill(col);
+        } else {
+            encode(raw_color, col);
+            for (size_t i = 0; i < (N * WORDS_PER_LED); i += WORDS_PER_LED) {
+                for (size_t j = 0; j < WORDS_PER_LED; j++)
+                    fb[i + j] = raw_color[j];
+            }
         }
 
+        dirty = N;
         return Err::Ok;
     }
 
@@ -132,10 +163,50 @@ public:
         if (transmitting.load(std::memory_order::relaxed))
             return Err::Busy;
 
-        libc::memset(fb.data(), ZERO, N * WORDS_PER_LED);
+        if constexpr (PRESENT)
+            back.fill(Rgb{});
+
+        if constexpr (STREAMING)
+            fb.fill(Rgb{});
+        else
+            libc::memset(fb.data(), ZERO, N * WORDS_PER_LED * sizeof(uint32_t));
+
+        dirty = N;
         return Err::Ok;
     }
 
+    // Scales all colors by (brightness + 1) / 256 with the next frame, the stored colors aren't
+    // modified. Returns Err::NotSupported in the encoded mode without PRESENT, since it doesn't
+    // keep the colors.
+    Err set_brightness(uint8_t brightness) noexcept
+    {
+        if constexpr (!STREAMING && !PRESENT)
+            return Err::NotSupported;
+
+        if (transmitting.load(std::memory_order::relaxed))
+            return Err::Busy;
+
+        this->brightness = brightness;
+        calc_levels();
+
+        // The streaming mode encodes the stored colors when the next frame is sent, the encoded
+        // mode encodes them from the back buffer, which holds the colors while no frame is sent.
+        if constexpr (!STREAMING && PRESENT) {
+            for (size_t i = 0; i < N; i++)
+                encode(&fb[i * WORDS_PER_LED], back[i]);
+        }
+
+        dirty = N;
+        return Err::Ok;
+    }
+
+    uint8_t get_brightness() const noexcept
+    {
+        return brightness;
+    }
+
+    // Sends the LEDs up to the last one which has been changed since the previous frame, nothing is
+    // sent if no LED has been changed.
     Err refresh_leds() noexcept
     {
         if (!initialized)
@@ -144,13 +215,51 @@ public:
         if (transmitting.load(std::memory_order::relaxed))
             return Err::Busy;
 
+        if (dirty == 0)
+            return Err::Ok;
+
         transmitting.store(true, std::memory_order::acquire);
-        return spi.write(
-            std::span<uint8_t>{reinterpret_cast<uint8_t*>(fb.data()), fb.size() * sizeof(fb[0])},
-            nullptr, this, redirect_spi_cb);
+        return start_transmission();
+    }
+
+    // Shows the given frame. The frame is copied into the back buffer, thus it may be modified as
+    // soon as this function returns. If a frame is still being sent, the copied one is sent in
+    // interrupt-context once that has finished. Err::Busy is returned if a frame is already waiting
+    // in the back buffer.
+    Err present(const std::array<Rgb, N>& frame) noexcept
+    {
+        uint32_t primask;
+
+        static_assert(PRESENT, "present() needs the back buffer, see PRESENT");
+
+        if (!initialized)
+            return Err::NotInitialized;
+
+        // the interrupt only reads the back buffer while a frame is pending
+        if (pending.load(std::memory_order::acquire))
+            return Err::Busy;
+
+        back = frame;
+
+        primask = cm4f::disable_irq();
+        if (transmitting.load(std::memory_order::relaxed)) {
+            pending.store(true, std::memory_order::release);
+            cm4f::restore_irq(primask);
+            return Err::Ok;
+        }
+        transmitting.store(true, std::memory_order::relaxed);
+        cm4f::restore_irq(primask);
+
+        load(back);
+        if (dirty == 0) {
+            transmitting.store(false, std::memory_order::release);
+            return Err::Ok;
+        }
+
+        return start_transmission();
     }
 
-    template<uint16_t WIDTH, uint16_t HEIGHT> friend class W2812BMatrix;
+    template<uint16_t WIDTH, uint16_t HEIGHT, W2812BMode M> friend class W2812BMatrix;
 private:
     // Minimum an maximum frequency to satisfy the required timing defined in the spec. For
     // calculation details look at the spec (https://cdn-shop.adafruit.com/datasheets/WS2812B.pdf)
@@ -162,6 +271,35 @@ private:
     static constexpr uint32_t ZERO = 0b11100000;
     static constexpr uint32_t ONE = 0b11111000;
 
+    // 8 LEDs (192 bytes) per buffer leave 256µs for encoding the next chunk
+    static constexpr size_t CHUNK_LEDS = (N / 2 < 8) ? N / 2 : 8;
+    static constexpr size_t CHUNK_BYTES = CHUNK_LEDS * WORDS_PER_LED * sizeof(uint32_t);
+
+    // 40 bytes @ 6MHz keep MOSI low for 53µs
+    static constexpr std::array<uint8_t, 40> RESET{};
+
+    // (i / 255)^2.5 * 255 in integer arithmetic, sqrt(i << 16) is sqrt(i) with 8 fractional bits
+    static constexpr std::array<uint8_t, 256> GAMMA = [] () {
+        std::array<uint8_t, 256> ret{};
+        auto isqrt = [] (uint64_t val) {
+            uint64_t root = val;
+            uint64_t next = (val + 1) / 2;
+
+            // Newton's method
+            while (next < root) {
+                root = next;
+                next = (root + val / root) / 2;
+            }
+            return root;
+        };
+        uint64_t div = 255 * 255 * isqrt(255 << 16);
+
+        for (uint64_t i = 0; i < ret.size(); i++)
+            ret[i] = static_cast<uint8_t>((i * i * isqrt(i << 16) * 255 + div / 2) / div);
+
+        return ret;
+    }();
+
     // we calculate a lookup-table in for encoding 4 bits into the framebuffer
     static constexpr std::array<uint32_t, 16> LUT = [] () {
         std::array<uint32_t, 16> ret{};
@@ -188,26 +326,183 @@ private:
         std::span<uint8_t> rxbuf,
         void* context) noexcept
     {
-        W2812B<N>* instance = reinterpret_cast<W2812B<N>*>(context);
+        W2812B<N, MODE, PRESENT>* instance = reinterpret_cast<W2812B<N, MODE, PRESENT>*>(context);
         instance->handle_spi_cb();
     }
 
+    static size_t redirect_spi_refill(uint8_t* buf, size_t len, void* context) noexcept
+    {
+        W2812B<N, MODE, PRESENT>* instance = reinterpret_cast<W2812B<N, MODE, PRESENT>*>(context);
+        return instance->encode_chunk(reinterpret_cast<uint32_t*>(buf));
+    }
+
     void handle_spi_cb() noexcept
     {
-        transmitting.store(false, std::memory_order::release);
+        // a frame has been presented meanwhile -> send it right away if anything has changed
+        if constexpr (PRESENT) {
+            if (pending.load(std::memory_order::acquire)) {
+                load(back);
+                pending.store(false, std::memory_order::release);
+            }
+        }
+
+        // if the frame can't be queued, its LEDs stay dirty and are sent by the next refresh
+        if (dirty > 0)
+            start_transmission();
+        else
+            transmitting.store(false, std::memory_order::release);
     }
 
-    void set_color_unsafe(size_t led_idx, Rgb col) noexcept
+    // Sends the LEDs up to the last dirty one, followed by the reset. Only the reset has a
+    // callback, thus both jobs are queued at once or none of them and 'transmitting' is cleared on
+    // failure.
+    Err start_transmission() noexcept
+    {
+        const size_t leds = dirty;
+        uint32_t primask;
+        Err ret;
+
+        tx_leds = dirty;
+        dirty = 0;
+
+        if constexpr (STREAMING) {
+            // both buffers have to be filled for starting the stream
+            if (tx_leds < (2 * CHUNK_LEDS))
+                tx_leds = 2 * CHUNK_LEDS;
+
+            next_led = 0;
+            encode_chunk(chunk[0].data());
+            encode_chunk(chunk[1].data());
+        }
+
+        primask = cm4f::disable_irq();
+        if (spi.get_free_jobs() < 2) {
+            ret = Err::NoMem;
+        } else if constexpr (STREAMING) {
+            ret = spi.write_stream(
+                std::span<uint8_t>{reinterpret_cast<uint8_t*>(chunk[0].data()), CHUNK_BYTES},
+                std::span<uint8_t>{reinterpret_cast<uint8_t*>(chunk[1].data()), CHUNK_BYTES},
+                nullptr, this, redirect_spi_refill, nullptr);
+        } else {
+            ret = spi.write(
+                std::span<uint8_t>{reinterpret_cast<uint8_t*>(fb.data()),
+                    tx_leds * WORDS_PER_LED * sizeof(uint32_t)},
+                nullptr, this, nullptr);
+        }
+
+        if (ret == Err::Ok)
+            ret = spi.write(std::span{RESET}, nullptr, this, redirect_spi_cb);
+        cm4f::restore_irq(primask);
+
+        if (ret != Err::Ok) {
+            dirty = leds;
+            transmitting.store(false, std::memory_order::release);
+        }
+
+        return ret;
+    }
+
+    // Copies a presented frame into the display buffer and marks the LEDs up to the last one which
+    // differs as dirty.
+    void load(const std::array<Rgb, N>& frame) noexcept
     {
-        uint32_t raw = col.to_raw();
+        size_t last = 0;
+
+        for (size_t i = 0; i < N; i++) {
+            if constexpr (STREAMING) {
+                if (fb[i] == frame[i])
+                    continue;
+
+                fb[i] = frame[i];
+            } else {
+                uint32_t raw[WORDS_PER_LED];
+                uint32_t diff = 0;
+
+                encode(raw, frame[i]);
+                for (size_t j = 0; j < WORDS_PER_LED; j++) {
+                    diff |= fb[i * WORDS_PER_LED + j] ^ raw[j];
+                    fb[i * WORDS_PER_LED + j] = raw[j];
+                }
+
+                if (diff == 0)
+                    continue;
+            }
+
+            last = i + 1;
+        }
+
+        if (last > dirty)
+            dirty = last;
+    }
+
+    // Encodes the next LEDs of the stream into the given chunk-buffer and returns the number of
+    // bytes to send from it, 0 once all LEDs have been encoded.
+    size_t encode_chunk(uint32_t* buf) noexcept
+    {
+        size_t leds = tx_leds - next_led;
+
+        if (leds > CHUNK_LEDS)
+            leds = CHUNK_LEDS;
+
+        for (size_t i = 0; i < leds; i++)
+            encode(&buf[i * WORDS_PER_LED], fb[next_led + i]);
+
+        next_led += leds;
+        return leds * WORDS_PER_LED * sizeof(uint32_t);
+    }
+
+    // The levels already have their nibbles swapped, thus the LUT generates the bytes of each
+    // color in the correct order (MSB first).
+    constexpr void calc_levels() noexcept
+    {
+        for (size_t i = 0; i < level.size(); i++) {
+            uint32_t val = gamma ? GAMMA[i] : static_cast<uint32_t>(i);
+
+            val = (val * (static_cast<uint32_t>(brightness) + 1)) >> 8;
+            level[i] = static_cast<uint8_t>(((val >> 4) & 0x0F) | ((val << 4) & 0xF0));
+        }
+    }
+
+    void encode(uint32_t* dst, Rgb col) const noexcept
+    {
+        uint32_t raw = static_cast<uint32_t>(level[col.g]) |
+                       (static_cast<uint32_t>(level[col.r]) << 8) |
+                       (static_cast<uint32_t>(level[col.b]) << 16);
+
         for (size_t i = 0; i < WORDS_PER_LED; i++) {
-            fb[led_idx * WORDS_PER_LED + i] = LUT[raw & 0x0F];
+            dst[i] = LUT[raw & 0x0F];
             raw >>= 4;
         }
     }
 
+    void set_color_unsafe(size_t led_idx, Rgb col) noexcept
+    {
+        if constexpr (PRESENT)
+            back[led_idx] = col;
+
+        if constexpr (STREAMING)
+            fb[led_idx] = col;
+        else
+            encode(&fb[led_idx * WORDS_PER_LED], col);
+
+        if (led_idx >= dirty)
+            dirty = led_idx + 1;
+    }
+
     SpiMaster& spi; // the SPI-module has to be configured to 6MHz SCK, otherwise this won't work
-    std::array<uint32_t, N * WORDS_PER_LED> fb;
+
+    // either the encoded bitstream or just the colors which are encoded into the chunks on the fly
+    std::conditional_t<STREAMING, std::array<Rgb, N>, std::array<uint32_t, N * WORDS_PER_LED>> fb;
+    // the frame presented while the previous one is sent, the colors of the LEDs otherwise
+    std::array<Rgb, PRESENT ? N : 0> back;
+    std::array<std::array<uint32_t, STREAMING ? CHUNK_LEDS * WORDS_PER_LED : 0>, 2> chunk;
+    std::array<uint8_t, 256> level; // gamma and brightness applied, see calc_levels()
+    size_t next_led;
+    size_t tx_leds;
+    size_t dirty; // the number of LEDs up to the last one which has changed since the last frame
+    std::atomic<bool> pending; // the back buffer holds a frame which hasn't been sent yet
     std::atomic<bool> transmitting;
     bool initialized;
+    const bool gamma;
+    uint8_t brightness;
 };
@@ -7,43 +7,41 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cstddef>
 #include <cstdint>
+#include <span>
 
 #include "err.h"
+#include "libc.h"
 #include "spi_master.h"
 #include "w2812b.h"
 
-template<uint16_t WIDTH, uint16_t HEIGHT>
+// All drawing functions only draw into the canvas, which is sent by present(). Thus, drawing never
+// has to wait for the previous frame and several primitives end up in a single frame.
+template<uint16_t WIDTH, uint16_t HEIGHT, W2812BMode MODE = W2812BMode::Encoded>
 class W2812BMatrix {
 public:
-    constexpr explicit W2812BMatrix(SpiMaster& spi) : matrix(spi) {}
+    static constexpr size_t MAX_POLYGON_VERTICES = 16;
 
-    Err clear() noexcept
-    {
-        if (!matrix.is_initialized())
-            return Err::NotInitialized;
+    struct Point {
+        uint16_t x;
+        uint16_t y;
+    };
 
-        if (matrix.is_busy())
-            return Err::Busy;
-
-        matrix.switch_off_all_leds();
-        matrix.refresh_leds();
+    constexpr explicit W2812BMatrix(SpiMaster& spi, bool gamma = false)
+        : matrix(spi, gamma), canvas() {}
 
+    Err clear() noexcept
+    {
+        canvas.fill(Rgb{});
         return Err::Ok;
     }
 
     Err clear(Rgb col) noexcept
     {
-        if (!matrix.is_initialized())
-            return Err::NotInitialized;
-
-        if (matrix.is_busy())
-            return Err::Busy;
-
-        matrix.set_color_for_all_leds(col);
-        matrix.refresh_leds();
-
+        canvas.fill(col);
         return Err::Ok;
     }
 
@@ -52,71 +50,130 @@ public:
         if ((x > (WIDTH - 1)) || (y > (HEIGHT - 1)))
             return Err::OutOfRange;
 
-        if (!matrix.is_initialized())
-            return Err::NotInitialized;
-
-        if (matrix.is_busy())
-            return Err::Busy;
-
         draw_pixel_raw(x, y, col);
-        matrix.refresh_leds();
-
         return Err::Ok;
     }
 
+    // Draws a line of any direction between both points (Bresenham). The points are checked once,
+    // all pixels in between are within the matrix as well.
     Err draw_line(uint16_t x0, uint16_t x1, uint16_t y0, uint16_t y1, Rgb col) noexcept
     {
-        // currently we only support vertical, horizontal and 45deg lines since all other angles
-        // would look rather weird
+        if ((x0 >= WIDTH) || (x1 >= WIDTH) || (y0 >= HEIGHT) || (y1 >= HEIGHT))
+            return Err::OutOfRange;
 
-        uint16_t dx;
-        uint16_t dy;
+        if (y0 == y1)
+            draw_line_horizontal(y0, std::min(x0, x1), std::max(x0, x1), col);
+        else if (x0 == x1)
+            draw_line_vertical(x0, std::min(y0, y1), std::max(y0, y1), col);
+        else
+            draw_line_raw(x0, y0, x1, y1, col);
 
-        if ((x0 > WIDTH) || (x1 > WIDTH) || (y0 > HEIGHT) || (y1 > HEIGHT))
+        return Err::Ok;
+    }
+
+    // midpoint circle algorithm, the whole circle has to be within the matrix
+    Err draw_circle(uint16_t cx, uint16_t cy, uint16_t r, Rgb col) noexcept
+    {
+        if ((cx < r) || (cy < r) || ((cx + r) >= WIDTH) || ((cy + r) >= HEIGHT))
             return Err::OutOfRange;
 
-        if ((x1 <= x0) || (y1 <= y0))
-            return Err::NotOk;
+        for_each_octant(r, [&] (uint16_t x, uint16_t y) {
+            draw_pixel_raw(cx + x, cy + y, col);
+            draw_pixel_raw(cx - x, cy + y, col);
+            draw_pixel_raw(cx + x, cy - y, col);
+            draw_pixel_raw(cx - x, cy - y, col);
+            draw_pixel_raw(cx + y, cy + x, col);
+            draw_pixel_raw(cx - y, cy + x, col);
+            draw_pixel_raw(cx + y, cy - x, col);
+            draw_pixel_raw(cx - y, cy - x, col);
+        });
 
-        if (!matrix.is_initialized())
-            return Err::NotInitialized;
+        return Err::Ok;
+    }
 
-        if (matrix.is_busy())
-            return Err::Busy;
+    Err draw_circle_filled(uint16_t cx, uint16_t cy, uint16_t r, Rgb col) noexcept
+    {
+        if ((cx < r) || (cy < r) || ((cx + r) >= WIDTH) || ((cy + r) >= HEIGHT))
+            return Err::OutOfRange;
 
-        dx = x1 - x0;
-        dy = y1 - y0;
+        // every point of the outline gives a row, the rows near the top and the bottom are drawn
+        // a few times
+        for_each_octant(r, [&] (uint16_t x, uint16_t y) {
+            draw_line_horizontal(cy + y, cx - x, cx + x, col);
+            draw_line_horizontal(cy - y, cx - x, cx + x, col);
+            draw_line_horizontal(cy + x, cx - y, cx + y, col);
+            draw_line_horizontal(cy - x, cx - y, cx + y, col);
+        });
 
-        if (dy == 0) {
-            draw_line_horizontal(y0, x0, x1, col);
-        } else if (dx == 0) {
-            draw_line_vertical(x0, y0, y1, col);
-        } else if (dx == dy) {
-            // diagonal line
-            for (uint16_t x = x0, y = y0; x <= x1; x++, y++)
-                draw_pixel_raw(x, y, col);
-        } else {
+        return Err::Ok;
+    }
+
+    // Fills the polygon of the given vertices (scanline), its edges are drawn as lines as well.
+    // Only the vertices are checked, the polygon doesn't need to be convex.
+    Err draw_polygon_filled(std::span<const Point> vertices, Rgb col) noexcept
+    {
+        std::array<int32_t, MAX_POLYGON_VERTICES> xs;
+        uint16_t ymin = HEIGHT;
+        uint16_t ymax = 0;
+        size_t n = vertices.size();
+
+        if ((n < 3) || (n > MAX_POLYGON_VERTICES))
             return Err::NotSupported;
+
+        for (const Point& p : vertices) {
+            if ((p.x >= WIDTH) || (p.y >= HEIGHT))
+                return Err::OutOfRange;
+
+            ymin = std::min(ymin, p.y);
+            ymax = std::max(ymax, p.y);
+        }
+
+        for (uint16_t y = ymin; y <= ymax; y++) {
+            size_t cnt = 0;
+
+            // the edges are half-open (lower end included, upper one excluded), thus a vertex
+            // shared by two edges is only counted once
+            for (size_t i = 0; i < n; i++) {
+                const Point& a = vertices[i];
+                const Point& b = vertices[(i + 1) % n];
+
+                if ((y >= std::min(a.y, b.y)) && (y < std::max(a.y, b.y))) {
+                    xs[cnt++] = a.x + div_round(
+                        (static_cast<int32_t>(y) - a.y) * (static_cast<int32_t>(b.x) - a.x),
+                        static_cast<int32_t>(b.y) - a.y);
+                }
+            }
+
+            // insertion sort, there are only a few intersections per row
+            for (size_t i = 1; i < cnt; i++) {
+                for (size_t j = i; (j > 0) && (xs[j - 1] > xs[j]); j--)
+                    std::swap(xs[j - 1], xs[j]);
+            }
+
+            for (size_t i = 0; (i + 1) < cnt; i += 2) {
+                draw_line_horizontal(y, static_cast<uint16_t>(xs[i]),
+                    static_cast<uint16_t>(xs[i + 1]), col);
+            }
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            const Point& a = vertices[i];
+            const Point& b = vertices[(i + 1) % n];
+
+            draw_line_raw(a.x, a.y, b.x, b.y, col);
         }
 
-        matrix.refresh_leds();
         return Err::Ok;
     }
 
     Err draw_rectangle(uint16_t x0, uint16_t x1, uint16_t y0, uint16_t y1, Rgb col) noexcept
     {
-        if ((x0 > WIDTH) || (x1 > WIDTH) || (y0 > HEIGHT) || (y1 > HEIGHT))
+        if ((x0 >= WIDTH) || (x1 >= WIDTH) || (y0 >= HEIGHT) || (y1 >= HEIGHT))
             return Err::OutOfRange;
 
         if ((x1 <= x0) || (y1 <= y0))
             return Err::NotOk;
 
-        if (!matrix.is_initialized())
-            return Err::NotInitialized;
-
-        if (matrix.is_busy())
-            return Err::Busy;
-
         for (uint16_t i = x0; i <= x1; i++) {
             draw_pixel_raw(i, y0, col); // top line
             draw_pixel_raw(i, y1, col); // bottom line
@@ -127,47 +184,314 @@ public:
             draw_pixel_raw(x1, i, col); // right vertical line
         }
 
-        matrix.refresh_leds();
         return Err::Ok;
     }
 
     Err draw_rectangle_filled(uint16_t x0, uint16_t x1, uint16_t y0, uint16_t y1, Rgb col) noexcept
     {
-        if ((x0 > WIDTH) || (x1 > WIDTH) || (y0 > HEIGHT) || (y1 > HEIGHT))
+        if ((x0 >= WIDTH) || (x1 >= WIDTH) || (y0 >= HEIGHT) || (y1 >= HEIGHT))
             return Err::OutOfRange;
 
         if ((x1 <= x0) || (y1 <= y0))
             return Err::NotOk;
 
-        if (!matrix.is_initialized())
-            return Err::NotInitialized;
-
-        if (matrix.is_busy())
-            return Err::Busy;
-
         for (uint16_t i = y0; i <= y1; i++)
             draw_line_horizontal(i, x0, x1, col);
 
-        matrix.refresh_leds();
         return Err::Ok;
     }
 
+    // Copies a bitmap of 'w' pixels per row (stored left to right, top to bottom) with its top left
+    // corner to (x, y), the parts outside of the matrix are clipped. A constexpr bitmap stays in
+    // flash. The rows are copied as a whole, each one reversed if the LEDs of the row are
+    // concatenated from right to left.
+    Err blit(int16_t x, int16_t y, std::span<const Rgb> bitmap, uint16_t w) noexcept
+    {
+        return blit_rows(x, y, bitmap, w, nullptr);
+    }
+
+    // same as above, but the pixels with the color 'transparent' are skipped
+    Err blit(int16_t x, int16_t y, std::span<const Rgb> bitmap, uint16_t w,
+        Rgb transparent) noexcept
+    {
+        return blit_rows(x, y, bitmap, w, &transparent);
+    }
+
+    // Draws a monochrome bitmap like a font glyph, every row starts with a new byte and the MSB is
+    // the leftmost pixel. Only the set pixels are drawn with the given color, all others are
+    // transparent.
+    Err blit_mono(int16_t x, int16_t y, std::span<const uint8_t> bitmap, uint16_t w,
+        Rgb col) noexcept
+    {
+        size_t stride = (w + 7U) / 8U;
+        Clip c;
+
+        if ((w == 0) || ((bitmap.size() % stride) != 0))
+            return Err::NotOk;
+
+        c = clip(x, y, w, static_cast<uint16_t>(bitmap.size() / stride));
+        for (uint16_t r = c.r0; r < c.r1; r++) {
+            const uint8_t* src = &bitmap[r * stride];
+
+            for (uint16_t i = c.c0; i < c.c1; i++) {
+                if (src[i / 8] & (0x80 >> (i % 8)))
+                    draw_pixel_raw(static_cast<uint16_t>(x + i), static_cast<uint16_t>(y + r), col);
+            }
+        }
+
+        return Err::Ok;
+    }
+
+    // Moves the whole content by 'n' rows down (or up if negative), the rows which get free are
+    // filled with 'fill'. An even number of rows keeps the direction of every row, thus the rows
+    // are moved at once. Otherwise every row is copied reversed.
+    Err scroll_rows(int16_t n, Rgb fill) noexcept
+    {
+        uint16_t cnt = static_cast<uint16_t>((n < 0) ? -n : n);
+
+        if (cnt >= HEIGHT) {
+            canvas.fill(fill);
+            return Err::Ok;
+        }
+
+        if (cnt == 0)
+            return Err::Ok;
+
+        if ((cnt % 2) == 0) {
+            Rgb* first = row(0);
+            Rgb* moved = row(cnt);
+            size_t len = (HEIGHT - cnt) * WIDTH * sizeof(Rgb);
+
+            if (n > 0)
+                libc::memmove(moved, first, len);
+            else
+                libc::memmove(first, moved, len);
+        } else if (n > 0) {
+            for (uint16_t y = HEIGHT - 1; y >= cnt; y--)
+                copy_row_reversed(y, y - cnt);
+        } else {
+            for (uint16_t y = 0; y < (HEIGHT - cnt); y++)
+                copy_row_reversed(y, y + cnt);
+        }
+
+        if (n > 0)
+            std::fill(row(0), row(cnt), fill);
+        else
+            std::fill(row(HEIGHT - cnt), row(0) + canvas.size(), fill);
+
+        return Err::Ok;
+    }
+
+    // Moves the whole content by 'n' columns to the right (or to the left if negative), the
+    // columns which get free are filled with 'fill'. Every row is moved at once.
+    Err scroll_columns(int16_t n, Rgb fill) noexcept
+    {
+        uint16_t cnt = static_cast<uint16_t>((n < 0) ? -n : n);
+
+        if (cnt >= WIDTH) {
+            canvas.fill(fill);
+            return Err::Ok;
+        }
+
+        if (cnt == 0)
+            return Err::Ok;
+
+        for (uint16_t y = 0; y < HEIGHT; y++) {
+            Rgb* r = row(y);
+            size_t len = (WIDTH - cnt) * sizeof(Rgb);
+
+            // moving right means moving towards the end of the row if it runs from left to right
+            if ((n > 0) == left_to_right(y)) {
+                libc::memmove(r + cnt, r, len);
+                std::fill(r, r + cnt, fill);
+            } else {
+                libc::memmove(r, r + cnt, len);
+                std::fill(r + WIDTH - cnt, r + WIDTH, fill);
+            }
+        }
+
+        return Err::Ok;
+    }
+
+    // Sends everything drawn so far as one frame, see W2812B::present(). If the previous frame is
+    // still being sent, this one follows right after it. Drawing may go on right away, only a third
+    // frame has to wait until the first one has been sent.
+    Err present() noexcept
+    {
+        return matrix.present(canvas);
+    }
+
+    bool is_busy() const noexcept
+    {
+        return matrix.is_busy();
+    }
+
+    // applies to the next frame which is presented
+    Err set_brightness(uint8_t brightness) noexcept
+    {
+        return matrix.set_brightness(brightness);
+    }
+
     Err init() noexcept
     {
         return matrix.init();
     }
 private:
+    // the visible rows and columns of a bitmap
+    struct Clip {
+        uint16_t r0;
+        uint16_t r1;
+        uint16_t c0;
+        uint16_t c1;
+    };
+
+    static constexpr Clip clip(int16_t x, int16_t y, uint16_t w, uint16_t h) noexcept
+    {
+        int32_t c0 = (x < 0) ? -x : 0;
+        int32_t r0 = (y < 0) ? -y : 0;
+        int32_t c1 = static_cast<int32_t>(WIDTH) - x;
+        int32_t r1 = static_cast<int32_t>(HEIGHT) - y;
+
+        if (c1 > w)
+            c1 = w;
+
+        if (r1 > h)
+            r1 = h;
+
+        // completely outside -> nothing to draw
+        if ((c0 >= c1) || (r0 >= r1))
+            return Clip{0, 0, 0, 0};
+
+        return Clip{static_cast<uint16_t>(r0), static_cast<uint16_t>(r1),
+            static_cast<uint16_t>(c0), static_cast<uint16_t>(c1)};
+    }
+
+    Err blit_rows(int16_t x, int16_t y, std::span<const Rgb> bitmap, uint16_t w,
+        const Rgb* transparent) noexcept
+    {
+        Clip c;
+
+        if ((w == 0) || ((bitmap.size() % w) != 0))
+            return Err::NotOk;
+
+        c = clip(x, y, w, static_cast<uint16_t>(bitmap.size() / w));
+        for (uint16_t r = c.r0; r < c.r1; r++) {
+            uint16_t cy = static_cast<uint16_t>(y + r);
+            uint16_t cx = static_cast<uint16_t>(x + c.c0);
+            const Rgb* src = &bitmap[r * w + c.c0];
+            size_t len = c.c1 - c.c0;
+
+            if (transparent) {
+                for (size_t i = 0; i < len; i++) {
+                    if (src[i] != *transparent)
+                        draw_pixel_raw(static_cast<uint16_t>(cx + i), cy, src[i]);
+                }
+            } else if (left_to_right(cy)) {
+                libc::memcpy(row(cy) + cx, src, len * sizeof(Rgb));
+            } else {
+                Rgb* dst = row(cy) + WIDTH - 1 - cx;
+
+                for (size_t i = 0; i < len; i++)
+                    *(dst - i) = src[i];
+            }
+        }
+
+        return Err::Ok;
+    }
+
+    static constexpr bool left_to_right(uint16_t y) noexcept
+    {
+        return (y & 0x01) > 0;
+    }
+
+    inline Rgb* row(uint16_t y) noexcept
+    {
+        return &canvas[y * WIDTH];
+    }
+
+    // the rows run in opposite directions
+    inline void copy_row_reversed(uint16_t dst, uint16_t src) noexcept
+    {
+        Rgb* d = row(dst);
+        const Rgb* s = row(src) + WIDTH - 1;
+
+        for (uint16_t i = 0; i < WIDTH; i++)
+            d[i] = *(s - i);
+    }
+
     inline void draw_pixel_raw(uint16_t x, uint16_t y, Rgb col) noexcept
     {
         if (y & 0x01) {
             // LEDs are concatenated from left to right
-            matrix.set_color_unsafe(y * WIDTH + x, col);
+            canvas[y * WIDTH + x] = col;
         } else {
             // LEDs are concatenated from right to left
-            matrix.set_color_unsafe(y * WIDTH + WIDTH - x - 1, col);
+            canvas[y * WIDTH + WIDTH - x - 1] = col;
+        }
+    }
+
+    // all pixels are within the matrix if both points are
+    void draw_line_raw(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, Rgb col) noexcept
+    {
+        int32_t dx = (x1 > x0) ? (x1 - x0) : (x0 - x1);
+        int32_t dy = (y1 > y0) ? (y0 - y1) : (y1 - y0);
+        int32_t sx = (x1 > x0) ? 1 : -1;
+        int32_t sy = (y1 > y0) ? 1 : -1;
+        int32_t err = dx + dy;
+        int32_t x = x0;
+        int32_t y = y0;
+
+        while (true) {
+            int32_t e2 = 2 * err;
+
+            draw_pixel_raw(static_cast<uint16_t>(x), static_cast<uint16_t>(y), col);
+            if ((x == x1) && (y == y1))
+                break;
+
+            if (e2 >= dy) {
+                err += dy;
+                x += sx;
+            }
+
+            if (e2 <= dx) {
+                err += dx;
+                y += sy;
+            }
         }
     }
 
+    // invokes 'plot' for every point of the first octant of a circle around the origin
+    template<typename F>
+    static void for_each_octant(uint16_t r, F plot) noexcept
+    {
+        int32_t x = r;
+        int32_t y = 0;
+        int32_t err = 1 - x;
+
+        while (x >= y) {
+            plot(static_cast<uint16_t>(x), static_cast<uint16_t>(y));
+            y++;
+
+            if (err < 0) {
+                err += 2 * y + 1;
+            } else {
+                x--;
+                err += 2 * (y - x) + 1;
+            }
+        }
+    }
+
+    // num / den rounded to the nearest integer, 'den' has to be non-zero
+    static constexpr int32_t div_round(int32_t num, int32_t den) noexcept
+    {
+        if (den < 0) {
+            num = -num;
+            den = -den;
+        }
+
+        return (num >= 0) ? ((num + den / 2) / den) : -((-num + den / 2) / den);
+    }
+
     inline void draw_line_horizontal(uint16_t y, uint16_t x0, uint16_t x1, Rgb col) noexcept
     {
         for (uint16_t i = x0; i <= x1; i++)
@@ -180,5 +504,6 @@ private:
             draw_pixel_raw(x, i, col);
     }
 
-    W2812B<WIDTH * HEIGHT> matrix;
+    W2812B<WIDTH * HEIGHT, MODE, true> matrix;
+    std::array<Rgb, WIDTH * HEIGHT> canvas; // drawn into while the previous frame is sent
 };
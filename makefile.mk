@@ -20,6 +20,13 @@ else
 	LD = arm-none-eabi-g++
 endif
 
+# the host simulation (see sim/sim.h) is built with the native compiler
+HOST_SIM ?= 0
+ifeq ($(HOST_SIM),1)
+	CXX = g++
+	LD = g++
+endif
+
 OPENOCD_OPTIONS = -f $(ROOT)/openocd.cfg
 
 TARGET_OPTIONS := \
@@ -56,6 +63,16 @@ LDFLAGS := \
 	-T $(ROOT)/layout.ld \
 	-Xlinker -Map=$(OUTPUT_FILE).map
 
+# the simulation runs as a regular Linux process, the executable isn't position independent since
+# the DMA only handles 32-bit addresses
+ifeq ($(HOST_SIM),1)
+	TARGET_OPTIONS :=
+	CXXFLAGS := $(filter-out -nostdlib -ffreestanding -nostartfiles -nodefaultlibs, $(CXXFLAGS))
+	CXXFLAGS += -fno-pie
+	LDFLAGS := -no-pie -Xlinker -Map=$(OUTPUT_FILE).map
+	MK_DEFS += -DHOST_SIM=1
+endif
+
 # add debug or release specific compiler and linker options
 ifeq ($(RELEASE),1)
 	CXXFLAGS_NOLTO += $(CXXFLAGS) -O2 -fno-lto
@@ -74,6 +91,10 @@ DRIVERS ?=
 # require a .cpp file
 include $(ROOT)/core/core.mk
 
+ifeq ($(HOST_SIM),1)
+include $(ROOT)/sim/sim.mk
+endif
+
 # some peripherals have to be compiled always since they are needed at startup
 PERIPHERALS += flctl pcm sysctl wdt
 
@@ -100,8 +121,11 @@ MAKEFILES_STAGE2 += $(foreach driver, $(_DRIVERS_STAGE2), $(ROOT)/drivers/$(driv
 # include the peripherals first since the drivers are maybe dependent on them
 include $(MAKEFILES_STAGE2)
 
-# the startup file is always necessary, so include it here for all projects
+# the startup file is always necessary, so include it here for all projects (the host simulation
+# is started by the C runtime of the host)
+ifneq ($(HOST_SIM),1)
 SRCS += $(ROOT)/startup.cpp
+endif
 MK_DEFS += -DARM_MATH_CM4=1
 
 # get rid of multiple entries and add the -I flag to the includes
@@ -145,7 +169,13 @@ all: prebuild postbuild
 
 rebuild: clean all
 
-postbuild: $(OUTPUT_FILE).elf $(OUTPUT_FILE).hex $(OUTPUT_FILE).lss
+ifeq ($(HOST_SIM),1)
+POSTBUILD_DEPS = $(OUTPUT_FILE).elf
+else
+POSTBUILD_DEPS = $(OUTPUT_FILE).elf $(OUTPUT_FILE).hex $(OUTPUT_FILE).lss
+endif
+
+postbuild: $(POSTBUILD_DEPS)
 	@echo --
 	@echo -- size of $(PROJ_NAME):
 	@$(SIZE) --format=berkeley $(OUTPUT_FILE).elf
@@ -178,6 +208,10 @@ clean:
 	@echo --
 	@rm -rf $(BUILD_DIR)
 
+.PHONY: run
+run: all
+	@$(OUTPUT_FILE).elf
+
 .PHONY: flash
 flash: $(OUTPUT_FILE).elf
 	$(OPENOCD) $(OPENOCD_OPTIONS) -c "init; reset halt; flash write_image erase $<; verify_image $<; reset; shutdown"
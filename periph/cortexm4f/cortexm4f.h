@@ -10,6 +10,8 @@
 #include "helpers.h"
 #include "register.h"
 
+#include "dwt/dwt.h"
+#include "dwt/profile.h"
 #include "fpu/fpu.h"
 #include "nvic/nvic.h"
 #include "scb/scb.h"
@@ -23,6 +25,7 @@ public:
     CortexM4F& operator=(const CortexM4F&&) = delete;
     constexpr ~CortexM4F() noexcept {}
 
+    Dwt& dwt() noexcept { return m_dwt; }
     Fpu& fpu() noexcept { return m_fpu; }
     Nvic& nvic() noexcept { return m_nvic; }
     SystemControlBlock& scb() noexcept { return m_scb; }
@@ -30,8 +33,9 @@ public:
 
     friend class Msp432;
 private:
-    constexpr explicit CortexM4F() noexcept: m_fpu(), m_nvic(), m_scb(), m_systick() {}
+    constexpr explicit CortexM4F() noexcept: m_dwt(), m_fpu(), m_nvic(), m_scb(), m_systick() {}
 
+    Dwt m_dwt;
     Fpu m_fpu;
     Nvic m_nvic;
     SystemControlBlock m_scb;
@@ -9,11 +9,14 @@ CORTEXM4F_DIR = $(ROOT)/periph/cortexm4f
 
 INCLUDES += \
 	$(CORTEXM4F_DIR) \
+	$(CORTEXM4F_DIR)/dwt \
 	$(CORTEXM4F_DIR)/nvic \
 	$(CORTEXM4F_DIR)/systick
 
 SRCS += \
 	$(CORTEXM4F_DIR)/cortexm4f.cpp \
+	$(CORTEXM4F_DIR)/dwt/dwt.cpp \
+	$(CORTEXM4F_DIR)/dwt/profile.cpp \
 	$(CORTEXM4F_DIR)/fpu/fpu.cpp \
 	$(CORTEXM4F_DIR)/nvic/nvic.cpp \
 	$(CORTEXM4F_DIR)/scb/scb.cpp \
@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ */
+
+#include <cstdint>
+
+#include "dwt.h"
+#include "dwt_regs.h"
+#include "helpers.h"
+#include "register.h"
+
+bool Dwt::has_cycle_counter() const noexcept
+{
+    return (reg().ctrl.get() & dwtregs::ctrl::nocyccnt.mask()) == 0;
+}
+
+void Dwt::enable_cycle_counter() noexcept
+{
+    // the whole DWT unit is only accessible if tracing is enabled
+    dcb().demcr.modify(dcbregs::demcr::trcena.value(1));
+    reg().cyccnt.set(0);
+    reg().ctrl.modify(dwtregs::ctrl::cyccntena.value(1));
+}
+
+void Dwt::disable_cycle_counter() noexcept
+{
+    reg().ctrl.modify(dwtregs::ctrl::cyccntena.value(0));
+}
+
+void Dwt::reset_cycle_counter() noexcept
+{
+    reg().cyccnt.set(0);
+}
@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "dwt_regs.h"
+
+class Dwt {
+public:
+    Dwt(const Dwt&) = delete;
+    Dwt(const Dwt&&) = delete;
+    Dwt& operator=(const Dwt&) = delete;
+    Dwt& operator=(const Dwt&&) = delete;
+    constexpr ~Dwt() noexcept {}
+
+    bool has_cycle_counter() const noexcept;
+    void enable_cycle_counter() noexcept;
+    void disable_cycle_counter() noexcept;
+    void reset_cycle_counter() noexcept;
+
+    // The counter runs with the core clock and wraps around after 2^32 cycles (~89s at 48MHz). The
+    // difference of two values is correct as long as it is calculated with uint32_t arithmetic.
+    inline uint32_t cycles() const noexcept { return reg().cyccnt.get(); }
+
+    friend class CortexM4F;
+private:
+    constexpr explicit Dwt() noexcept : reg_addr(DWT_BASE), dcb_addr(DCB_BASE) {}
+
+    inline DwtRegisters& reg() const noexcept
+    {
+        return *reinterpret_cast<DwtRegisters*>(reg_addr);
+    }
+
+    inline DcbRegisters& dcb() const noexcept
+    {
+        return *reinterpret_cast<DcbRegisters*>(dcb_addr);
+    }
+
+    const size_t reg_addr;
+    const size_t dcb_addr;
+};
@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ */
+
+#pragma once
+
+#include <type_traits>
+#include <cstddef>
+
+#include "helpers.h"
+#include "register.h"
+
+#pragma pack(1)
+class DwtRegisters {
+public:
+    DwtRegisters() = delete;
+    DwtRegisters(DwtRegisters&) = delete;
+    DwtRegisters(DwtRegisters&&) = delete;
+    ~DwtRegisters() = delete;
+
+    ReadWrite<uint32_t> ctrl;
+    ReadWrite<uint32_t> cyccnt;
+    ReadWrite<uint32_t> cpicnt;
+    ReadWrite<uint32_t> exccnt;
+    ReadWrite<uint32_t> sleepcnt;
+    ReadWrite<uint32_t> lsucnt;
+    ReadWrite<uint32_t> foldcnt;
+    ReadOnly<uint32_t> pcsr;
+};
+
+// the debug control block, only the DEMCR register is needed to enable the DWT unit
+class DcbRegisters {
+public:
+    DcbRegisters() = delete;
+    DcbRegisters(DcbRegisters&) = delete;
+    DcbRegisters(DcbRegisters&&) = delete;
+    ~DcbRegisters() = delete;
+
+    ReadWrite<uint32_t> dhcsr;
+    WriteOnly<uint32_t> dcrsr;
+    ReadWrite<uint32_t> dcrdr;
+    ReadWrite<uint32_t> demcr;
+};
+#pragma pack()
+
+static_assert(std::is_standard_layout<DwtRegisters>::value,
+    "DwtRegisters isn't standard layout");
+static_assert(std::is_standard_layout<DcbRegisters>::value,
+    "DcbRegisters isn't standard layout");
+
+constexpr size_t DWT_BASE = 0xE0001000;
+constexpr size_t DCB_BASE = 0xE000EDF0;
+
+namespace dwtregs {
+    namespace ctrl {
+        constexpr BitField<uint32_t> cyccntena{0, 0};
+        constexpr BitField<uint32_t> postpreset{4, 1};
+        constexpr BitField<uint32_t> postinit{8, 5};
+        constexpr BitField<uint32_t> cyctap{9, 9};
+        constexpr BitField<uint32_t> synctap{11, 10};
+        constexpr BitField<uint32_t> pcsamplena{12, 12};
+        constexpr BitField<uint32_t> exctrcena{16, 16};
+        constexpr BitField<uint32_t> cpievtena{17, 17};
+        constexpr BitField<uint32_t> excevtena{18, 18};
+        constexpr BitField<uint32_t> sleepevtena{19, 19};
+        constexpr BitField<uint32_t> lsuevtena{20, 20};
+        constexpr BitField<uint32_t> foldevtena{21, 21};
+        constexpr BitField<uint32_t> cycevtena{22, 22};
+        constexpr BitField<uint32_t> noprfcnt{24, 24};
+        constexpr BitField<uint32_t> nocyccnt{25, 25};
+        constexpr BitField<uint32_t> noexttrig{26, 26};
+        constexpr BitField<uint32_t> notrcpkt{27, 27};
+        constexpr BitField<uint32_t> numcomp{31, 28};
+    }
+}
+
+namespace dcbregs {
+    namespace demcr {
+        constexpr BitField<uint32_t> vc_corereset{0, 0};
+        constexpr BitField<uint32_t> vc_mmerr{4, 4};
+        constexpr BitField<uint32_t> vc_nocperr{5, 5};
+        constexpr BitField<uint32_t> vc_chkerr{6, 6};
+        constexpr BitField<uint32_t> vc_staterr{7, 7};
+        constexpr BitField<uint32_t> vc_buserr{8, 8};
+        constexpr BitField<uint32_t> vc_interr{9, 9};
+        constexpr BitField<uint32_t> vc_harderr{10, 10};
+        constexpr BitField<uint32_t> mon_en{16, 16};
+        constexpr BitField<uint32_t> mon_pend{17, 17};
+        constexpr BitField<uint32_t> mon_step{18, 18};
+        constexpr BitField<uint32_t> mon_req{19, 19};
+        constexpr BitField<uint32_t> trcena{24, 24};
+    }
+}
@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+
+#include "profile.h"
+
+constinit std::atomic<ProfileSection*> ProfileSection::sections{nullptr};
+
+void ProfileSection::record(uint32_t cycles) noexcept
+{
+    if (!registered.exchange(true, std::memory_order::relaxed)) {
+        // lock-free push to the front of the list since a section could be registered from within
+        // an interrupt handler at any time
+        ProfileSection* head = sections.load(std::memory_order::relaxed);
+        do {
+            m_next = head;
+        } while (!sections.compare_exchange_weak(head, this, std::memory_order::release,
+            std::memory_order::relaxed));
+    }
+
+    cnt = cnt + 1;
+    total = total + cycles;
+    if (cycles < min_cycles)
+        min_cycles = cycles;
+    if (cycles > max_cycles)
+        max_cycles = cycles;
+}
+
+void ProfileSection::reset() noexcept
+{
+    cnt = 0;
+    total = 0;
+    min_cycles = std::numeric_limits<uint32_t>::max();
+    max_cycles = 0;
+}
+
+uint32_t ProfileSection::mean() const noexcept
+{
+    if (cnt == 0)
+        return 0;
+
+    return static_cast<uint32_t>(total / cnt);
+}
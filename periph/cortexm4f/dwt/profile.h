@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ *
+ * Cycle accurate profiling based on the DWT cycle counter. A ProfileSection accumulates the
+ * min/max/mean number of cycles of a code section, a ScopedProbe measures the cycles from its
+ * construction until it goes out of scope:
+ *
+ *     static constinit ProfileSection dma_irq{"dma_irq"};
+ *
+ *     void handler() noexcept
+ *     {
+ *         ScopedProbe probe{Msp432::instance().cortexm4f().dwt(), dma_irq};
+ *         ...
+ *     }
+ *
+ * Every section registers itself on its first measurement, all measured sections can be iterated
+ * with ProfileSection::first() and next(). The cycle counter has to be enabled with
+ * Dwt::enable_cycle_counter() before. A probe without a DWT (nullptr) measures nothing, thus the
+ * drivers keep their probes in place and are only measured once a DWT is handed to them.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "dwt.h"
+
+class ProfileSection {
+public:
+    constexpr explicit ProfileSection(const char* name) noexcept
+        : m_name(name), m_next(nullptr), registered(false), cnt(0), total(0),
+        min_cycles(std::numeric_limits<uint32_t>::max()), max_cycles(0) {}
+    ProfileSection(const ProfileSection&) = delete;
+    ProfileSection(const ProfileSection&&) = delete;
+    ProfileSection& operator=(const ProfileSection&) = delete;
+    ProfileSection& operator=(const ProfileSection&&) = delete;
+    constexpr ~ProfileSection() noexcept {}
+
+    // Must only be called from a single context (or from contexts which can't preempt each other),
+    // the statistics are not updated atomically.
+    void record(uint32_t cycles) noexcept;
+    void reset() noexcept;
+
+    const char* name() const noexcept { return m_name; }
+    uint32_t count() const noexcept { return cnt; }
+    uint32_t min() const noexcept { return cnt > 0 ? min_cycles : 0; }
+    uint32_t max() const noexcept { return max_cycles; }
+    uint32_t mean() const noexcept;
+
+    static ProfileSection* first() noexcept { return sections.load(std::memory_order::acquire); }
+    ProfileSection* next() const noexcept { return m_next; }
+
+private:
+    static constinit std::atomic<ProfileSection*> sections;
+
+    const char* const m_name;
+    ProfileSection* m_next;
+    std::atomic<bool> registered;
+    uint32_t cnt;
+    uint64_t total;
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+};
+
+class ScopedProbe {
+public:
+    inline explicit ScopedProbe(const Dwt& dwt, ProfileSection& section) noexcept
+        : ScopedProbe(&dwt, section) {}
+    inline explicit ScopedProbe(const Dwt* dwt, ProfileSection& section) noexcept
+        : dwt(dwt), section(section), start(dwt ? dwt->cycles() : 0) {}
+    ScopedProbe(const ScopedProbe&) = delete;
+    ScopedProbe(const ScopedProbe&&) = delete;
+    ScopedProbe& operator=(const ScopedProbe&) = delete;
+    ScopedProbe& operator=(const ScopedProbe&&) = delete;
+
+    // unsigned arithmetic handles the wrap around of the cycle counter
+    inline ~ScopedProbe() noexcept
+    {
+        if (dwt)
+            section.record(dwt->cycles() - start);
+    }
+
+private:
+    const Dwt* const dwt;
+    ProfileSection& section;
+    const uint32_t start;
+};
@@ -42,5 +42,5 @@ void Nvic::disable_all_interrupts() noexcept
 
 void Nvic::clear_pending(size_t idx) noexcept
 {
-    reg().icer[(idx >> 5) & 0x01].set(idx & 0x1F);
+    reg().icpr[(idx >> 5) & 0x01].set(hlp::bit<uint32_t>(idx & 0x1F));
 }
@@ -7,17 +7,28 @@
 
 #include <cstdint>
 
+#include "cm4f.h"
 #include "systick.h"
 #include "systick_regs.h"
 #include "helpers.h"
 #include "register.h"
 
 constexpr uint32_t DIVIDE_TO_1MS = 1000;
+constexpr uint32_t MAX_RELOAD = 0x00FFFFFF;
+
+// the shortest period which is used while sleeping, a reload value of 0 would stop the interrupts
+constexpr uint32_t MIN_PERIOD = 64;
 
 void Systick::start(uint32_t clk) noexcept
 {
-    // we want an interrupt every 1ms
-    reg().strvr.set(systickregs::strvr::reload.value(clk / DIVIDE_TO_1MS));
+    cyc_per_ms = clk / DIVIDE_TO_1MS;
+    max_period = ((MAX_RELOAD + 1) / cyc_per_ms) * cyc_per_ms;
+    period = max_period;
+    frac = 0;
+    up = 0;
+
+    reg().strvr.set(systickregs::strvr::reload.value(period - 1));
+    reg().stcvr.set(0); // any write clears the counter
 
     // enable interrupt and enbale timer
     reg().stcsr.modify(systickregs::stcsr::tickint.value(1) + systickregs::stcsr::enable.value(1));
@@ -30,11 +41,91 @@ void Systick::stop() noexcept
 
 uint64_t Systick::uptime_ms() const noexcept
 {
-    return up;
+    uint32_t primask = cm4f::disable_irq();
+    uint32_t cycles = frac + elapsed_cycles();
+    uint64_t ret = up + cycles / cyc_per_ms;
+    cm4f::restore_irq(primask);
+
+    return ret;
+}
+
+void Systick::sleep_ms(uint32_t ms) noexcept
+{
+    uint64_t until = uptime_ms() + static_cast<uint64_t>(ms);
+
+    while (true) {
+        // WFI also wakes up on a pending interrupt if PRIMASK is set, this avoids missing an
+        // interrupt between checking the time and going to sleep
+        uint32_t primask = cm4f::disable_irq();
+        uint32_t cycles = frac + elapsed_cycles();
+        uint64_t now = up + cycles / cyc_per_ms;
+
+        if (now >= until) {
+            cm4f::restore_irq(primask);
+            break;
+        }
+
+        // shorten the current period if we have to wake up before its end, if the Systick is
+        // pending the period is handled within the interrupt first
+        if (!is_pending()) {
+            uint64_t remaining = (until - now) * cyc_per_ms - (cycles % cyc_per_ms);
+            if (remaining <= reg().stcvr.get())
+                restart(remaining > MIN_PERIOD ? static_cast<uint32_t>(remaining) : MIN_PERIOD);
+        }
+
+        cm4f::wait_for_interrupt();
+        cm4f::restore_irq(primask);
+    }
 }
 
 void Systick::handle_interrupt() noexcept
+{
+    uint32_t primask = cm4f::disable_irq();
+
+    add_cycles(period);
+
+    // a shortened period elapsed, continue with the regular one
+    if (period != max_period)
+        restart(max_period);
+
+    cm4f::restore_irq(primask);
+}
+
+bool Systick::is_pending() const noexcept
+{
+    return (scb().icsr.get() & scbregs::icsr::pendstset.mask()) > 0;
+}
+
+uint32_t Systick::elapsed_cycles() const noexcept
+{
+    // must be called with disabled interrupts
+    uint32_t cnt = reg().stcvr.get();
+
+    // The counter wrapped around but the interrupt wasn't handled yet, read the counter again since
+    // it could have wrapped after reading it.
+    if (is_pending()) {
+        cnt = reg().stcvr.get();
+        return period + (period - 1 - cnt);
+    }
+
+    return period - 1 - cnt;
+}
+
+void Systick::add_cycles(uint32_t cycles) noexcept
 {
     // since C++ 20 the ++ and += operator were deprecated for volatile operations
-    up = up + 1;
+    frac = frac + cycles;
+    up = up + frac / cyc_per_ms;
+    frac = frac % cyc_per_ms;
+}
+
+void Systick::restart(uint32_t cycles) noexcept
+{
+    // must be called with disabled interrupts, the cycles of the current period up to now are
+    // added, the new period starts with the next clock cycle
+    add_cycles(period - reg().stcvr.get());
+
+    reg().strvr.set(systickregs::strvr::reload.value(cycles - 1));
+    reg().stcvr.set(0);
+    period = cycles;
 }
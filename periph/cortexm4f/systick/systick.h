@@ -3,6 +3,10 @@
 /*
  * Created by lebakassemmerl 2022
  * E-Mail: hotschi@gmx.at
+ *
+ * The Systick runs tickless: the reload value is the biggest multiple of 1ms which fits into the
+ * 24-bit counter (349ms at 48MHz), the uptime is derived from the current value of the counter.
+ * While sleeping, the current period is shortened in order to wake up at the right time.
  */
 
 #pragma once
@@ -10,6 +14,7 @@
 #include <cstddef>
 #include <cstdint>
 
+#include "scb/scb_regs.h"
 #include "systick_regs.h"
 
 class Systick {
@@ -25,18 +30,37 @@ public:
 
     uint64_t uptime_ms() const noexcept;
 
+    // Sleeps (WFI) until the given time elapsed. Other interrupts are still handled meanwhile.
+    void sleep_ms(uint32_t ms) noexcept;
+
     friend class CortexM4F;
     friend void systick_handler(void) noexcept;
 private:
-    constexpr explicit Systick() noexcept : reg_addr(SYSTICK_BASE), up(0) {}
+    constexpr explicit Systick() noexcept
+        : reg_addr(SYSTICK_BASE), scb_addr(SCB_BASE), cyc_per_ms(0), max_period(0), period(0),
+        frac(0), up(0) {}
 
     inline SystickRegisters& reg() const noexcept
     {
         return *reinterpret_cast<SystickRegisters*>(reg_addr);
     }
 
+    inline ScbRegisters& scb() const noexcept
+    {
+        return *reinterpret_cast<ScbRegisters*>(scb_addr);
+    }
+
     void handle_interrupt() noexcept;
+    bool is_pending() const noexcept;
+    uint32_t elapsed_cycles() const noexcept;
+    void add_cycles(uint32_t cycles) noexcept;
+    void restart(uint32_t cycles) noexcept;
 
     const size_t reg_addr;
+    const size_t scb_addr;
+    uint32_t cyc_per_ms;
+    uint32_t max_period;
+    uint32_t period; // number of cycles of the current period
+    uint32_t frac; // cycles of the current millisecond which are not contained in up
     uint64_t up;
-};
\ No newline at end of file
+};
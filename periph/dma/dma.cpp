@@ -19,21 +19,29 @@ void Dma::init() noexcept
     // enable the DMA module
     reg().cfg.set(dmaregs::cfg::masten.value(1));
 
-    uint32_t addr = reinterpret_cast<uint32_t>(&dma_ctrl[0]);
+    uint32_t addr = dma_addr(&dma_ctrl[0]);
     reg().ctlbase.set(addr);
 }
 
+void Dma::enable_profiling(const Dwt& dwt) noexcept
+{
+    for (DmaChannel& chan : dma_channels)
+        chan.dwt = &dwt;
+}
+
 void Dma::handle_interrupt(int num) noexcept
 {
-    uint32_t irq = reg().int0_srcflg.get();
-    for (size_t i = 0; i <  DMA_CHANNEL_CNT; i++) {
-        uint32_t bit = 1 << i;
-        if (bit & irq) {
-            // clear interrupt flag
-            reg().int0_clrflg.set(bit);
-
-            // call interrupt handler
-            dma_channels[i].handle_interrupt();
-        }
+    uint32_t irq = reg().int0_srcflg.get() & hlp::mask<uint32_t>(DMA_CHANNEL_CNT - 1, 0);
+
+    // only visit the channels which actually have their flag set
+    while (irq) {
+        uint32_t i = static_cast<uint32_t>(std::countr_zero(irq));
+        irq &= irq - 1;
+
+        // clear interrupt flag
+        reg().int0_clrflg.set(hlp::bit<uint32_t>(i));
+
+        // call interrupt handler
+        dma_channels[i].handle_interrupt();
     }
 }
@@ -8,9 +8,13 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
+#include <span>
 
+#include "dwt.h"
 #include "err.h"
 #include "helpers.h"
+#include "profile.h"
 #include "register.h"
 
 #include "dma_regs.h"
@@ -48,13 +52,16 @@ enum class DmaMode : uint8_t {
     AutoRequest = 2,
     PingPong = 3,
     MemoryScatterGather = 4,
+    AlternateMemoryScatterGather = 5,
     PeripheralScatterGather = 6,
+    AlternatePeripheralScatterGather = 7,
 };
 
 enum class DmaTransferType : uint8_t {
     PeripheralToMemory,
     PeripheralToMemoryPingPong,
     MemoryToPeripheral,
+    MemoryToPeripheralPingPong,
     MemoryToMemory,
     Custom,
     None,
@@ -73,6 +80,25 @@ enum class DmaPtrIncrement : uint8_t {
     NoIncr,
 };
 
+// The DMA-controller only handles 32-bit addresses. Within the host simulation (see sim/sim.h) the
+// buffers have to be located within the lower 4GiB of the address space, which is the case for the
+// static data of a non-PIE executable.
+inline uint32_t dma_addr(const volatile void* ptr) noexcept
+{
+#ifdef HOST_SIM
+    if (reinterpret_cast<uintptr_t>(ptr) > UINT32_MAX)
+        sim::fault("DMA buffer located above 4GiB");
+#endif
+
+    return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(ptr));
+}
+
+// Invoked in interrupt-context whenever one half of a ping-pong transfer has finished. 'buf' points to
+// the memory-side buffer of the finished half (the destination for RX, the source for TX). The
+// return value is the number of bytes which shall be transferred with this buffer next (at most its
+// initial length), returning 0 ends the stream as soon as the other half has finished too.
+typedef size_t (*DmaHalfDoneCallback)(uint8_t* buf, size_t len, void* instance);
+
 struct DmaConfig {
     constexpr explicit DmaConfig(uint8_t src_chan, DmaDataWidth width, DmaPtrIncrement src_incr,
         DmaPtrIncrement dst_incr, void* instance,
@@ -93,6 +119,96 @@ struct DmaConfig {
     void (*done)(const uint8_t* src_buf, uint8_t* dst_buf, size_t len, void* instance);
 };
 
+// maximum number of transfers of a single control structure
+constexpr size_t MAX_TRANSFERS_LEN = 1024;
+
+// The task list is copied word by word into the alternate control structure by the primary one,
+// thus its length is limited by the maximum number of transfers of a single control structure.
+constexpr size_t MAX_DMA_TASKS = MAX_TRANSFERS_LEN / 4;
+
+// Builder for the task list of a scatter-gather transfer. Each task describes one contiguous
+// transfer (src, dst, len) which is executed by the DMA one after another without any interaction
+// of the CPU. Only the completion of the last task triggers an interrupt.
+template<size_t N>
+class DmaTaskList {
+public:
+    static_assert((N > 0) && (N <= MAX_DMA_TASKS), "DmaTaskList: invalid number of tasks");
+
+    constexpr explicit DmaTaskList(DmaDataWidth width) noexcept
+        : tasks(), width(width), cnt(0), num_bytes(0), first_src(nullptr), first_dst(nullptr) {}
+
+    Err add(const uint8_t* src, uint8_t* dst, uint32_t len, DmaPtrIncrement src_incr,
+        DmaPtrIncrement dst_incr) noexcept
+    {
+        uint32_t w = static_cast<uint32_t>(width);
+        uint32_t transfers = len >> w;
+
+        if ((!src) || (!dst))
+            return Err::NullPtr;
+
+        if (transfers == 0)
+            return Err::Empty;
+
+        if (transfers > MAX_TRANSFERS_LEN)
+            return Err::OutOfRange;
+
+        if (cnt >= N)
+            return Err::NoMem;
+
+        DmaChannelControl& task = tasks[cnt];
+        task.src_ptr.set(end_ptr(src, transfers, src_incr));
+        task.dst_ptr.set(end_ptr(dst, transfers, dst_incr));
+
+        // 'cycle_ctrl' is set by the DMA-channel when starting the transfer, since it depends on
+        // the position of the task within the list and the type of the scatter-gather transfer
+        task.ctrl.set(
+            dmactrl::ctrl::src_size.raw_value(w) |
+            dmactrl::ctrl::dst_size.raw_value(w) |
+            dmactrl::ctrl::src_inc.raw_value(static_cast<uint32_t>(src_incr)) |
+            dmactrl::ctrl::dst_inc.raw_value(static_cast<uint32_t>(dst_incr)) |
+            dmactrl::ctrl::n_minus_1.raw_value(transfers - 1) |
+            dmactrl::ctrl::r_power.raw_value(0)
+        );
+
+        if (cnt == 0) {
+            first_src = src;
+            first_dst = dst;
+        }
+
+        cnt++;
+        num_bytes += len;
+        return Err::Ok;
+    }
+
+    constexpr void clear() noexcept
+    {
+        cnt = 0;
+        num_bytes = 0;
+    }
+
+    constexpr size_t size() const noexcept { return cnt; }
+    constexpr bool is_empty() const noexcept { return cnt == 0; }
+
+    friend class DmaChannel;
+private:
+    static uint32_t end_ptr(const uint8_t* start, uint32_t transfers, DmaPtrIncrement incr) noexcept
+    {
+        uint32_t ptr = dma_addr(start);
+
+        if (incr != DmaPtrIncrement::NoIncr)
+            ptr += (transfers - 1) << static_cast<uint32_t>(incr);
+
+        return ptr;
+    }
+
+    std::array<DmaChannelControl, N> tasks;
+    DmaDataWidth width;
+    size_t cnt;
+    size_t num_bytes;
+    const uint8_t* first_src;
+    uint8_t* first_dst;
+};
+
 class DmaChannel {
 public:
     Err setup(const DmaConfig& conf) noexcept;
@@ -102,9 +218,44 @@ public:
     Err transfer_custom(const uint8_t* src, uint8_t* dst, DmaPtrIncrement src_incr,
         DmaPtrIncrement dst_incr, uint32_t len) noexcept;
 
+    // Continuous transfers which alternate between two buffers using the primary and the alternate
+    // control structure. Each buffer can hold at most MAX_TRANSFERS_LEN transfers. The callback
+    // 'half_done' is invoked for every finished buffer, 'conf.done' once the whole stream has ended.
+    // stop_ping_pong() ends the stream after the currently queued half.
+    Err transfer_ping_pong_periph_to_mem(const uint8_t* src, uint8_t* dst_a, uint8_t* dst_b,
+        uint32_t len, DmaHalfDoneCallback half_done) noexcept;
+    Err transfer_ping_pong_mem_to_periph(const uint8_t* src_a, const uint8_t* src_b, uint8_t* dst,
+        uint32_t len, DmaHalfDoneCallback half_done) noexcept;
+    void stop_ping_pong() noexcept { pp.stopping = true; }
+    size_t ping_pong_transferred() const noexcept;
+
+    // Aborts a basic transfer which still waits for requests of the peripheral, e.g. after the
+    // peripheral ended the transfer because of an error. 'conf.done' isn't invoked, not even for a
+    // completion which is already pending.
+    void cancel() noexcept;
+
+    // Executes all tasks of the list in one hardware-sequenced chain, 'conf.done' is invoked once
+    // after the last task. 'mode' has to be either DmaMode::MemoryScatterGather or
+    // DmaMode::PeripheralScatterGather. The list must stay untouched until the transfer finished.
+    template<size_t N>
+    Err transfer_task_list(DmaTaskList<N>& list, DmaMode mode) noexcept
+    {
+        if (list.is_empty())
+            return Err::Empty;
+
+        return start_scatter_gather(std::span<DmaChannelControl>{list.tasks.data(), list.cnt},
+            list.first_src, list.first_dst, list.num_bytes, mode);
+    }
+
+    // cycles spent within the interrupt handler of this channel, see Dma::enable_profiling()
+    const ProfileSection& irq_profile() const noexcept { return profile; }
+
     friend class Dma;
 private:
-    static constexpr size_t MAX_TRANSFERS_LEN = 1024;
+    static constexpr std::array<const char*, DMA_CHANNEL_CNT> PROFILE_NAMES = {
+        "dma_ch0", "dma_ch1", "dma_ch2", "dma_ch3", "dma_ch4", "dma_ch5", "dma_ch6", "dma_ch7"
+    };
+
     struct TransferInfo {
         const uint8_t* src;
         uint8_t* dst;
@@ -118,9 +269,24 @@ private:
             type(DmaTransferType::None), busy(false) {}
     };
 
+    struct PingPongInfo {
+        uint8_t* periph;
+        std::array<uint8_t*, 2> buf;
+        std::array<size_t, 2> cap;
+        std::array<size_t, 2> len;
+        uint8_t half; // the half which is currently transferred, 0 = primary, 1 = alternate
+        bool stopping;
+        DmaHalfDoneCallback half_done;
+
+        constexpr explicit PingPongInfo() noexcept
+            : periph(nullptr), buf{nullptr, nullptr}, cap{0, 0}, len{0, 0}, half(0),
+            stopping(false), half_done(nullptr) {}
+    };
+
     constexpr explicit DmaChannel(uint8_t idx, DmaChannelControl& prim, DmaChannelControl& alt)
         noexcept : idx(idx), reg_addr(DMA_BASE), ctrl_prim(prim), ctrl_alt(alt),
-        mode(DmaMode::Basic), info(), conf(), in_use(false) {}
+        mode(DmaMode::Basic), info(), pp(), conf(), in_use(false), dwt(nullptr),
+        profile(PROFILE_NAMES[idx]) {}
 
     inline DmaRegisters& reg() const noexcept
     {
@@ -132,6 +298,12 @@ private:
     void update_dma_pointers() noexcept;
     void enable_channel() noexcept;
     void config_prim_channel(uint32_t bytes_to_transmit) noexcept;
+    Err start_ping_pong(DmaTransferType type, uint8_t* periph, uint8_t* buf_a, uint8_t* buf_b,
+        uint32_t len, DmaHalfDoneCallback half_done) noexcept;
+    void arm_ping_pong_half(uint8_t half, size_t len) noexcept;
+    void handle_ping_pong() noexcept;
+    Err start_scatter_gather(std::span<DmaChannelControl> tasks, const uint8_t* src, uint8_t* dst,
+        size_t num_bytes, DmaMode mode) noexcept;
 
     const uint8_t idx;
     const size_t reg_addr;
@@ -140,8 +312,11 @@ private:
 
     DmaMode mode;
     DmaChannel::TransferInfo info;
+    DmaChannel::PingPongInfo pp;
     DmaConfig conf;
     bool in_use;
+    const Dwt* dwt;
+    ProfileSection profile;
 };
 
 class Dma {
@@ -153,11 +328,19 @@ public:
     constexpr ~Dma() noexcept {}
     void init() noexcept;
 
+    // Measures the interrupt handlers of all channels from now on, the cycle counter of the DWT has
+    // to be enabled.
+    void enable_profiling(const Dwt& dwt) noexcept;
+
     // FIXME: implement a way to check if the channel is already in use
     constexpr DmaChannel& operator[](uint8_t chan) noexcept { return dma_channels[chan]; }
 
     friend class Msp432;
-    friend void periph_int_handler(void) noexcept;
+    friend void dma_err_handler(void) noexcept;
+    friend void dma_int0_handler(void) noexcept;
+    friend void dma_int1_handler(void) noexcept;
+    friend void dma_int2_handler(void) noexcept;
+    friend void dma_int3_handler(void) noexcept;
 private:
     constexpr explicit Dma() noexcept
         : reg_addr(DMA_BASE), dma_ctrl(), dma_channels{
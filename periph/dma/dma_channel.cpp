@@ -13,6 +13,7 @@
 
 #include "dma_regs.h"
 #include "dma.h"
+#include "profile.h"
 
 
 Err DmaChannel::setup(const DmaConfig& conf) noexcept
@@ -61,8 +62,8 @@ Err DmaChannel::transfer_mem_to_periph(const uint8_t* src, uint8_t* dst, uint32_
     else
         bytes_to_transmit = MAX_TRANSFERS_LEN;
 
-    src_end_ptr = reinterpret_cast<uint32_t>(src) + (bytes_to_transmit - 1);
-    dst_end_ptr = reinterpret_cast<uint32_t>(dst);
+    src_end_ptr = dma_addr(src) + (bytes_to_transmit - 1);
+    dst_end_ptr = dma_addr(dst);
 
     mode = DmaMode::Basic;
     ctrl_prim.src_ptr.set(src_end_ptr);
@@ -109,8 +110,8 @@ Err DmaChannel::transfer_periph_to_mem(const uint8_t* src, uint8_t* dst, uint32_
     else
         bytes_to_transmit = MAX_TRANSFERS_LEN;
 
-    src_end_ptr = reinterpret_cast<uint32_t>(src);
-    dst_end_ptr = reinterpret_cast<uint32_t>(dst) + (bytes_to_transmit - 1);
+    src_end_ptr = dma_addr(src);
+    dst_end_ptr = dma_addr(dst) + (bytes_to_transmit - 1);
 
     mode = DmaMode::Basic;
     ctrl_prim.src_ptr.set(src_end_ptr);
@@ -158,8 +159,8 @@ Err DmaChannel::transfer_custom(const uint8_t* src, uint8_t* dst, DmaPtrIncremen
     else
         bytes_to_transmit = MAX_TRANSFERS_LEN;
 
-    src_end_ptr = reinterpret_cast<uint32_t>(src);
-    dst_end_ptr = reinterpret_cast<uint32_t>(dst);
+    src_end_ptr = dma_addr(src);
+    dst_end_ptr = dma_addr(dst);
 
     if (src_incr != DmaPtrIncrement::NoIncr)
         src_end_ptr += bytes_to_transmit - 1;
@@ -187,6 +188,239 @@ Err DmaChannel::transfer_custom(const uint8_t* src, uint8_t* dst, DmaPtrIncremen
     return Err::Ok;
 }
 
+Err DmaChannel::transfer_ping_pong_periph_to_mem(const uint8_t* src, uint8_t* dst_a,
+    uint8_t* dst_b, uint32_t len, DmaHalfDoneCallback half_done) noexcept
+{
+    return start_ping_pong(DmaTransferType::PeripheralToMemoryPingPong, const_cast<uint8_t*>(src),
+        dst_a, dst_b, len, half_done);
+}
+
+Err DmaChannel::transfer_ping_pong_mem_to_periph(const uint8_t* src_a, const uint8_t* src_b,
+    uint8_t* dst, uint32_t len, DmaHalfDoneCallback half_done) noexcept
+{
+    return start_ping_pong(DmaTransferType::MemoryToPeripheralPingPong, dst,
+        const_cast<uint8_t*>(src_a), const_cast<uint8_t*>(src_b), len, half_done);
+}
+
+Err DmaChannel::start_ping_pong(DmaTransferType type, uint8_t* periph, uint8_t* buf_a,
+    uint8_t* buf_b, uint32_t len, DmaHalfDoneCallback half_done) noexcept
+{
+    if (!in_use)
+        return Err::NotInitialized;
+
+    if ((!periph) || (!buf_a) || (!buf_b) || (!half_done))
+        return Err::NullPtr;
+
+    if ((len >> static_cast<uint32_t>(conf.width)) == 0)
+        return Err::Empty;
+
+    if ((len >> static_cast<uint32_t>(conf.width)) > MAX_TRANSFERS_LEN)
+        return Err::OutOfRange;
+
+    if (info.busy)
+        return Err::Busy;
+
+    info.busy = true;
+    info.type = type;
+    info.num_bytes = 0;
+    info.remaining_words = 0;
+    mode = DmaMode::PingPong;
+
+    pp.periph = periph;
+    pp.buf = {buf_a, buf_b};
+    pp.cap = {len, len};
+    pp.half = 0;
+    pp.stopping = false;
+    pp.half_done = half_done;
+
+    if (type == DmaTransferType::PeripheralToMemoryPingPong) {
+        info.src = periph;
+        info.dst = buf_a;
+    } else {
+        info.src = buf_a;
+        info.dst = periph;
+    }
+
+    // prepare both halves before enabling the channel, the controller switches to the alternate
+    // structure on its own as soon as the primary one is done
+    arm_ping_pong_half(0, len);
+    arm_ping_pong_half(1, len);
+
+    // always start with the primary control structure
+    reg().altclr.set(hlp::bit<uint32_t>(idx));
+    enable_channel();
+
+    return Err::Ok;
+}
+
+void DmaChannel::arm_ping_pong_half(uint8_t half, size_t len) noexcept
+{
+    DmaChannelControl& ctrl = (half == 0) ? ctrl_prim : ctrl_alt;
+    uint32_t width = static_cast<uint32_t>(conf.width);
+    uint32_t transfers = static_cast<uint32_t>(len) >> width;
+    uint32_t buf_end = dma_addr(pp.buf[half]) + ((transfers - 1) << width);
+    uint32_t periph = dma_addr(pp.periph);
+    uint32_t buf_incr = width;
+
+    pp.len[half] = len;
+
+    if (info.type == DmaTransferType::PeripheralToMemoryPingPong) {
+        ctrl.src_ptr.set(periph);
+        ctrl.dst_ptr.set(buf_end);
+    } else {
+        ctrl.src_ptr.set(buf_end);
+        ctrl.dst_ptr.set(periph);
+    }
+
+    // the whole control word is written at once since the controller overwrites 'cycle_ctrl' and
+    // 'n_minus_1' of the structure it has just finished
+    ctrl.ctrl.set(
+        dmactrl::ctrl::src_size.raw_value(width) |
+        dmactrl::ctrl::dst_size.raw_value(width) |
+        dmactrl::ctrl::src_inc.raw_value((info.type == DmaTransferType::PeripheralToMemoryPingPong)
+            ? static_cast<uint32_t>(DmaPtrIncrement::NoIncr) : buf_incr) |
+        dmactrl::ctrl::dst_inc.raw_value((info.type == DmaTransferType::PeripheralToMemoryPingPong)
+            ? buf_incr : static_cast<uint32_t>(DmaPtrIncrement::NoIncr)) |
+        dmactrl::ctrl::n_minus_1.raw_value(transfers - 1) |
+        dmactrl::ctrl::r_power.raw_value(0) |
+        dmactrl::ctrl::cycle_ctrl.raw_value(static_cast<uint32_t>(DmaMode::PingPong))
+    );
+}
+
+size_t DmaChannel::ping_pong_transferred() const noexcept
+{
+    // The controller writes the updated control word back to the control structure after every
+    // transfer, thus we can tell how far the currently running half has progressed. This value is
+    // only consistent if the interrupt didn't switch the halves in the meantime, the caller has to
+    // take care of that.
+    uint8_t half = *static_cast<const volatile uint8_t*>(&pp.half);
+    const DmaChannelControl& ctrl = (half == 0) ? ctrl_prim : ctrl_alt;
+    uint32_t raw = ctrl.ctrl.get();
+    uint32_t width = static_cast<uint32_t>(conf.width);
+    size_t len = pp.len[half];
+
+    if (!info.busy || (mode != DmaMode::PingPong))
+        return 0;
+
+    // the half has finished, but the interrupt hasn't been handled yet
+    if ((raw & dmactrl::ctrl::cycle_ctrl.mask()) == 0)
+        return len;
+
+    uint32_t remaining = ((raw & dmactrl::ctrl::n_minus_1.mask())
+        >> std::countr_zero(dmactrl::ctrl::n_minus_1.mask())) + 1;
+    return len - (static_cast<size_t>(remaining) << width);
+}
+
+void DmaChannel::handle_ping_pong() noexcept
+{
+    uint8_t half = pp.half;
+    size_t len = pp.len[half];
+    size_t next;
+
+    // the controller has already switched over to the other half
+    pp.half ^= 1;
+    pp.len[half] = 0;
+    info.num_bytes += len;
+
+    // the data of the finished half is always handed over, even if the stream is about to end
+    next = pp.half_done(pp.buf[half], len, conf.instance);
+    if (next > pp.cap[half])
+        next = pp.cap[half];
+
+    // once a half isn't re-armed anymore, the controller stops there -> don't re-arm any other half
+    if (pp.stopping || ((next >> static_cast<uint32_t>(conf.width)) == 0)) {
+        pp.stopping = true;
+        next = 0;
+    }
+
+    if (next > 0) {
+        // Re-arm the finished half while the other one is still running. If the other half was not
+        // re-armed, this one was the last one and the controller stops once it reaches it.
+        arm_ping_pong_half(half, next);
+    } else if (pp.len[pp.half] == 0) {
+        // both halves are done -> the stream has ended and the controller disabled the channel
+        info.busy = false;
+        mode = DmaMode::Basic;
+        conf.done(info.src, info.dst, info.num_bytes, conf.instance);
+    }
+}
+
+Err DmaChannel::start_scatter_gather(std::span<DmaChannelControl> tasks, const uint8_t* src,
+    uint8_t* dst, size_t num_bytes, DmaMode mode) noexcept
+{
+    constexpr uint32_t WORDS_PER_TASK = sizeof(DmaChannelControl) / sizeof(uint32_t);
+    constexpr uint32_t WIDTH_32BIT = static_cast<uint32_t>(DmaDataWidth::Width32Bit);
+    constexpr uint32_t INCR_32BIT = static_cast<uint32_t>(DmaPtrIncrement::Incr32Bit);
+
+    DmaMode task_mode;
+    DmaMode last_mode;
+
+    if (!in_use)
+        return Err::NotInitialized;
+
+    if (mode == DmaMode::MemoryScatterGather) {
+        task_mode = DmaMode::AlternateMemoryScatterGather;
+        last_mode = DmaMode::AutoRequest;
+    } else if (mode == DmaMode::PeripheralScatterGather) {
+        task_mode = DmaMode::AlternatePeripheralScatterGather;
+        last_mode = DmaMode::Basic;
+    } else {
+        return Err::NotSupported;
+    }
+
+    if (info.busy)
+        return Err::Busy;
+
+    info.busy = true;
+    info.src = src;
+    info.dst = dst;
+    info.num_bytes = num_bytes;
+    info.remaining_words = 0;
+    info.type = DmaTransferType::Custom;
+    this->mode = mode;
+
+    // every task switches back to the primary structure which loads the next task, except the last
+    // one which ends the chain and triggers the interrupt
+    for (size_t i = 0; i < tasks.size(); i++) {
+        DmaMode m = (i == (tasks.size() - 1)) ? last_mode : task_mode;
+        tasks[i].ctrl.modify(dmactrl::ctrl::cycle_ctrl.value(static_cast<uint32_t>(m)));
+    }
+
+    // The primary structure copies one task (4 words) per arbitration cycle into the alternate
+    // structure. Both pointers are end-pointers, thus they point to the last word of the last task
+    // and to the last word of the alternate structure.
+    uint32_t words = static_cast<uint32_t>(tasks.size()) * WORDS_PER_TASK;
+    ctrl_prim.src_ptr.set(dma_addr(&tasks[tasks.size() - 1]._unused));
+    ctrl_prim.dst_ptr.set(dma_addr(&ctrl_alt._unused));
+    ctrl_prim.ctrl.set(
+        dmactrl::ctrl::src_size.raw_value(WIDTH_32BIT) |
+        dmactrl::ctrl::dst_size.raw_value(WIDTH_32BIT) |
+        dmactrl::ctrl::src_inc.raw_value(INCR_32BIT) |
+        dmactrl::ctrl::dst_inc.raw_value(INCR_32BIT) |
+        dmactrl::ctrl::n_minus_1.raw_value(words - 1) |
+        dmactrl::ctrl::r_power.raw_value(2) |   // 2^2 = 4 words per arbitration
+        dmactrl::ctrl::cycle_ctrl.raw_value(static_cast<uint32_t>(mode))
+    );
+
+    reg().altclr.set(hlp::bit<uint32_t>(idx));
+    enable_channel();
+
+    // memory scatter-gather transfers are not triggered by a peripheral
+    if (mode == DmaMode::MemoryScatterGather)
+        reg().sw_chtrig.set(hlp::bit<uint32_t>(idx));
+
+    return Err::Ok;
+}
+
+void DmaChannel::cancel() noexcept
+{
+    reg().enaclr.set(hlp::bit<uint32_t>(idx));
+    reg().int0_clrflg.set(hlp::bit<uint32_t>(idx));
+
+    info.busy = false;
+    info.remaining_words = 0;
+}
+
 void DmaChannel::calc_remaining_words(size_t num_bytes) noexcept
 {
     size_t transfers = num_bytes >> static_cast<size_t>(conf.width);
@@ -199,6 +433,11 @@ void DmaChannel::calc_remaining_words(size_t num_bytes) noexcept
 
 void DmaChannel::update_dma_pointers() noexcept
 {
+    uint32_t ctrl = ctrl_prim.ctrl.get();
+    uint32_t src_inc = (ctrl & dmactrl::ctrl::src_inc.mask())
+        >> std::countr_zero(dmactrl::ctrl::src_inc.mask());
+    uint32_t dst_inc = (ctrl & dmactrl::ctrl::dst_inc.mask())
+        >> std::countr_zero(dmactrl::ctrl::dst_inc.mask());
     uint32_t words_to_transmit;
     uint32_t r_power;
 
@@ -210,17 +449,14 @@ void DmaChannel::update_dma_pointers() noexcept
         info.remaining_words = 0;
     }
 
-    if ((info.type == DmaTransferType::PeripheralToMemory) ||
-       (info.type == DmaTransferType::MemoryToMemory)) {
-        ctrl_prim.dst_ptr.set(
-            ctrl_prim.dst_ptr.get() + (MAX_TRANSFERS_LEN << static_cast<uint32_t>(conf.width)));
-    }
+    // The pointers are end-pointers, thus they are advanced by the size of the next block and not
+    // by the size of the previous one. A pointer which isn't incremented (e.g. the data register of
+    // a peripheral or the dummy byte of a custom transfer) stays where it is.
+    if (src_inc != static_cast<uint32_t>(DmaPtrIncrement::NoIncr))
+        ctrl_prim.src_ptr.set(ctrl_prim.src_ptr.get() + (words_to_transmit << src_inc));
 
-    if ((info.type == DmaTransferType::MemoryToPeripheral) ||
-       (info.type == DmaTransferType::MemoryToMemory)) {
-        ctrl_prim.src_ptr.set(
-            ctrl_prim.src_ptr.get() + (MAX_TRANSFERS_LEN << static_cast<uint32_t>(conf.width)));
-    }
+    if (dst_inc != static_cast<uint32_t>(DmaPtrIncrement::NoIncr))
+        ctrl_prim.dst_ptr.set(ctrl_prim.dst_ptr.get() + (words_to_transmit << dst_inc));
 
     if (info.type == DmaTransferType::MemoryToMemory)
         r_power = 31 - std::countl_zero(words_to_transmit);
@@ -245,11 +481,23 @@ void DmaChannel::config_prim_channel(uint32_t bytes_to_transmit) noexcept
         dmactrl::ctrl::r_power.value(0) +
         dmactrl::ctrl::cycle_ctrl.value(static_cast<uint32_t>(mode))
     );
+
+    // a ping-pong or scatter-gather transfer may have left the alternate structure selected
+    reg().altclr.set(hlp::bit<uint32_t>(idx));
 }
 
 void DmaChannel::handle_interrupt() noexcept
 {
-    if (info.remaining_words > 0) {
+    ScopedProbe probe{dwt, profile};
+
+    if (mode == DmaMode::PingPong) {
+        handle_ping_pong();
+    } else if ((mode == DmaMode::MemoryScatterGather) || (mode == DmaMode::PeripheralScatterGather)) {
+        // the interrupt is only triggered after the last task of the list
+        info.busy = false;
+        mode = DmaMode::Basic;
+        conf.done(info.src, info.dst, info.num_bytes, conf.instance);
+    } else if (info.remaining_words > 0) {
         update_dma_pointers();
     } else {
         info.busy = false;
@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ */
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include "gpio.h"
+#include "gpio_regs.h"
+#include "int_pin.h"
+
+void GpioPins::handle_interrupt(size_t port) noexcept
+{
+    IntPin& first = int_pins[port * Pin::PINS_PER_PORT];
+    GpioRegisters& regs = first.reg();
+    uint8_t idx = first.reg_idx;
+    uint8_t ies = regs.ies[idx].get();
+    uint8_t pending = regs.ifg[idx].get() & regs.ie[idx].get();
+
+    // only the pins with a set flag are visited, lowest pin number first
+    while (pending != 0) {
+        size_t nr = static_cast<size_t>(std::countr_zero(pending));
+        IntPin& p = int_pins[port * Pin::PINS_PER_PORT + nr];
+        IntEdge edge = ((ies & (1U << p.pin_nr)) > 0) ? IntEdge::Falling : IntEdge::Rising;
+
+        pending &= static_cast<uint8_t>(pending - 1);
+
+        // the flag is cleared before invoking the callback, thus an edge within the callback
+        // triggers the interrupt again
+        p.bit(regs.ifg[idx]).set(0);
+        if (p.cb)
+            p.cb(edge, p.cookie);
+    }
+}
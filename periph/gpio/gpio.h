@@ -17,6 +17,7 @@ class GpioPins {
 public:
     static constexpr size_t INT_PIN_CNT = 48;
     static constexpr size_t PIN_CNT = 40;
+    static constexpr size_t INT_PORT_CNT = 6;
 
     GpioPins(const GpioPins&) = delete;
     GpioPins(const GpioPins&&) = delete;
@@ -34,6 +35,10 @@ public:
         return int_pins[static_cast<size_t>(nr)];
     }
 
+    // invoked by the interrupt of the ports 1 to 6 (port = 0 to 5), dispatches to the callbacks of
+    // the pins with a pending flag
+    void handle_interrupt(size_t port) noexcept;
+
     friend void init_platform(void); // from startup.cpp
     friend class Msp432;
 private:
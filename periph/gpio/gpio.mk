@@ -9,4 +9,5 @@ GPIO_DIR = $(ROOT)/periph/gpio
 
 INCLUDES += $(GPIO_DIR)
 SRCS += $(GPIO_DIR)/pin.cpp \
-		$(GPIO_DIR)/int_pin.cpp
+		$(GPIO_DIR)/int_pin.cpp \
+		$(GPIO_DIR)/gpio.cpp
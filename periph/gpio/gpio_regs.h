@@ -30,12 +30,15 @@ public:
     Reserved<uint8_t> _reserved[6];
     ReadWrite<uint8_t> selc[2];
     ReadWrite<uint8_t> ies[2];
+    ReadWrite<uint8_t> ie[2];
     ReadWrite<uint8_t> ifg[2];
     ReadWrite<uint8_t> iv2[2];
 };
 #pragma pack()
 
 static_assert(std::is_standard_layout<GpioRegisters>::value, "GpioRegisters isn't standard layout");
+static_assert(offsetof(GpioRegisters, ifg) == 0x1C, "GpioRegisters has an invalid layout");
+static_assert(sizeof(GpioRegisters) == 0x20, "GpioRegisters has an invalid size");
 
 constexpr size_t GPIO_BASES[6] = {
     0x40004C00,
@@ -5,5 +5,56 @@
  * E-Mail: hotschi@gmx.at
  */
 
+#include "cm4f.h"
+#include "err.h"
 #include "int_pin.h"
 #include "gpio_regs.h"
+
+Err IntPin::enable_interrupt(IntEdge edge, void* cookie,
+    void (*cb)(IntEdge edge, void* cookie) noexcept) noexcept
+{
+    if (!cb)
+        return Err::NullPtr;
+
+    // the port interrupt must not see a half-updated callback
+    bit(reg().ie[reg_idx]).set(0);
+    this->cb = cb;
+    this->cookie = cookie;
+
+    // changing the edge may set the interrupt flag, so the flag is cleared afterwards
+    bit(reg().ies[reg_idx]).set(static_cast<uint32_t>(edge == IntEdge::Falling));
+    bit(reg().ifg[reg_idx]).set(0);
+    bit(reg().ie[reg_idx]).set(1);
+
+    return Err::Ok;
+}
+
+void IntPin::disable_interrupt() noexcept
+{
+    bit(reg().ie[reg_idx]).set(0);
+    bit(reg().ifg[reg_idx]).set(0);
+
+    // the port interrupt skips the pin if it is disabled by a callback of another pin
+    cb = nullptr;
+    cookie = nullptr;
+}
+
+bool IntPin::interrupt_enabled() const noexcept
+{
+    return bit(reg().ie[reg_idx]).get() > 0;
+}
+
+void IntPin::set_edge(IntEdge edge) const noexcept
+{
+    uint32_t primask = cm4f::disable_irq();
+
+    bit(reg().ies[reg_idx]).set(static_cast<uint32_t>(edge == IntEdge::Falling));
+    bit(reg().ifg[reg_idx]).set(0);
+
+    cm4f::restore_irq(primask);
+}
+
+IntEdge IntPin::get_edge() const noexcept
+{
+    return (bit(reg().ies[reg_idx]).get() > 0) ? IntEdge::Falling : IntEdge::Rising;
+}
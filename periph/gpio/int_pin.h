@@ -7,7 +7,13 @@
 
 #pragma once
 
+#include <cstdint>
+
+#include "cm4f.h"
+#include "err.h"
+#include "gpio_regs.h"
 #include "pin.h"
+#include "register.h"
 
 enum class IntPinNr : uint8_t {
     P01_0, P01_1, P01_2, P01_3, P01_4, P01_5, P01_6, P01_7,
@@ -18,14 +24,44 @@ enum class IntPinNr : uint8_t {
     P06_0, P06_1, P06_2, P06_3, P06_4, P06_5, P06_6, P06_7,
 };
 
+enum class IntEdge : uint8_t {
+    Rising,
+    Falling,
+};
+
 class IntPin: public Pin {
 public:
     constexpr ~IntPin() {};
 
+    // Enables the interrupt on the given edge, 'cb' is invoked from the port interrupt with the
+    // edge which triggered it. The pin has to be configured as input before.
+    Err enable_interrupt(IntEdge edge, void* cookie,
+        void (*cb)(IntEdge edge, void* cookie) noexcept) noexcept;
+    void disable_interrupt() noexcept;
+    bool interrupt_enabled() const noexcept;
+
+    // Changes the edge of an enabled interrupt, this may also be called from the callback. Only one
+    // edge can be detected at a time, both edges are detected by switching the edge within the
+    // callback and checking the level of the pin afterwards.
+    void set_edge(IntEdge edge) const noexcept;
+    IntEdge get_edge() const noexcept;
+
     friend class GpioPins;
 private:
-    constexpr explicit IntPin(IntPinNr nr) noexcept 
+    constexpr explicit IntPin(IntPinNr nr) noexcept
         : Pin(static_cast<uint8_t>(nr) % PINS_PER_PORT,
         (static_cast<uint8_t>(nr) / PINS_PER_PORT) % 2,
-        (static_cast<uint8_t>(nr) / PINS_PER_PORT) / 2) {}
+        (static_cast<uint8_t>(nr) / PINS_PER_PORT) / 2), cb(nullptr), cookie(nullptr) {}
+
+    // The bit of this pin within the given register, accessed through its bit-band alias. Thus,
+    // the bits of the other pins of the port are never written, even if the port interrupt or the
+    // hardware modifies them concurrently.
+    inline ReadWrite<uint32_t>& bit(ReadWrite<uint8_t>& r) const noexcept
+    {
+        return *reinterpret_cast<ReadWrite<uint32_t>*>(
+            cm4f::bitband(reinterpret_cast<uintptr_t>(&r), pin_nr));
+    }
+
+    void (*cb)(IntEdge edge, void* cookie) noexcept;
+    void* cookie;
 };
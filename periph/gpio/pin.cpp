@@ -61,6 +61,11 @@ bool Pin::read() const noexcept
     return (reg().in[reg_idx].get() & static_cast<uint8_t>(1U << pin_nr)) > 0;
 }
 
+uint8_t Pin::read_port() const noexcept
+{
+    return reg().in[reg_idx].get();
+}
+
 void Pin::set_pull_mode(PullMode mode) const noexcept
 {
     if (is_output())
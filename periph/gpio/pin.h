@@ -39,6 +39,15 @@ public:
     void toggle() const noexcept;
 
     bool read() const noexcept;
+
+    // reads the levels of all the pins of the port at once, the level of this pin is at mask()
+    uint8_t read_port() const noexcept;
+    constexpr uint8_t mask() const noexcept { return static_cast<uint8_t>(1U << pin_nr); }
+    constexpr bool same_port(const Pin& other) const noexcept
+    {
+        return (reg_base == other.reg_base) && (reg_idx == other.reg_idx);
+    }
+
     void set_pull_mode(PullMode mode) const noexcept;
     PullMode get_pull_mode() const noexcept;
 
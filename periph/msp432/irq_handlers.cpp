@@ -7,10 +7,9 @@
 
 #include "cm4f.h"
 #include "gpio.h"
+#include "irq_nr.h"
 #include "msp432.h"
 
-extern void unhandled_interrupt(void);
-
 void systick_handler(void) noexcept
 {
     Msp432::instance().cortexm4f().systick().handle_interrupt();
@@ -33,46 +32,33 @@ void hard_fault(void) noexcept
 
 void fpu_handler(void) noexcept
 {
-    constexpr size_t FLOAT_IRQ_NR = 4; // see startup.cpp
-    Msp432::instance().cortexm4f().nvic().clear_pending(FLOAT_IRQ_NR);
+    Msp432::instance().cortexm4f().nvic().clear_pending(irq_idx(IrqNr::Fpu));
     Msp432::instance().cortexm4f().fpu().handle_interrupt();
 }
 
-void periph_int_handler(void) noexcept
-{
-    Msp432& msp = Msp432::instance();
-    Nvic& nvic = msp.cortexm4f().nvic();
-    uint64_t ints = nvic.get_pending_interrupts();
-    nvic.clear_all_pending();
+// The peripheral interrupts are dispatched directly via the vector table (see startup.cpp). The NVIC
+// clears the pending bit of an interrupt by itself when entering the handler.
+void uscia0_handler(void) noexcept { Msp432::instance().uscia0().handle_interrupt(); }
+void uscia1_handler(void) noexcept { Msp432::instance().uscia1().handle_interrupt(); }
+void uscia2_handler(void) noexcept { Msp432::instance().uscia2().handle_interrupt(); }
+void uscia3_handler(void) noexcept { Msp432::instance().uscia3().handle_interrupt(); }
+void uscib0_handler(void) noexcept { Msp432::instance().uscib0().handle_interrupt(); }
+void uscib1_handler(void) noexcept { Msp432::instance().uscib1().handle_interrupt(); }
+void uscib2_handler(void) noexcept { Msp432::instance().uscib2().handle_interrupt(); }
+void uscib3_handler(void) noexcept { Msp432::instance().uscib3().handle_interrupt(); }
 
-    // TODO: introduce a constant for the number of interrupts
-    for (int i = 0; i < 64; i++) {
-        uint64_t bit = 1ULL << i;
-        if (!(bit & ints))
-            continue;
+void t32_int1_handler(void) noexcept { Msp432::instance().t32_1().handle_interrupt(); }
+void t32_int2_handler(void) noexcept { Msp432::instance().t32_2().handle_interrupt(); }
 
-        // interrupt occurred -> forward it to the appropriate handler
-        switch (i) {
-        case 16: msp.uscia0().handle_interrupt(); break;
-        case 17: msp.uscia1().handle_interrupt(); break;
-        case 18: msp.uscia2().handle_interrupt(); break;
-        case 19: msp.uscia3().handle_interrupt(); break;
-        case 20: msp.uscib0().handle_interrupt(); break;
-        case 21: msp.uscib1().handle_interrupt(); break;
-        case 22: msp.uscib2().handle_interrupt(); break;
-        case 23: msp.uscib3().handle_interrupt(); break;
-        case 25: msp.t32_1().handle_interrupt(); break;
-        case 26: msp.t32_2().handle_interrupt(); break;
-        case 30: msp.dma().handle_interrupt(-1); break; // error interrupt
-        case 31: msp.dma().handle_interrupt(0); break;
-        case 32: msp.dma().handle_interrupt(1); break;
-        case 33: msp.dma().handle_interrupt(2); break;
-        case 34: msp.dma().handle_interrupt(3); break;
+void dma_err_handler(void) noexcept { Msp432::instance().dma().handle_interrupt(-1); }
+void dma_int0_handler(void) noexcept { Msp432::instance().dma().handle_interrupt(0); }
+void dma_int1_handler(void) noexcept { Msp432::instance().dma().handle_interrupt(1); }
+void dma_int2_handler(void) noexcept { Msp432::instance().dma().handle_interrupt(2); }
+void dma_int3_handler(void) noexcept { Msp432::instance().dma().handle_interrupt(3); }
 
-        default:
-            // TODO: implement better way for handling this case
-            unhandled_interrupt();
-            break;
-        }
-    }
-}
\ No newline at end of file
+void port1_handler(void) noexcept { Msp432::instance().gpio_pins().handle_interrupt(0); }
+void port2_handler(void) noexcept { Msp432::instance().gpio_pins().handle_interrupt(1); }
+void port3_handler(void) noexcept { Msp432::instance().gpio_pins().handle_interrupt(2); }
+void port4_handler(void) noexcept { Msp432::instance().gpio_pins().handle_interrupt(3); }
+void port5_handler(void) noexcept { Msp432::instance().gpio_pins().handle_interrupt(4); }
+void port6_handler(void) noexcept { Msp432::instance().gpio_pins().handle_interrupt(5); }
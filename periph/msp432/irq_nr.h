@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ *
+ * Interrupt numbers of the MSP432P401R peripheral interrupts. The values equal the position of the
+ * corresponding handler within the peripheral vector table (see startup.cpp) and are taken from
+ * the SVD-file (msp432p4xx.svd). The test test/test_irq_table.cpp checks them against the SVD-file.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum class IrqNr : uint8_t {
+    Pss = 0,
+    Cs = 1,
+    Pcm = 2,
+    WdtA = 3,
+    Fpu = 4,
+    FlCtl = 5,
+    CompE0 = 6,
+    CompE1 = 7,
+    Ta0_0 = 8,
+    Ta0_N = 9,
+    Ta1_0 = 10,
+    Ta1_N = 11,
+    Ta2_0 = 12,
+    Ta2_N = 13,
+    Ta3_0 = 14,
+    Ta3_N = 15,
+    EusciA0 = 16,
+    EusciA1 = 17,
+    EusciA2 = 18,
+    EusciA3 = 19,
+    EusciB0 = 20,
+    EusciB1 = 21,
+    EusciB2 = 22,
+    EusciB3 = 23,
+    Adc14 = 24,
+    T32Int1 = 25,
+    T32Int2 = 26,
+    T32IntC = 27,
+    Aes256 = 28,
+    RtcC = 29,
+    DmaErr = 30,
+    DmaInt3 = 31,
+    DmaInt2 = 32,
+    DmaInt1 = 33,
+    DmaInt0 = 34,
+    Port1 = 35,
+    Port2 = 36,
+    Port3 = 37,
+    Port4 = 38,
+    Port5 = 39,
+    Port6 = 40,
+};
+
+// number of entries in the peripheral vector table, the entries from 41 to 63 are reserved
+constexpr size_t IRQ_CNT = 64;
+
+constexpr size_t irq_idx(IrqNr nr) noexcept
+{
+    return static_cast<size_t>(nr);
+}
@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ *
+ * Layout of the peripheral vector table, it is shared by the startup code (startup.cpp) and the NVIC
+ * model of the host simulation (sim/nvic_model.cpp).
+ */
+
+#pragma once
+
+#include <array>
+
+#include "irq_nr.h"
+
+// the individual interrupt handlers defined in the peripheral drivers
+extern void systick_handler(void);
+extern void fpu_handler(void);
+extern void uscia0_handler(void);
+extern void uscia1_handler(void);
+extern void uscia2_handler(void);
+extern void uscia3_handler(void);
+extern void uscib0_handler(void);
+extern void uscib1_handler(void);
+extern void uscib2_handler(void);
+extern void uscib3_handler(void);
+extern void t32_int1_handler(void);
+extern void t32_int2_handler(void);
+extern void dma_err_handler(void);
+extern void dma_int0_handler(void);
+extern void dma_int1_handler(void);
+extern void dma_int2_handler(void);
+extern void dma_int3_handler(void);
+extern void port1_handler(void);
+extern void port2_handler(void);
+extern void port3_handler(void);
+extern void port4_handler(void);
+extern void port5_handler(void);
+extern void port6_handler(void);
+
+// every interrupt is dispatched directly to the handler of its owning peripheral, all other entries
+// end up in 'unhandled'
+constexpr std::array<void(*)(void), IRQ_CNT> make_irq_vector(void (*unhandled)(void))
+{
+    std::array<void(*)(void), IRQ_CNT> vec{};
+
+    vec.fill(unhandled);
+
+    vec[irq_idx(IrqNr::Fpu)] = fpu_handler;
+    vec[irq_idx(IrqNr::EusciA0)] = uscia0_handler;
+    vec[irq_idx(IrqNr::EusciA1)] = uscia1_handler;
+    vec[irq_idx(IrqNr::EusciA2)] = uscia2_handler;
+    vec[irq_idx(IrqNr::EusciA3)] = uscia3_handler;
+    vec[irq_idx(IrqNr::EusciB0)] = uscib0_handler;
+    vec[irq_idx(IrqNr::EusciB1)] = uscib1_handler;
+    vec[irq_idx(IrqNr::EusciB2)] = uscib2_handler;
+    vec[irq_idx(IrqNr::EusciB3)] = uscib3_handler;
+    vec[irq_idx(IrqNr::T32Int1)] = t32_int1_handler;
+    vec[irq_idx(IrqNr::T32Int2)] = t32_int2_handler;
+    vec[irq_idx(IrqNr::DmaErr)] = dma_err_handler;
+    vec[irq_idx(IrqNr::DmaInt3)] = dma_int3_handler;
+    vec[irq_idx(IrqNr::DmaInt2)] = dma_int2_handler;
+    vec[irq_idx(IrqNr::DmaInt1)] = dma_int1_handler;
+    vec[irq_idx(IrqNr::DmaInt0)] = dma_int0_handler;
+    vec[irq_idx(IrqNr::Port1)] = port1_handler;
+    vec[irq_idx(IrqNr::Port2)] = port2_handler;
+    vec[irq_idx(IrqNr::Port3)] = port3_handler;
+    vec[irq_idx(IrqNr::Port4)] = port4_handler;
+    vec[irq_idx(IrqNr::Port5)] = port5_handler;
+    vec[irq_idx(IrqNr::Port6)] = port6_handler;
+
+    return vec;
+}
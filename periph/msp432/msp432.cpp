@@ -5,6 +5,7 @@
  * E-Mail: hotschi@gmx.at
  */
 
+#include "cm4f.h"
 #include "err.h"
 #include "helpers.h"
 #include "register.h"
@@ -26,6 +27,7 @@ void Msp432::init() noexcept
     m_cortexm4f.systick().start(m_cs.m_clk());
     m_cortexm4f.fpu().enable();
     m_cortexm4f.fpu().set_rounding_mode(Fpu::RoundingMode::Nearest);
+    m_cortexm4f.dwt().enable_cycle_counter();
 
     m_dma.init();
 
@@ -54,18 +56,16 @@ void Msp432::enable_interrupts() noexcept
     m_cortexm4f.nvic().disable_all_interrupts();
     m_cortexm4f.nvic().clear_all_pending();
     m_cortexm4f.nvic().enable_all_interrupts();
-    __asm__("CPSIE I"); // enable global interrupts
+    cm4f::enable_irq(); // enable global interrupts
 }
 
 void Msp432::disable_interrupts() noexcept
 {
     m_cortexm4f.nvic().disable_all_interrupts();
-    __asm__("CPSID I"); // disable global interrupts
+    cm4f::disable_irq(); // disable global interrupts
 }
 
 void Msp432::delay_ms(uint32_t delay) noexcept
 {
-    uint64_t until = m_cortexm4f.systick().uptime_ms() + static_cast<uint64_t>(delay);
-    while (until > m_cortexm4f.systick().uptime_ms())
-        __asm__("nop");
+    m_cortexm4f.systick().sleep_ms(delay);
 }
\ No newline at end of file
@@ -55,6 +55,17 @@ Err Timer32::set_frequency(uint32_t freq_hz, const Cs& cs) noexcept
     return Err::Ok;
 }
 
+Err Timer32::set_period(uint32_t cycles) noexcept
+{
+    if (cycles == 0)
+        return Err::OutOfRange;
+
+    // writing the load register reloads the counter immediately
+    reg().load.set(cycles);
+    reg().intclr.set(1);
+    return Err::Ok;
+}
+
 Err Timer32::start() noexcept
 {
     if ((!is_initialized()) || (freq == 0) || (cb == nullptr))
@@ -21,12 +21,24 @@ public:
     void stop() noexcept;
     Err set_frequency(uint32_t freq_hz, const Cs& cs) noexcept;
 
+    // Sets the number of clock cycles until the next interrupt, the counter is reloaded immediately
+    // (also while the timer is running) and uses this period afterwards. An interrupt of the
+    // previous period which is still pending is discarded.
+    Err set_period(uint32_t cycles) noexcept;
+
     inline uint32_t get_frequency() const noexcept { return freq; }
+    inline uint32_t get_period() noexcept { return reg().load.get(); }
+    inline uint32_t get_counter() noexcept { return reg().value.get(); }
+    inline bool is_pending() noexcept
+    {
+        return (reg().ris.get() & timer32regs::ris::raw_ifg.mask()) > 0;
+    }
     inline bool is_running() noexcept { return (status & STATUS_RUNNING) > 0; }
     inline bool is_initialized() noexcept { return (status & STATUS_INITIALIZED) > 0; }
 
     friend class Msp432;
-    friend void periph_int_handler(void) noexcept;
+    friend void t32_int1_handler(void) noexcept;
+    friend void t32_int2_handler(void) noexcept;
 private:
     static constexpr uint8_t STATUS_INITIALIZED = hlp::bit<uint8_t>(0);
     static constexpr uint8_t STATUS_RUNNING = hlp::bit<uint8_t>(1);
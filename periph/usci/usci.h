@@ -64,16 +64,19 @@ public:
         return *reinterpret_cast<UsciARegisters*>(reg_base);
     }
 
-    constexpr ReadWrite<uint16_t>& ctlw0() noexcept override { return reg().ctlw0; }
-    constexpr ReadWrite<uint16_t>& brw() noexcept override { return reg().brw; }
-    constexpr ReadWrite<uint16_t>& statw() noexcept override { return reg().statw; }
-    constexpr ReadOnly<uint16_t>& rxbuf() noexcept override { return reg().rxbuf; }
-    constexpr ReadWrite<uint16_t>& txbuf() noexcept override { return reg().txbuf; }
-    constexpr ReadWrite<uint16_t>& ie() noexcept override { return reg().ie; }
-    constexpr ReadWrite<uint16_t>& ifg() noexcept override { return reg().ifg; }
+    ReadWrite<uint16_t>& ctlw0() noexcept override { return reg().ctlw0; }
+    ReadWrite<uint16_t>& brw() noexcept override { return reg().brw; }
+    ReadWrite<uint16_t>& statw() noexcept override { return reg().statw; }
+    ReadOnly<uint16_t>& rxbuf() noexcept override { return reg().rxbuf; }
+    ReadWrite<uint16_t>& txbuf() noexcept override { return reg().txbuf; }
+    ReadWrite<uint16_t>& ie() noexcept override { return reg().ie; }
+    ReadWrite<uint16_t>& ifg() noexcept override { return reg().ifg; }
 
     friend class Msp432;
-    friend void periph_int_handler(void) noexcept;
+    friend void uscia0_handler(void) noexcept;
+    friend void uscia1_handler(void) noexcept;
+    friend void uscia2_handler(void) noexcept;
+    friend void uscia3_handler(void) noexcept;
 
 private:
     constexpr explicit UsciA(const size_t base) : Usci(base) {}
@@ -86,16 +89,19 @@ public:
         return *reinterpret_cast<UsciBRegisters*>(reg_base);
     }
 
-    constexpr ReadWrite<uint16_t>& ctlw0() noexcept override { return reg().ctlw0; }
-    constexpr ReadWrite<uint16_t>& brw() noexcept override { return reg().brw; }
-    constexpr ReadWrite<uint16_t>& statw() noexcept override { return reg().statw; }
-    constexpr ReadOnly<uint16_t>& rxbuf() noexcept override { return reg().rxbuf; }
-    constexpr ReadWrite<uint16_t>& txbuf() noexcept override { return reg().txbuf; }
-    constexpr ReadWrite<uint16_t>& ie() noexcept override { return reg().ie; }
-    constexpr ReadWrite<uint16_t>& ifg() noexcept override { return reg().ifg; }
+    ReadWrite<uint16_t>& ctlw0() noexcept override { return reg().ctlw0; }
+    ReadWrite<uint16_t>& brw() noexcept override { return reg().brw; }
+    ReadWrite<uint16_t>& statw() noexcept override { return reg().statw; }
+    ReadOnly<uint16_t>& rxbuf() noexcept override { return reg().rxbuf; }
+    ReadWrite<uint16_t>& txbuf() noexcept override { return reg().txbuf; }
+    ReadWrite<uint16_t>& ie() noexcept override { return reg().ie; }
+    ReadWrite<uint16_t>& ifg() noexcept override { return reg().ifg; }
 
     friend class Msp432;
-    friend void periph_int_handler(void) noexcept;
+    friend void uscib0_handler(void) noexcept;
+    friend void uscib1_handler(void) noexcept;
+    friend void uscib2_handler(void) noexcept;
+    friend void uscib3_handler(void) noexcept;
 
 private:
     constexpr explicit UsciB(const size_t base) : Usci(base) {}
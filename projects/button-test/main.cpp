@@ -20,7 +20,7 @@
 #include "wdt.h"
 
 Msp432& chip = Msp432::instance();
-EventTimer ev_timer{chip.t32_1()};
+StaticEventTimer<> ev_timer{chip.t32_1()};
 
 Led led_red = Led{chip.gpio_pins().int_pin(IntPinNr::P02_0), false};
 Led led_green = Led{chip.gpio_pins().int_pin(IntPinNr::P02_1), false};
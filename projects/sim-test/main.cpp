@@ -0,0 +1,1318 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ *
+ * Runs the UART, SPI, I2C, I2cDevice, EventTimer, GPIO interrupt, Button, ButtonGroup and W2812B
+ * drivers within the host simulation and reports the throughput and the interrupt latencies. Build
+ * and run it with 'make run'.
+ */
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+
+#include "button.h"
+#include "button_group.h"
+#include "bitmap.h"
+#include "cm4f.h"
+#include "dwt.h"
+#include "event_timer.h"
+#include "gpio_model.h"
+#include "i2c.h"
+#include "i2c_device.h"
+#include "msp432.h"
+#include "nvic_model.h"
+#include "profile.h"
+#include "sim.h"
+#include "spi_master.h"
+#include "timer32_model.h"
+#include "uart.h"
+#include "usci_model.h"
+#include "w2812b.h"
+#include "w2812b_matrix.h"
+
+constexpr uint16_t TARGET_ADDR = 0x48;
+constexpr uint16_t DEVICE_ADDR = 0x50;
+constexpr uint16_t MISSING_ADDR = 0x4B;
+constexpr size_t UART_BYTES = 2048;
+constexpr size_t SPI_BYTES = 256;
+constexpr uint32_t EVENT_INTERVAL_MS = 10;
+constexpr uint32_t EVENT_CNT = 20;
+constexpr size_t MANY_EVENTS = 300;
+constexpr size_t STRIP_LEDS = 64;
+constexpr size_t PANEL_LEDS = 300;
+constexpr uint16_t MATRIX_SIZE = 8;
+
+Msp432& chip = Msp432::instance();
+Uart uart0{chip.uscia0(), chip.dma(), 115200, 0, 1, 1, 1};
+SpiMaster spi1{chip.uscib1(), chip.dma(), SpiMode::Cpol0Cphase0, 1'000'000, 2, 3, 2, 2};
+SpiMaster spi2{chip.uscib2(), chip.dma(), SpiMode::Cpol0Cphase0, 6'000'000, 4, 5, 2, 2};
+I2cMaster i2c0{chip.uscib0(), I2cSpeed::KHz400};
+I2cMaster i2c3{chip.uscib3(), chip.dma(), I2cSpeed::KHz400, 6, 7, 2, 2};
+StaticEventTimer<> ev_timer{chip.t32_1()};
+StaticEventTimer<MANY_EVENTS> many_timer{chip.t32_2()};
+IntPin& s1 = chip.gpio_pins().int_pin(IntPinNr::P01_1);
+IntPin& s2 = chip.gpio_pins().int_pin(IntPinNr::P01_4);
+Button btn{chip.gpio_pins().int_pin(IntPinNr::P01_5), ev_timer, true};
+std::array<Pin*, 3> keys = {
+    &chip.gpio_pins().int_pin(IntPinNr::P03_0),
+    &chip.gpio_pins().int_pin(IntPinNr::P03_2),
+    &chip.gpio_pins().int_pin(IntPinNr::P03_5),
+};
+ButtonGroup keypad{std::span{keys}, ev_timer, true};
+W2812B<STRIP_LEDS> strip{spi2};
+W2812B<PANEL_LEDS, W2812BMode::Streaming> panel{spi2};
+W2812B<4> gamma_strip{spi2, true};
+W2812B<4, W2812BMode::Encoded, true> dim_strip{spi2};
+W2812BMatrix<MATRIX_SIZE, MATRIX_SIZE, W2812BMode::Streaming> matrix{spi2};
+
+// the DMA only handles 32-bit addresses, thus all buffers are static
+static std::array<uint8_t, 256> uart_tx = {};
+static std::array<uint8_t, SPI_BYTES> spi_tx = {};
+static std::array<uint8_t, SPI_BYTES> spi_rx = {};
+static std::array<uint8_t, 5> i2c_tx = {0x10, 0xDE, 0xAD, 0xBE, 0xEF};
+static std::array<uint8_t, 1> i2c_reg = {0x13};
+static std::array<uint8_t, 4> i2c_rx = {};
+static std::array<uint8_t, 64> i2c_burst = {};
+
+static sim::I2cRegisterTarget target{};
+static sim::I2cRegisterTarget dma_target{};
+static size_t uart_received = 0;
+static bool uart_corrupt = false;
+static bool spi_done = false;
+static bool i2c_done = false;
+static I2cErr i2c_err = I2cErr::Ok;
+static std::array<uint8_t, 8> sched_order = {};
+static std::array<I2cErr, 8> sched_err = {};
+static size_t sched_cnt = 0;
+static uint32_t ev_cnt = 0;
+static sim::Cycles ev_start = 0;
+static sim::Cycles ev_jitter = 0;
+static uint32_t s1_falling = 0;
+static uint32_t s1_rising = 0;
+static uint32_t s2_falling = 0;
+static std::array<uint32_t, 5> btn_events = {};
+static std::array<std::array<uint32_t, 5>, 3> key_events = {};
+static std::array<uint32_t, PANEL_LEDS> leds = {};
+static size_t led_bits = 0;
+static bool led_corrupt = false;
+static int failed = 0;
+
+static void check(bool ok, const char* what) noexcept
+{
+    std::printf("%-40s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok)
+        failed++;
+}
+
+static void uart_rx(size_t avail, void* cookie) noexcept
+{
+    Uart* u = static_cast<Uart*>(cookie);
+
+    while (true) {
+        auto range = u->peek_range();
+        if (!range.has_value())
+            break;
+
+        for (uint8_t b : range.value()) {
+            if (b != uart_tx[uart_received % uart_tx.size()])
+                uart_corrupt = true;
+
+            uart_received++;
+        }
+
+        u->drop_range();
+    }
+}
+
+static uint8_t spi_slave(uint8_t mosi, void* ctx) noexcept
+{
+    return static_cast<uint8_t>(~mosi);
+}
+
+// decodes the bitstream of the LEDs, every bit is sent as one byte and the reset as 0x00
+static uint8_t led_slave(uint8_t mosi, void* ctx) noexcept
+{
+    size_t idx = led_bits / 24;
+
+    if (mosi == 0)
+        return 0;
+
+    if ((mosi != 0b11111000) && (mosi != 0b11100000))
+        led_corrupt = true;
+    else if (idx < leds.size())
+        leds[idx] = ((leds[idx] << 1) | ((mosi == 0b11111000) ? 1 : 0)) & 0xFFFFFF;
+
+    led_bits++;
+    return 0;
+}
+
+static void spi_cb(SpiTransferType type, std::span<uint8_t> txbuf, std::span<uint8_t> rxbuf,
+    void* context)
+{
+    spi_done = true;
+}
+
+static void i2c_cb(I2cJobType type, I2cErr err, std::span<uint8_t> rxbuf, void* cookie)
+{
+    i2c_err = err;
+    i2c_done = true;
+}
+
+static void ev_cb(void* cookie) noexcept
+{
+    sim::Cycles expected = ev_start + (ev_cnt + 1)
+        * sim::to_cycles(EVENT_INTERVAL_MS, 1000);
+    sim::Cycles t = sim::now();
+    sim::Cycles diff = (t > expected) ? (t - expected) : (expected - t);
+
+    ev_jitter = (diff > ev_jitter) ? diff : ev_jitter;
+    ev_cnt++;
+}
+
+static void s1_cb(IntEdge edge, void* cookie) noexcept
+{
+    // both edges are detected by switching the edge
+    if (edge == IntEdge::Falling) {
+        s1_falling++;
+        s1.set_edge(IntEdge::Rising);
+    } else {
+        s1_rising++;
+        s1.set_edge(IntEdge::Falling);
+    }
+}
+
+static void s2_cb(IntEdge edge, void* cookie) noexcept
+{
+    s2_falling++;
+}
+
+static void btn_cb(ButtonEvent ev, void* cookie) noexcept
+{
+    btn_events[static_cast<size_t>(ev)]++;
+}
+
+static void key_cb(size_t idx, ButtonEvent ev, void* cookie) noexcept
+{
+    key_events[idx][static_cast<size_t>(ev)]++;
+}
+
+static void test_uart() noexcept
+{
+    size_t sent = 0;
+
+    for (size_t i = 0; i < uart_tx.size(); i++)
+        uart_tx[i] = static_cast<uint8_t>(i * 7);
+
+    // TX is looped back to RX
+    sim::uscia(0).connect(&sim::uscia(0));
+    uart0.start_receiving(&uart0, uart_rx);
+    sim::reset_stats();
+
+    while (sent < UART_BYTES) {
+        if (uart0.write(std::span{uart_tx}) == Err::Ok)
+            sent += uart_tx.size();
+        else
+            sim::run(sim::to_cycles(1, 1000));
+    }
+
+    // the idle detection reports the data of a partially filled half
+    sim::run_until([]() {
+        uart0.poll_rx_idle();
+        return uart_received >= UART_BYTES;
+    }, sim::to_cycles(1000, 1000));
+
+    std::printf("\n--- UART loopback, %zu bytes @ 115200 baud\n", UART_BYTES);
+    sim::print_stats();
+    check((uart_received == UART_BYTES) && !uart_corrupt, "UART loopback");
+}
+
+static void test_spi() noexcept
+{
+    for (size_t i = 0; i < spi_tx.size(); i++)
+        spi_tx[i] = static_cast<uint8_t>(i);
+
+    sim::uscib(1).set_spi_slave(spi_slave, nullptr);
+    sim::reset_stats();
+
+    spi1.write_read(std::span{spi_tx}, std::span{spi_rx}, nullptr, nullptr, spi_cb);
+    sim::run_until([]() { return spi_done; }, sim::to_cycles(100, 1000));
+
+    bool ok = spi_done;
+    for (size_t i = 0; i < spi_rx.size(); i++)
+        ok = ok && (spi_rx[i] == static_cast<uint8_t>(~spi_tx[i]));
+
+    std::printf("\n--- SPI write_read, %zu bytes @ %lu Hz\n", SPI_BYTES,
+        static_cast<unsigned long>(spi1.get_actual_freq_hz()));
+    sim::print_stats();
+    check(ok, "SPI write_read");
+}
+
+static uint64_t spi_dma_irqs() noexcept
+{
+    return sim::nvic().irq_stats(irq_idx(IrqNr::DmaInt0)).count;
+}
+
+static void test_spi_group() noexcept
+{
+    static const std::array<uint8_t, 4> cmd = {0x0B, 0x01, 0x02, 0x03};
+    static std::array<uint8_t, 16> data = {};
+    const std::array<SpiTransfer, 3> transfers = {
+        SpiTransfer{SpiTransferType::Write, std::span{cmd}, std::span<uint8_t>{}},
+        SpiTransfer{SpiTransferType::WriteRead, std::span{spi_tx}.first(16), std::span{spi_rx}},
+        SpiTransfer{SpiTransferType::Read, std::span<const uint8_t>{}, std::span{data}},
+    };
+    IntPin& cs = chip.gpio_pins().int_pin(IntPinNr::P02_0);
+    uint64_t single_irqs;
+    bool ok;
+
+    cs.make_output();
+    cs.set_low();
+    spi_rx.fill(0);
+    data.fill(0);
+
+    // the same transfers as single jobs toggle CS around each one
+    sim::reset_stats();
+    spi_done = false;
+    spi1.write(std::span{cmd}, &cs, nullptr, nullptr);
+    spi1.write_read(std::span{spi_tx}.first(16), std::span{spi_rx}.first(16), &cs, nullptr,
+        nullptr);
+    spi1.read(std::span{data}, &cs, nullptr, spi_cb);
+    sim::run_until([]() { return spi_done; }, sim::to_cycles(100, 1000));
+    single_irqs = spi_dma_irqs();
+    ok = spi_done && (sim::gpio().detected_edges() == 3);
+
+    // a single DMA-sequence with CS held across all transfers
+    sim::reset_stats();
+    spi_done = false;
+    spi_rx.fill(0);
+    data.fill(0);
+    ok = ok && (spi1.transaction(std::span{transfers}, &cs, nullptr, spi_cb) == Err::Ok);
+    sim::run_until([]() { return spi_done; }, sim::to_cycles(100, 1000));
+    ok = ok && spi_done && (sim::gpio().detected_edges() == 1) && !cs.read()
+        && (spi_dma_irqs() * 3 == single_irqs) && (spi_rx[0] == 0xFF) && (spi_rx[15] == 0xF0)
+        && (spi_rx[16] == 0x00) && (data[0] == 0x00) && (data[15] == 0x00);
+
+    std::printf("\n--- SPI transaction group, %llu DMA interrupts instead of %llu\n",
+        static_cast<unsigned long long>(spi_dma_irqs()),
+        static_cast<unsigned long long>(single_irqs));
+    sim::print_stats();
+    check(ok, "SPI transaction group");
+}
+
+static void test_i2c() noexcept
+{
+    bool ok;
+
+    sim::uscib(0).attach(TARGET_ADDR, target);
+    target.regs[0x14] = 0x12;
+    target.regs[0x15] = 0x34;
+    target.regs[0x16] = 0x56;
+    target.regs[0x17] = 0x78;
+    sim::reset_stats();
+
+    // writes the registers 0x10 to 0x13, the register pointer of the target ends at 0x14
+    i2c0.write(TARGET_ADDR, std::span{i2c_tx}, nullptr, i2c_cb);
+    sim::run_until([]() { return i2c_done; }, sim::to_cycles(100, 1000));
+    ok = i2c_done && (i2c_err == I2cErr::Ok) && (target.regs[0x10] == 0xDE)
+        && (target.regs[0x13] == 0xEF);
+
+    i2c_done = false;
+    i2c0.read(TARGET_ADDR, std::span{i2c_rx}, nullptr, i2c_cb);
+    sim::run_until([]() { return i2c_done; }, sim::to_cycles(100, 1000));
+    ok = ok && i2c_done && (i2c_err == I2cErr::Ok) && (i2c_rx[0] == 0x12) && (i2c_rx[3] == 0x78);
+
+    // selects the register 0x13 and reads it back with a repeated START
+    i2c_done = false;
+    i2c_rx.fill(0);
+    i2c0.write_read(TARGET_ADDR, std::span{i2c_reg}, std::span{i2c_rx}, nullptr, i2c_cb);
+    sim::run_until([]() { return i2c_done; }, sim::to_cycles(100, 1000));
+    ok = ok && i2c_done && (i2c_err == I2cErr::Ok) && (i2c_rx[0] == 0xEF) && (i2c_rx[1] == 0x12);
+
+    std::printf("\n--- I2C write, read and write_read @ 400kHz\n");
+    sim::print_stats();
+    check(ok, "I2C write, read and write_read");
+
+    i2c_done = false;
+    i2c0.write(TARGET_ADDR + 1, std::span{i2c_tx}, nullptr, i2c_cb);
+    sim::run_until([]() { return i2c_done; }, sim::to_cycles(100, 1000));
+    check(i2c_done && (i2c_err == I2cErr::Nack), "I2C NACK of an unknown address");
+}
+
+// interrupts of the DMA-driven I2C master since the last reset of the statistics
+static uint64_t i2c_dma_irqs() noexcept
+{
+    return sim::nvic().irq_stats(irq_idx(IrqNr::EusciB3)).count
+        + sim::nvic().irq_stats(irq_idx(IrqNr::DmaInt0)).count;
+}
+
+static bool i2c_dma_write_read(std::span<uint8_t> rxbuf) noexcept
+{
+    i2c_done = false;
+    i2c3.write_read(TARGET_ADDR, std::span{i2c_reg}, rxbuf, nullptr, i2c_cb);
+    sim::run_until([]() { return i2c_done; }, sim::to_cycles(100, 1000));
+    return i2c_done && (i2c_err == I2cErr::Ok);
+}
+
+static void test_i2c_dma() noexcept
+{
+    uint64_t irqs_short;
+    uint64_t irqs_long;
+    uint32_t primask;
+    bool ok;
+
+    for (size_t i = 0; i < dma_target.regs.size(); i++)
+        dma_target.regs[i] = static_cast<uint8_t>(i);
+
+    sim::uscib(3).attach(TARGET_ADDR, dma_target);
+    sim::reset_stats();
+
+    i2c_done = false;
+    i2c3.write(TARGET_ADDR, std::span{i2c_tx}, nullptr, i2c_cb);
+    sim::run_until([]() { return i2c_done; }, sim::to_cycles(100, 1000));
+    ok = i2c_done && (i2c_err == I2cErr::Ok) && (dma_target.regs[0x10] == 0xDE)
+        && (dma_target.regs[0x13] == 0xEF) && (dma_target.regs[0x14] == 0x14);
+
+    i2c_done = false;
+    i2c_rx.fill(0);
+    i2c3.read(TARGET_ADDR, std::span{i2c_rx}, nullptr, i2c_cb);
+    sim::run_until([]() { return i2c_done; }, sim::to_cycles(100, 1000));
+    ok = ok && i2c_done && (i2c_err == I2cErr::Ok) && (i2c_rx[0] == 0x14) && (i2c_rx[3] == 0x17);
+
+    // a single byte and four bytes from the register 0x13 with a repeated START
+    i2c_rx.fill(0);
+    ok = ok && i2c_dma_write_read(std::span{i2c_rx}.first(1)) && (i2c_rx[0] == 0xEF)
+        && (i2c_rx[1] == 0x00);
+    ok = ok && i2c_dma_write_read(std::span{i2c_rx}) && (i2c_rx[0] == 0xEF)
+        && (i2c_rx[1] == 0x14) && (i2c_rx[3] == 0x16);
+
+    std::printf("\n--- I2C with DMA write, read and write_read @ 400kHz\n");
+    sim::print_stats();
+    check(ok, "I2C with DMA write, read and write_read");
+
+    // the number of interrupts doesn't depend on the length of the transfer
+    sim::reset_stats();
+    ok = i2c_dma_write_read(std::span{i2c_rx});
+    irqs_short = i2c_dma_irqs();
+
+    sim::reset_stats();
+    ok = ok && i2c_dma_write_read(std::span{i2c_burst}) && (i2c_burst[0] == 0xEF)
+        && (i2c_burst[1] == 0x14) && (i2c_burst[63] == 0x52);
+    irqs_long = i2c_dma_irqs();
+
+    std::printf("\n--- I2C with DMA interrupts: %llu for 4 bytes, %llu for 64 bytes\n",
+        static_cast<unsigned long long>(irqs_short), static_cast<unsigned long long>(irqs_long));
+    check(ok && (irqs_short == irqs_long), "I2C with DMA interrupts per transfer");
+
+    // the DMA-transfer of the NACKed job is dropped, the next job isn't affected
+    i2c_done = false;
+    i2c3.write(TARGET_ADDR + 1, std::span{i2c_tx}, nullptr, i2c_cb);
+    sim::run_until([]() { return i2c_done; }, sim::to_cycles(100, 1000));
+    ok = i2c_done && (i2c_err == I2cErr::Nack);
+
+    i2c_rx.fill(0);
+    ok = ok && i2c_dma_write_read(std::span{i2c_rx}) && (i2c_rx[0] == 0xEF)
+        && (i2c_rx[3] == 0x16);
+    check(ok, "I2C with DMA NACK of an unknown address");
+
+    // The STOP condition and the end of the DMA-transfer are pending at once. The USCI-interrupt
+    // is served first and finishes the job, the late DMA-completion must not touch the next job.
+    i2c_done = false;
+    primask = cm4f::disable_irq();
+    i2c3.write(TARGET_ADDR, std::span{i2c_tx}, nullptr, i2c_cb);
+    sim::run(sim::to_cycles(1, 1000));
+    ok = !i2c_done && sim::nvic().is_pending(irq_idx(IrqNr::EusciB3))
+        && sim::nvic().is_pending(irq_idx(IrqNr::DmaInt0));
+    cm4f::restore_irq(primask);
+    sim::run_until([]() { return i2c_done; }, sim::to_cycles(100, 1000));
+    ok = ok && i2c_done && (i2c_err == I2cErr::Ok);
+
+    i2c_rx.fill(0);
+    ok = ok && i2c_dma_write_read(std::span{i2c_rx}) && (i2c_rx[0] == 0xEF)
+        && (i2c_rx[3] == 0x16);
+    check(ok, "I2C with DMA completion after the STOP condition");
+}
+
+static bool profile_listed(const ProfileSection& section) noexcept
+{
+    for (const ProfileSection* s = ProfileSection::first(); s; s = s->next()) {
+        if (s == &section)
+            return true;
+    }
+
+    return false;
+}
+
+static void print_profile(const ProfileSection& section) noexcept
+{
+    std::printf("%-8s %4lu calls, min/mean/max: %lu/%lu/%lu cycles\n", section.name(),
+        static_cast<unsigned long>(section.count()), static_cast<unsigned long>(section.min()),
+        static_cast<unsigned long>(section.mean()), static_cast<unsigned long>(section.max()));
+}
+
+static void test_profiling() noexcept
+{
+    static constinit ProfileSection section{"test"};
+    const Dwt& dwt = chip.cortexm4f().dwt();
+    const ProfileSection& i2c_irq = i2c3.irq_profile();
+    const ProfileSection& tx_irq = chip.dma()[6].irq_profile();
+    const ProfileSection& rx_irq = chip.dma()[7].irq_profile();
+    bool ok;
+
+    ok = (section.count() == 0) && (section.min() == 0) && (section.max() == 0)
+        && (section.mean() == 0) && !profile_listed(section);
+    section.record(10);
+    section.record(30);
+    section.record(21);
+    ok = ok && (section.count() == 3) && (section.min() == 10) && (section.max() == 30)
+        && (section.mean() == 20) && profile_listed(section);
+    section.reset();
+    ok = ok && (section.count() == 0) && (section.min() == 0) && (section.max() == 0)
+        && (section.mean() == 0) && profile_listed(section);
+    check(ok, "ProfileSection statistics");
+
+    // nothing is measured until the DWT is handed over
+    ok = i2c_dma_write_read(std::span{i2c_rx}) && (i2c_irq.count() == 0) && (tx_irq.count() == 0)
+        && (rx_irq.count() == 0);
+
+    i2c3.enable_profiling(dwt);
+    chip.dma().enable_profiling(dwt);
+    ok = ok && i2c_dma_write_read(std::span{i2c_rx}) && i2c_dma_write_read(std::span{i2c_burst});
+
+    // every register access of a handler takes ACCESS_CYCLES within the simulation
+    for (const ProfileSection* s : {&i2c_irq, &tx_irq, &rx_irq}) {
+        ok = ok && (s->count() >= 2) && (s->min() > 0) && (s->min() <= s->mean())
+            && (s->mean() <= s->max()) && (s->max() < sim::to_cycles(100, 1'000'000))
+            && profile_listed(*s);
+    }
+
+    std::printf("\n--- DWT profiling of the I2C with DMA interrupt handlers\n");
+    print_profile(i2c_irq);
+    print_profile(tx_irq);
+    print_profile(rx_irq);
+    check(ok, "DWT profiling of the interrupt handlers");
+}
+
+static void sched_cb(I2cJobType type, I2cErr err, std::span<uint8_t> rxbuf, void* cookie)
+{
+    sched_order[sched_cnt] = static_cast<uint8_t>(reinterpret_cast<uintptr_t>(cookie));
+    sched_err[sched_cnt] = err;
+    sched_cnt++;
+}
+
+static void sched_write(uint16_t addr, uintptr_t id, I2cPriority prio) noexcept
+{
+    i2c0.write(addr, std::span{i2c_tx}, reinterpret_cast<void*>(id), sched_cb, false, prio);
+}
+
+static void test_i2c_scheduler() noexcept
+{
+    sim::Cycles start;
+    bool ok;
+
+    // the read overtakes the bulk writes, except the first one which is already on the bus
+    sched_cnt = 0;
+    sched_write(TARGET_ADDR, 0, I2cPriority::Low);
+    sched_write(TARGET_ADDR, 1, I2cPriority::Low);
+    sched_write(TARGET_ADDR, 2, I2cPriority::Low);
+    i2c0.read(TARGET_ADDR, std::span{i2c_rx}, reinterpret_cast<void*>(3), sched_cb, false,
+        I2cPriority::High);
+    sim::run_until([]() { return sched_cnt == 4; }, sim::to_cycles(100, 1000));
+    ok = (sched_cnt == 4) && (sched_order[0] == 0) && (sched_order[1] == 3)
+        && (sched_order[2] == 1) && (sched_order[3] == 2);
+    check(ok, "I2C scheduler priority classes");
+
+    // The missing device is backed off for 1 + 2 + 4ms between its attempts (each one may be up to
+    // 1ms shorter due to the resolution of the EventTimer) while the jobs of the present device go
+    // on, even though they have a lower priority.
+    sched_cnt = 0;
+    start = sim::now();
+    sched_write(MISSING_ADDR, 0, I2cPriority::High);
+    sched_write(TARGET_ADDR, 1, I2cPriority::Normal);
+    sched_write(TARGET_ADDR, 2, I2cPriority::Normal);
+    sim::run_until([]() { return sched_cnt == 3; }, sim::to_cycles(200, 1000));
+    ok = (sched_cnt == 3) && (sched_order[0] == 1) && (sched_order[1] == 2)
+        && (sched_order[2] == 0) && (sched_err[1] == I2cErr::Ok) && (sched_err[2] == I2cErr::Nack)
+        && ((sim::now() - start) >= sim::to_cycles(4, 1000)) && !sim::uscib(0).i2c_held();
+    check(ok, "I2C scheduler backoff of a missing device");
+
+    // the jobs of the present device overtake the ones of the missing device within their class,
+    // the jobs of each device keep their order
+    sched_cnt = 0;
+    sched_write(MISSING_ADDR, 0, I2cPriority::Normal);
+    sched_write(MISSING_ADDR, 1, I2cPriority::Normal);
+    sched_write(TARGET_ADDR, 2, I2cPriority::Normal);
+    sched_write(TARGET_ADDR, 3, I2cPriority::Normal);
+    sim::run_until([]() { return sched_cnt == 2; }, sim::to_cycles(10, 1000));
+    ok = (sched_cnt == 2) && (sched_order[0] == 2) && (sched_order[1] == 3);
+    sim::run_until([]() { return sched_cnt == 4; }, sim::to_cycles(1000, 1000));
+    ok = ok && (sched_cnt == 4) && (sched_order[2] == 0) && (sched_order[3] == 1)
+        && (sched_err[3] == I2cErr::Nack) && !sim::uscib(0).i2c_held();
+    check(ok, "I2C scheduler backoff within a class");
+}
+
+static bool scan_done = false;
+static Err scan_err = Err::NotOk;
+static Bitmap<128> scan_found{};
+
+static void scan_cb(Err err, const Bitmap<128>& found, void* cookie) noexcept
+{
+    scan_err = err;
+    scan_found = found;
+    scan_done = true;
+}
+
+// checks that exactly the given addresses acknowledged their probes
+static bool scan(I2cMaster& i2c, std::span<const uint16_t> expected) noexcept
+{
+    size_t cnt = 0;
+
+    scan_done = false;
+    if (i2c.scan(nullptr, scan_cb) != Err::Ok)
+        return false;
+
+    sim::run_until([]() { return scan_done; }, sim::to_cycles(100, 1000));
+    if (!scan_done || (scan_err != Err::Ok))
+        return false;
+
+    for (uint16_t addr = 0; addr < 128; addr++)
+        cnt += scan_found.test(addr).value_or(false) ? 1 : 0;
+
+    for (uint16_t addr : expected) {
+        if (!scan_found.test(addr).value_or(false))
+            return false;
+    }
+
+    return cnt == expected.size();
+}
+
+static void test_i2c_scan() noexcept
+{
+    static constexpr std::array<uint16_t, 2> found0 = {TARGET_ADDR, DEVICE_ADDR};
+    static constexpr std::array<uint16_t, 1> found3 = {TARGET_ADDR};
+    bool ok;
+
+    // only one scan runs at a time, the queue goes on with the other jobs afterwards
+    ok = scan(i2c0, std::span{found0});
+    scan_done = false;
+    ok = ok && (i2c0.scan(nullptr, scan_cb) == Err::Ok)
+        && (i2c0.scan(nullptr, scan_cb) == Err::Busy);
+    sim::run_until([]() { return scan_done; }, sim::to_cycles(100, 1000));
+
+    i2c_done = false;
+    i2c0.write(TARGET_ADDR, std::span{i2c_tx}, nullptr, i2c_cb);
+    sim::run_until([]() { return i2c_done; }, sim::to_cycles(100, 1000));
+    ok = ok && i2c_done && (i2c_err == I2cErr::Ok);
+    check(ok, "I2C bus scan");
+
+    check(scan(i2c3, std::span{found3}), "I2C with DMA bus scan");
+}
+
+static uint32_t scl_clocks = 0;
+static uint32_t scl_release_at = 0;
+
+static void scl_cb(IntEdge edge, void* cookie) noexcept
+{
+    // the stuck device releases SDA after the given number of clocks
+    scl_clocks++;
+    if (scl_clocks == scl_release_at)
+        sim::gpio().release(IntPinNr::P01_6);
+}
+
+static void test_i2c_recovery() noexcept
+{
+    IntPin& scl = chip.gpio_pins().int_pin(IntPinNr::P01_7);
+    IntPin& sda = chip.gpio_pins().int_pin(IntPinNr::P01_6);
+    const Dwt& dwt = chip.cortexm4f().dwt();
+    bool ok;
+
+    scl.make_input();
+    scl.enable_interrupt(IntEdge::Falling, nullptr, scl_cb);
+
+    // a device which never releases SDA is clocked RECOVERY_CLOCKS times, no STOP is sent
+    scl_clocks = 0;
+    scl_release_at = 0;
+    sim::gpio().drive(IntPinNr::P01_6, false);
+    ok = (i2c0.recover(chip.cs(), dwt, scl, sda) == Err::Busy)
+        && (scl_clocks == I2cMaster::RECOVERY_CLOCKS);
+
+    // the device releases SDA after 3 clocks, the 4th falling edge of SCL belongs to the STOP
+    scl_clocks = 0;
+    scl_release_at = 3;
+    ok = ok && (i2c0.recover(chip.cs(), dwt, scl, sda) == Err::Ok) && (scl_clocks == 4)
+        && sim::gpio().level(IntPinNr::P01_6);
+
+    scl.disable_interrupt();
+
+    // the USCI takes over the bus again
+    i2c_done = false;
+    i2c0.write(TARGET_ADDR, std::span{i2c_tx}, nullptr, i2c_cb);
+    sim::run_until([]() { return i2c_done; }, sim::to_cycles(100, 1000));
+    ok = ok && i2c_done && (i2c_err == I2cErr::Ok);
+    check(ok, "I2C bus recovery");
+}
+
+// an I2C target which counts the (repeated) START conditions addressed to it and optionally
+// doesn't acknowledge the written data
+class CountingTarget : public sim::I2cRegisterTarget {
+public:
+    bool start(bool read) noexcept override
+    {
+        transfers++;
+        return sim::I2cRegisterTarget::start(read);
+    }
+
+    bool write(uint8_t byte) noexcept override
+    {
+        return sim::I2cRegisterTarget::write(byte) && !nack_data;
+    }
+
+    size_t transfers = 0;
+    bool nack_data = false;
+};
+
+static CountingTarget dev_target{};
+static size_t dev_writes = 0;
+static size_t dev_reads = 0;
+static I2cErr dev_err = I2cErr::Ok;
+
+static void dev_cb(I2cJobType type, I2cErr err, uint8_t reg, std::span<uint8_t> data,
+    void* cookie) noexcept
+{
+    if (err != I2cErr::Ok)
+        dev_err = err;
+
+    if (type == I2cJobType::Write)
+        dev_writes++;
+    else
+        dev_reads++;
+}
+
+static I2cDevice<> dev{i2c0, DEVICE_ADDR, I2cByteOrder::BigEndian, nullptr, dev_cb};
+
+static void test_i2c_device() noexcept
+{
+    std::array<uint8_t, 4> buf = {};
+    bool ok;
+
+    sim::uscib(0).attach(DEVICE_ADDR, dev_target);
+    dev_target.regs[0x10] = 0xCA;
+    dev_target.regs[0x11] = 0xFE;
+    dev.set_cached(0xF0, 16);
+
+    // two collected registers and a 16-bit one are merged into a single burst
+    dev.write_reg<uint8_t>(0xF4, 0x27, false);
+    dev.write_reg<uint8_t>(0xF5, 0xA0, false);
+    dev.write_reg<uint16_t>(0xF6, 0x1234);
+    sim::run_until([]() { return dev_writes == 1; }, sim::to_cycles(100, 1000));
+    ok = (dev_target.transfers == 1) && (dev_target.regs[0xF4] == 0x27)
+        && (dev_target.regs[0xF5] == 0xA0) && (dev_target.regs[0xF6] == 0x12)
+        && (dev_target.regs[0xF7] == 0x34);
+
+    // the configuration registers are served by the shadow without any transfer
+    ok = ok && (dev.cached_reg<uint16_t>(0xF6).value_or(0) == 0x1234)
+        && !dev.cached_reg<uint8_t>(0xF8).has_value();
+    ok = ok && (dev.read_regs(0xF4, std::span{buf}) == Err::Ok) && (dev_reads == 1)
+        && (buf[1] == 0xA0) && (buf[3] == 0x34) && (dev_target.transfers == 1);
+
+    // read-modify-write of a cached register
+    dev.modify_reg(0xF4, 0x03, 0x01);
+    sim::run_until([]() { return dev_writes == 2; }, sim::to_cycles(100, 1000));
+    ok = ok && (dev_target.regs[0xF4] == 0x25) && (dev_target.transfers == 2);
+
+    // registers which aren't cached are always read from the device, the repeated START counts as
+    // a second transfer
+    dev.read_regs(0x10, std::span{buf}.first(2));
+    sim::run_until([]() { return dev_reads == 2; }, sim::to_cycles(100, 1000));
+    ok = ok && (dev.value<uint16_t>(std::span{buf}.first(2)) == 0xCAFE)
+        && (dev_target.transfers == 4);
+
+    // the registers written while the first write is going on are merged
+    dev.write_reg<uint8_t>(0xF8, 1);
+    dev.write_reg<uint8_t>(0xF9, 2);
+    dev.write_reg<uint8_t>(0xFA, 3);
+    sim::run_until([]() { return dev_writes == 4; }, sim::to_cycles(100, 1000));
+    ok = ok && (dev_target.transfers == 6) && (dev_target.regs[0xF9] == 2)
+        && (dev_target.regs[0xFA] == 3);
+
+    check(ok && (dev_err == I2cErr::Ok), "I2cDevice shadow cache and burst coalescing");
+
+    // the shadow of a failed write isn't trusted anymore, thus the register is read from the device
+    dev_target.nack_data = true;
+    dev.write_reg<uint8_t>(0xF4, 0x55);
+    sim::run_until([]() { return dev_writes == 5; }, sim::to_cycles(1000, 1000));
+    ok = (dev_err == I2cErr::Nack) && !dev.cached_reg<uint8_t>(0xF4).has_value()
+        && (dev.cached_reg<uint8_t>(0xF5).value_or(0) == 0xA0);
+
+    dev_target.nack_data = false;
+    dev_target.regs[0xF4] = 0x25;
+    dev_target.transfers = 0;
+    ok = ok && (dev.read_regs(0xF4, std::span{buf}.first(1)) == Err::Ok);
+    sim::run_until([]() { return dev_reads == 3; }, sim::to_cycles(1000, 1000));
+    ok = ok && (buf[0] == 0x25) && (dev_target.transfers == 2)
+        && (dev.cached_reg<uint8_t>(0xF4).value_or(0) == 0x25);
+    dev_err = I2cErr::Ok;
+
+    check(ok, "I2cDevice failed write");
+
+    // a read which doesn't fit into the queue of the I2cMaster is rejected and never issued
+    sched_cnt = 0;
+    for (uintptr_t i = 0; i < 8; i++)
+        sched_write(TARGET_ADDR, i, I2cPriority::Normal);
+    buf.fill(0);
+    ok = dev.read_regs(0x10, std::span{buf}.first(2)) == Err::NoMem;
+    sim::run_until([]() { return sched_cnt == 8; }, sim::to_cycles(100, 1000));
+    sim::run(sim::to_cycles(5, 1000));
+    ok = ok && (sched_cnt == 8) && (dev_reads == 3) && (buf[0] == 0);
+
+    ok = ok && (dev.read_regs(0x10, std::span{buf}.subspan(2)) == Err::Ok);
+    sim::run_until([]() { return dev_reads == 4; }, sim::to_cycles(100, 1000));
+    sim::run(sim::to_cycles(5, 1000));
+    ok = ok && (dev_reads == 4) && (buf[0] == 0)
+        && (dev.value<uint16_t>(std::span{buf}.subspan(2)) == 0xCAFE);
+    check(ok && (dev_err == I2cErr::Ok), "I2cDevice read with a full queue");
+}
+
+static void test_event_timer() noexcept
+{
+    auto ev = ev_timer.register_event(EVENT_INTERVAL_MS, nullptr, ev_cb).value();
+
+    sim::reset_stats();
+    ev_start = sim::now();
+    ev_timer.start_event(ev);
+    sim::run(sim::to_cycles(EVENT_INTERVAL_MS * EVENT_CNT + EVENT_INTERVAL_MS / 2, 1000));
+    ev_timer.stop_event(ev);
+
+    std::printf("\n--- EventTimer, %lu ms interval\n", static_cast<unsigned long>(EVENT_INTERVAL_MS));
+    sim::print_stats();
+    std::printf("max. deviation: %llu cycles\n", static_cast<unsigned long long>(ev_jitter));
+    check(ev_cnt == EVENT_CNT, "EventTimer periodic event");
+}
+
+static EventTimer::Event handoff_periodic{};
+static EventTimer::Event handoff_oneshot{};
+static sim::Cycles handoff_at = 0;
+static sim::Cycles oneshot_at = 0;
+
+// the last armed event stops itself and starts another one, as Button::sleep() and wake_up() do
+static void handoff_cb(void* cookie) noexcept
+{
+    ev_timer.stop_event(handoff_periodic);
+    ev_timer.start_event(handoff_oneshot);
+    handoff_at = sim::now();
+}
+
+static void oneshot_cb(void* cookie) noexcept
+{
+    oneshot_at = sim::now();
+}
+
+static void test_event_timer_handoff() noexcept
+{
+    sim::Cycles delay;
+    bool ok;
+
+    handoff_periodic = ev_timer.register_event(5, nullptr, handoff_cb).value();
+    handoff_oneshot = ev_timer.register_event(50, nullptr, oneshot_cb,
+        EventTimer::EventMode::OneShot).value();
+
+    ok = ev_timer.start_event(handoff_periodic) == Err::Ok;
+    sim::run_until([]() { return oneshot_at != 0; }, sim::to_cycles(100, 1000));
+
+    delay = oneshot_at - handoff_at;
+    ok = ok && (handoff_at != 0) && (oneshot_at != 0)
+        && (delay >= sim::to_cycles(49, 1000)) && (delay <= sim::to_cycles(51, 1000));
+    ok = ok && !ev_timer.is_running(handoff_periodic).value_or(true)
+        && !ev_timer.is_running(handoff_oneshot).value_or(true);
+
+    std::printf("\n--- EventTimer one-shot started by the callback of the last event\n");
+    std::printf("elapsed after: %llu cycles\n", static_cast<unsigned long long>(delay));
+    check(ok, "EventTimer stop and start within a callback");
+}
+
+static size_t many_cnt = 0;
+
+static void many_cb(void* cookie) noexcept
+{
+    many_cnt++;
+}
+
+static void test_event_timer_many() noexcept
+{
+    bool ok = true;
+
+    // more events than an 8-bit index could address
+    for (size_t i = 0; i < MANY_EVENTS; i++) {
+        auto ev = many_timer.register_event(static_cast<uint32_t>(1 + (i % 50)), nullptr, many_cb,
+            EventTimer::EventMode::OneShot);
+        ok = ok && ev.has_value() && (many_timer.start_event(*ev) == Err::Ok);
+    }
+    auto full = many_timer.register_event(1, nullptr, many_cb);
+    ok = ok && !full.has_value() && (full.error() == Err::NoMem);
+
+    sim::run_until([]() { return many_cnt == MANY_EVENTS; }, sim::to_cycles(100, 1000));
+    check(ok && (many_cnt == MANY_EVENTS), "EventTimer with 300 events");
+}
+
+static void test_int_pin() noexcept
+{
+    bool ok;
+
+    // the buttons pull the pins to GND
+    s1.make_input();
+    s1.set_pull_mode(PullMode::PullUp);
+    s2.make_input();
+    s2.set_pull_mode(PullMode::PullUp);
+    s1.enable_interrupt(IntEdge::Falling, nullptr, s1_cb);
+    s2.enable_interrupt(IntEdge::Falling, nullptr, s2_cb);
+    sim::reset_stats();
+
+    sim::gpio().drive(IntPinNr::P01_1, false);
+    sim::run(100);
+    sim::gpio().release(IntPinNr::P01_1);
+    sim::run(100);
+    ok = (s1_falling == 1) && (s1_rising == 1) && (s2_falling == 0);
+
+    // both flags are served by a single interrupt
+    uint32_t primask = cm4f::disable_irq();
+    sim::gpio().drive(IntPinNr::P01_1, false);
+    sim::gpio().drive(IntPinNr::P01_4, false);
+    cm4f::restore_irq(primask);
+    sim::run(100);
+    ok = ok && (s1_falling == 2) && (s2_falling == 1)
+        && (sim::nvic().irq_stats(irq_idx(IrqNr::Port1)).count == 3);
+
+    // a disabled pin doesn't invoke its callback anymore
+    s2.disable_interrupt();
+    sim::gpio().release(IntPinNr::P01_4);
+    sim::gpio().drive(IntPinNr::P01_4, false);
+    sim::run(100);
+    ok = ok && (s2_falling == 1) && !s2.interrupt_enabled() && s1.interrupt_enabled()
+        && (s1.get_edge() == IntEdge::Rising);
+
+    std::printf("\n--- IntPin edge interrupts on P1.1 and P1.4\n");
+    sim::print_stats();
+    check(ok, "IntPin edge interrupts");
+}
+
+// toggles the pin like a bouncing contact before it settles at 'level'
+static void bounce(IntPinNr nr, bool level) noexcept
+{
+    for (size_t i = 0; i < 4; i++) {
+        sim::gpio().drive(nr, (i % 2) == 0 ? level : !level);
+        sim::run(sim::to_cycles(1, 1000));
+    }
+
+    sim::gpio().drive(nr, level);
+}
+
+static void test_button() noexcept
+{
+    constexpr size_t PRESSED = static_cast<size_t>(ButtonEvent::Pressed);
+    constexpr size_t RELEASED = static_cast<size_t>(ButtonEvent::Released);
+    constexpr size_t LONG_PRESS = static_cast<size_t>(ButtonEvent::LongPress);
+    sim::Timer32Model& t32 = sim::timer32(0);
+    uint64_t samples;
+    bool ok;
+
+    // the button pulls the pin to GND
+    sim::gpio().release(IntPinNr::P01_5);
+    btn.init(nullptr, btn_cb);
+    btn.enable_event(ButtonEvent::Pressed);
+    btn.enable_event(ButtonEvent::Released);
+    btn.enable_event(ButtonEvent::LongPress);
+
+    // the initial level is reported as release, afterwards the sampling stops
+    sim::run(sim::to_cycles(100, 1000));
+    sim::reset_stats();
+    sim::run(sim::to_cycles(1000, 1000));
+    ok = (btn_events[RELEASED] == 1) && (t32.expirations() == 0);
+
+    // the long press is only detected by sampling, afterwards it stops until the release
+    bounce(IntPinNr::P01_5, false);
+    sim::run(sim::to_cycles(2000, 1000));
+    samples = t32.expirations();
+    sim::run(sim::to_cycles(1000, 1000));
+    ok = ok && (btn_events[PRESSED] == 1) && (btn_events[LONG_PRESS] == 1)
+        && (t32.expirations() == samples);
+
+    bounce(IntPinNr::P01_5, true);
+    sim::gpio().release(IntPinNr::P01_5);
+    sim::run(sim::to_cycles(100, 1000));
+    samples = t32.expirations();
+    sim::run(sim::to_cycles(1000, 1000));
+    ok = ok && (btn_events[PRESSED] == 1) && (btn_events[RELEASED] == 2)
+        && (t32.expirations() == samples);
+
+    std::printf("\n--- interrupt-driven Button on P1.5\n");
+    sim::print_stats();
+    check(ok, "interrupt-driven Button");
+}
+
+static void test_button_group() noexcept
+{
+    constexpr size_t PRESSED = static_cast<size_t>(ButtonEvent::Pressed);
+    constexpr size_t RELEASED = static_cast<size_t>(ButtonEvent::Released);
+    constexpr size_t LONG_PRESS = static_cast<size_t>(ButtonEvent::LongPress);
+    bool ok;
+
+    keypad.init(nullptr, key_cb);
+    keypad.enable_event(ButtonEvent::Pressed);
+    keypad.enable_event(ButtonEvent::Released);
+    keypad.enable_event(ButtonEvent::LongPress);
+    sim::run(sim::to_cycles(100, 1000));
+    sim::reset_stats();
+
+    // two keys are pressed at once, a glitch of 20ms on the third one is filtered
+    bounce(IntPinNr::P03_2, false);
+    bounce(IntPinNr::P03_5, false);
+    sim::gpio().drive(IntPinNr::P03_0, false);
+    sim::run(sim::to_cycles(20, 1000));
+    sim::gpio().release(IntPinNr::P03_0);
+    sim::run(sim::to_cycles(100, 1000));
+    ok = (key_events[1][PRESSED] == 1) && (key_events[2][PRESSED] == 1)
+        && (key_events[0][PRESSED] == 0) && keypad.is_pressed(1) && !keypad.is_pressed(0);
+
+    // only the held key reports the long press
+    bounce(IntPinNr::P03_5, true);
+    sim::gpio().release(IntPinNr::P03_5);
+    sim::run(sim::to_cycles(2000, 1000));
+    ok = ok && (key_events[2][RELEASED] == 1) && (key_events[2][LONG_PRESS] == 0)
+        && (key_events[1][LONG_PRESS] == 1) && (key_events[1][RELEASED] == 0);
+
+    bounce(IntPinNr::P03_2, true);
+    sim::gpio().release(IntPinNr::P03_2);
+    sim::run(sim::to_cycles(100, 1000));
+    ok = ok && (key_events[1][RELEASED] == 1) && (key_events[0][RELEASED] == 0);
+    keypad.disable_event(ButtonEvent::Pressed);
+    keypad.disable_event(ButtonEvent::Released);
+    keypad.disable_event(ButtonEvent::LongPress);
+
+    std::printf("\n--- ButtonGroup on P3.0, P3.2 and P3.5\n");
+    sim::print_stats();
+    check(ok, "ButtonGroup");
+}
+
+static Rgb led_color(size_t i) noexcept
+{
+    return Rgb{static_cast<uint8_t>(i), static_cast<uint8_t>(i * 7), static_cast<uint8_t>(~i)};
+}
+
+static uint32_t led_grb(size_t i) noexcept
+{
+    return (static_cast<uint32_t>(static_cast<uint8_t>(i * 7)) << 16)
+        | (static_cast<uint32_t>(static_cast<uint8_t>(i)) << 8) | static_cast<uint8_t>(~i);
+}
+
+template<size_t N, W2812BMode MODE>
+static void refresh(W2812B<N, MODE>& w, const char* what) noexcept
+{
+    bool ok = w.init() == Err::Ok;
+    sim::Cycles start;
+
+    for (size_t i = 0; i < N; i++)
+        ok = ok && (w.set_color(i, led_color(i)) == Err::Ok);
+
+    leds = {};
+    led_bits = 0;
+    led_corrupt = false;
+    sim::reset_stats();
+    start = sim::now();
+
+    ok = ok && (w.refresh_leds() == Err::Ok);
+    sim::run_until([&w]() { return !w.is_busy(); }, sim::to_cycles(10, 1000));
+
+    ok = ok && !w.is_busy() && !led_corrupt && (led_bits == (N * 24));
+    for (size_t i = 0; i < N; i++)
+        ok = ok && (leds[i] == led_grb(i));
+
+    std::printf("\n--- %s, %zu LEDs @ %lu Hz, %zu bytes of RAM\n", what, N,
+        static_cast<unsigned long>(spi2.get_actual_freq_hz()), sizeof(w));
+    std::printf("frame: %llu cycles\n", static_cast<unsigned long long>(sim::now() - start));
+    sim::print_stats();
+    check(ok, what);
+}
+
+// only the LEDs up to the changed one are sent, at least two chunks in streaming mode
+template<size_t N, W2812BMode MODE>
+static bool refresh_partial(W2812B<N, MODE>& w, size_t idx, size_t expected) noexcept
+{
+    bool ok = w.set_color(idx, Rgb{1, 2, 3}) == Err::Ok;
+
+    leds = {};
+    led_bits = 0;
+    ok = ok && (w.refresh_leds() == Err::Ok);
+    sim::run_until([&w]() { return !w.is_busy(); }, sim::to_cycles(10, 1000));
+    ok = ok && (led_bits == (expected * 24)) && (leds[idx] == 0x020103);
+
+    // nothing has changed -> nothing is sent
+    led_bits = 0;
+    ok = ok && (w.refresh_leds() == Err::Ok) && !w.is_busy();
+    sim::run(sim::to_cycles(1, 1000));
+    return ok && (led_bits == 0);
+}
+
+static void test_w2812b() noexcept
+{
+    bool ok;
+
+    sim::uscib(2).set_spi_slave(led_slave, nullptr);
+
+    refresh(strip, "W2812B encoded");
+    refresh(panel, "W2812B streaming");
+
+    check(refresh_partial(strip, 10, 11) && refresh_partial(panel, 3, 16),
+        "W2812B partial refresh");
+
+    // the brightness is applied to the stored colors when the next frame is encoded
+    leds = {};
+    led_bits = 0;
+    ok = (panel.set_brightness(127) == Err::Ok) && (panel.refresh_leds() == Err::Ok);
+    sim::run_until([]() { return !panel.is_busy(); }, sim::to_cycles(10, 1000));
+    ok = ok && (led_bits == (PANEL_LEDS * 24)) && (leds[3] == 0x010001);
+    for (size_t i = 4; i < PANEL_LEDS; i++)
+        ok = ok && (leds[i] == ((led_grb(i) >> 1) & 0x7F7F7F));
+
+    ok = ok && (panel.set_brightness(0xFF) == Err::Ok);
+
+    // the encoded mode keeps the colors only in the back buffer
+    ok = ok && (strip.set_brightness(127) == Err::NotSupported) && (dim_strip.init() == Err::Ok);
+    for (size_t i = 0; i < 4; i++)
+        ok = ok && (dim_strip.set_color(i, led_color(i + 8)) == Err::Ok);
+    ok = ok && (dim_strip.refresh_leds() == Err::Ok);
+    sim::run_until([]() { return !dim_strip.is_busy(); }, sim::to_cycles(10, 1000));
+
+    leds = {};
+    led_bits = 0;
+    ok = ok && (dim_strip.set_brightness(127) == Err::Ok) && (dim_strip.refresh_leds() == Err::Ok);
+    sim::run_until([]() { return !dim_strip.is_busy(); }, sim::to_cycles(10, 1000));
+    ok = ok && (led_bits == (4 * 24));
+    for (size_t i = 0; i < 4; i++)
+        ok = ok && (leds[i] == ((led_grb(i + 8) >> 1) & 0x7F7F7F));
+    check(ok, "W2812B brightness");
+
+    // (i / 255)^2.5 * 255
+    leds = {};
+    led_bits = 0;
+    ok = (gamma_strip.init() == Err::Ok);
+    ok = ok && (gamma_strip.set_color(0, Rgb{0xFF, 128, 64}) == Err::Ok);
+    ok = ok && (gamma_strip.set_color(1, Rgb{200, 1, 0}) == Err::Ok);
+    ok = ok && (gamma_strip.refresh_leds() == Err::Ok);
+    sim::run_until([]() { return !gamma_strip.is_busy(); }, sim::to_cycles(10, 1000));
+    ok = ok && (led_bits == (4 * 24)) && (leds[0] == 0x2EFF08) && (leds[1] == 0x008B00);
+    check(ok, "W2812B gamma");
+
+    // Without room for the frame and its reset nothing is queued, the LEDs stay dirty. The filler
+    // is sent as reset-bytes which the LEDs ignore.
+    static constexpr std::array<uint8_t, 4> filler{};
+
+    leds = {};
+    led_bits = 0;
+    spi_done = false;
+    ok = gamma_strip.set_color(2, Rgb{0, 0, 0xFF}) == Err::Ok;
+    while (ok && (spi2.get_free_jobs() > 1))
+        ok = spi2.write(std::span{filler}, nullptr, nullptr, spi_cb) == Err::Ok;
+    ok = ok && (gamma_strip.refresh_leds() == Err::NoMem) && !gamma_strip.is_busy();
+    sim::run_until([]() { return spi_done && (spi2.get_free_jobs() > 1); },
+        sim::to_cycles(10, 1000));
+    ok = ok && (led_bits == 0) && (gamma_strip.refresh_leds() == Err::Ok);
+    sim::run_until([]() { return !gamma_strip.is_busy(); }, sim::to_cycles(10, 1000));
+    ok = ok && (led_bits == (3 * 24)) && (leds[2] == 0x0000FF);
+    check(ok, "W2812B queue full");
+}
+
+// the index of the LED at (x, y), the rows are connected in a serpentine manner
+static size_t matrix_led(uint16_t x, uint16_t y) noexcept
+{
+    return (y & 0x01) ? (y * MATRIX_SIZE + x) : (y * MATRIX_SIZE + MATRIX_SIZE - x - 1);
+}
+
+static void test_w2812b_matrix() noexcept
+{
+    constexpr size_t FRAME = MATRIX_SIZE * MATRIX_SIZE;
+    constexpr uint32_t RED = 0x00FF00;
+    constexpr uint32_t BLUE = 0x0000FF;
+
+    bool ok = matrix.init() == Err::Ok;
+
+    leds = {};
+    led_bits = 0;
+    led_corrupt = false;
+    sim::reset_stats();
+
+    // The second frame is drawn while the first one is sent and follows right after it. Drawing
+    // after presenting it doesn't show up in it, a third frame has to wait for the first one.
+    ok = ok && (matrix.clear() == Err::Ok);
+    ok = ok && (matrix.draw_rectangle_filled(0, 3, 0, 3, Rgb{0xFF, 0, 0}) == Err::Ok);
+    ok = ok && (matrix.present() == Err::Ok);
+    ok = ok && matrix.is_busy();
+    ok = ok && (matrix.draw_pixel(7, 7, Rgb{0, 0, 0xFF}) == Err::Ok);
+    ok = ok && (matrix.draw_pixel(5, 0, Rgb{0, 0, 0xFF}) == Err::Ok);
+    ok = ok && (matrix.present() == Err::Ok);
+    ok = ok && (matrix.draw_pixel(6, 6, Rgb{0, 0, 0xFF}) == Err::Ok);
+    ok = ok && (matrix.present() == Err::Busy);
+    sim::run_until([]() { return !matrix.is_busy(); }, sim::to_cycles(10, 1000));
+
+    ok = ok && !matrix.is_busy() && !led_corrupt && (led_bits == (2 * FRAME * 24));
+    ok = ok && (leds[matrix_led(0, 0)] == RED) && (leds[matrix_led(3, 3)] == RED);
+    ok = ok && (leds[matrix_led(7, 7)] == 0) && (leds[matrix_led(7, 0)] == 0);
+    ok = ok && (leds[FRAME + matrix_led(0, 0)] == RED) && (leds[FRAME + matrix_led(4, 4)] == 0);
+    ok = ok && (leds[FRAME + matrix_led(7, 7)] == BLUE) && (leds[FRAME + matrix_led(5, 0)] == BLUE);
+    ok = ok && (leds[FRAME + matrix_led(6, 6)] == 0);
+
+    std::printf("\n--- W2812BMatrix %ux%u, two frames presented back to back\n", MATRIX_SIZE,
+        MATRIX_SIZE);
+    sim::print_stats();
+    check(ok, "W2812BMatrix present");
+}
+
+static uint32_t px(uint16_t x, uint16_t y) noexcept
+{
+    return leds[matrix_led(x, y)];
+}
+
+// the LEDs keep the colors of the previous frame beyond the part which is sent
+static bool present_matrix() noexcept
+{
+    led_bits = 0;
+    led_corrupt = false;
+
+    if (matrix.present() != Err::Ok)
+        return false;
+
+    return sim::run_until([]() { return !matrix.is_busy(); }, sim::to_cycles(10, 1000))
+        && !led_corrupt;
+}
+
+static void test_w2812b_blit() noexcept
+{
+    static constexpr std::array<Rgb, 6> icon = {
+        Rgb{1, 0, 0}, Rgb{2, 0, 0}, Rgb{3, 0, 0},
+        Rgb{4, 0, 0}, Rgb{5, 0, 0}, Rgb{6, 0, 0},
+    };
+    static constexpr std::array<Rgb, 2> sprite = {Rgb{0, 0, 1}, Rgb{0, 9, 0}};
+    static constexpr std::array<uint8_t, 2> glyph = {0b10100000, 0b01000000};
+
+    bool ok = matrix.clear() == Err::Ok;
+
+    // clipped at the left and the bottom, transparent and monochrome
+    ok = ok && (matrix.blit(-1, 6, std::span{icon}, 3) == Err::Ok);
+    ok = ok && (matrix.blit(3, 3, std::span{sprite}, 2, Rgb{0, 0, 1}) == Err::Ok);
+    ok = ok && (matrix.blit_mono(5, 0, std::span{glyph}, 3, Rgb{0, 0, 0xFF}) == Err::Ok);
+    ok = ok && (matrix.blit(0, 8, std::span{icon}, 3) == Err::Ok);
+    ok = ok && (matrix.blit(0, 0, std::span{icon}, 4) == Err::NotOk);
+    ok = ok && present_matrix();
+
+    ok = ok && (px(0, 6) == 0x000200) && (px(1, 6) == 0x000300) && (px(2, 6) == 0);
+    ok = ok && (px(0, 7) == 0x000500) && (px(1, 7) == 0x000600);
+    ok = ok && (px(3, 3) == 0) && (px(4, 3) == 0x090000);
+    ok = ok && (px(5, 0) == 0xFF) && (px(6, 0) == 0) && (px(7, 0) == 0xFF) && (px(6, 1) == 0xFF);
+
+    // odd rows reverse every row, even ones move all rows at once
+    ok = ok && (matrix.scroll_rows(-1, Rgb{}) == Err::Ok);
+    ok = ok && (matrix.scroll_columns(2, Rgb{}) == Err::Ok);
+    ok = ok && present_matrix();
+    ok = ok && (px(2, 5) == 0x000200) && (px(3, 5) == 0x000300) && (px(2, 6) == 0x000500);
+    ok = ok && (px(0, 5) == 0) && (px(2, 7) == 0) && (px(7, 0) == 0) && (px(6, 2) == 0x090000);
+
+    ok = ok && (matrix.scroll_rows(2, Rgb{}) == Err::Ok);
+    ok = ok && (matrix.scroll_columns(-1, Rgb{}) == Err::Ok);
+    ok = ok && present_matrix();
+    ok = ok && (px(1, 7) == 0x000200) && (px(2, 7) == 0x000300) && (px(5, 4) == 0x090000);
+    ok = ok && (px(0, 0) == 0) && (px(1, 6) == 0) && (px(7, 4) == 0);
+
+    check(ok, "W2812BMatrix blit and scroll");
+}
+
+// compares the lit pixels with a mask of one byte per row, the MSB is the leftmost pixel
+static bool matrix_equals(const std::array<uint8_t, MATRIX_SIZE>& mask) noexcept
+{
+    bool ok = present_matrix();
+
+    for (uint16_t y = 0; y < MATRIX_SIZE; y++) {
+        for (uint16_t x = 0; x < MATRIX_SIZE; x++)
+            ok = ok && ((px(x, y) != 0) == ((mask[y] & (0x80 >> x)) > 0));
+    }
+
+    return ok;
+}
+
+static void test_w2812b_shapes() noexcept
+{
+    using Point = decltype(matrix)::Point;
+    constexpr Rgb col{0x10, 0x20, 0x30};
+    constexpr std::array<Point, 3> triangle = {Point{0, 0}, Point{7, 2}, Point{2, 7}};
+    constexpr std::array<Point, 5> concave = {
+        Point{0, 0}, Point{7, 0}, Point{7, 7}, Point{4, 3}, Point{0, 7},
+    };
+
+    bool ok = (matrix.clear() == Err::Ok);
+    ok = ok && (matrix.draw_line(0, 7, 0, 3, col) == Err::Ok);
+    ok = ok && (matrix.draw_line(7, 2, 4, 7, col) == Err::Ok);
+    ok = ok && (matrix.draw_line(0, 8, 0, 3, col) == Err::OutOfRange);
+    ok = ok && matrix_equals({0b11000000, 0b00110000, 0b00001100, 0b00000011,
+        0b00000001, 0b00000110, 0b00011000, 0b00100000});
+
+    ok = ok && (matrix.clear() == Err::Ok);
+    ok = ok && (matrix.draw_circle(4, 4, 3, col) == Err::Ok);
+    ok = ok && (matrix.draw_circle(4, 4, 4, col) == Err::OutOfRange);
+    ok = ok && matrix_equals({0b00000000, 0b00011100, 0b00100010, 0b01000001,
+        0b01000001, 0b01000001, 0b00100010, 0b00011100});
+
+    ok = ok && (matrix.clear() == Err::Ok);
+    ok = ok && (matrix.draw_circle_filled(4, 4, 3, col) == Err::Ok);
+    ok = ok && matrix_equals({0b00000000, 0b00011100, 0b00111110, 0b01111111,
+        0b01111111, 0b01111111, 0b00111110, 0b00011100});
+
+    ok = ok && (matrix.clear() == Err::Ok);
+    ok = ok && (matrix.draw_polygon_filled(std::span{triangle}, col) == Err::Ok);
+    ok = ok && matrix_equals({0b11000000, 0b11111100, 0b01111111, 0b01111110,
+        0b01111100, 0b01111000, 0b00110000, 0b00100000});
+
+    ok = ok && (matrix.clear() == Err::Ok);
+    ok = ok && (matrix.draw_polygon_filled(std::span{concave}, col) == Err::Ok);
+    ok = ok && matrix_equals({0b11111111, 0b11111111, 0b11111111, 0b11111111,
+        0b11110111, 0b11100111, 0b11000011, 0b10000001});
+
+    check(ok, "W2812BMatrix lines, circles and polygons");
+}
+
+int main(void)
+{
+    chip.init();
+
+    uart0.init(chip.cs());
+    spi1.init(chip.cs());
+    spi2.init(chip.cs());
+    ev_timer.init(chip.cs());
+    many_timer.init(chip.cs());
+    i2c0.init(chip.cs(), ev_timer);
+    i2c3.init(chip.cs());
+
+    test_uart();
+    test_spi();
+    test_spi_group();
+    test_i2c();
+    test_i2c_dma();
+    test_profiling();
+    test_i2c_device();
+    test_i2c_scheduler();
+    test_i2c_scan();
+    test_i2c_recovery();
+    test_event_timer();
+    test_event_timer_handoff();
+    test_event_timer_many();
+    test_int_pin();
+    test_button();
+    test_button_group();
+    test_w2812b();
+    test_w2812b_matrix();
+    test_w2812b_blit();
+    test_w2812b_shapes();
+
+    std::printf("\n%s\n", (failed == 0) ? "all tests passed" : "some tests FAILED");
+    return (failed == 0) ? 0 : 1;
+}
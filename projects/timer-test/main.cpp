@@ -22,7 +22,7 @@
 
 Msp432& chip = Msp432::instance();
 Uart uart0{chip.uscia0(), chip.dma(), 115200, 0, 1, 1, 1};
-EventTimer ev_timer{chip.t32_1()};
+StaticEventTimer<> ev_timer{chip.t32_1()};
 
 static void ev_cb(void* cookie) noexcept
 {
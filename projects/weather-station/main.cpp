@@ -11,6 +11,7 @@
 #include "cs.h"
 #include "gpio.h"
 #include "i2c.h"
+#include "i2c_device.h"
 #include "int_pin.h"
 #include "led.h"
 #include "msp432.h"
@@ -18,7 +19,7 @@
 #include "uart.h"
 
 constexpr uint16_t BMS_ADDR = 0x76;
-constexpr std::array<uint8_t, 1> READ_ID = {0xF3};
+constexpr uint8_t BMS_STATUS = 0xF3;
 
 std::array<uint8_t, 12> i2c_buf = {};
 
@@ -26,6 +27,9 @@ Msp432& chip = Msp432::instance();
 Uart uart0{chip.uscia0(), chip.dma(), 115200, 0, 1, 1, 1};
 I2cMaster i2c0{chip.uscib0(), I2cSpeed::KHz100};
 
+void i2c_cb(I2cJobType t, I2cErr err, uint8_t reg, std::span<uint8_t> rxbuf, void *cookie) noexcept;
+I2cDevice<> bms{i2c0, BMS_ADDR, I2cByteOrder::BigEndian, &uart0, i2c_cb};
+
 static void u8_to_hex(uint8_t val, uint8_t *str)
 {
     constexpr char LOOKUP[] = "0123456789ABCDEF";
@@ -34,7 +38,7 @@ static void u8_to_hex(uint8_t val, uint8_t *str)
     str[1] = LOOKUP[val & 0xF];
 }
 
-void i2c_cb(I2cJobType t, I2cErr err, std::span<uint8_t> rxbuf, void *cookie) noexcept
+void i2c_cb(I2cJobType t, I2cErr err, uint8_t reg, std::span<uint8_t> rxbuf, void *cookie) noexcept
 {
     Uart *u = reinterpret_cast<Uart*>(cookie);
     uint8_t hex[128];
@@ -92,7 +96,7 @@ int main(void)
 
     led_blue.on();
     uart0.write("\r\nHallo erstmal!\r\n");
-    i2c0.write_read(BMS_ADDR, std::span{READ_ID}, std::span{i2c_buf}, &uart0, i2c_cb);
+    bms.read_regs(BMS_STATUS, std::span{i2c_buf});
 
     while (true) {
         // uart0.write("loop\r\n");
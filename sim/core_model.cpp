@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include "core_model.h"
+#include "dwt_regs.h"
+#include "nvic_model.h"
+#include "sim.h"
+#include "systick_regs.h"
+
+namespace sim {
+static constexpr uintptr_t STCSR = SYSTICK_BASE + offsetof(SystickRegisters, stcsr);
+static constexpr uintptr_t STRVR = SYSTICK_BASE + offsetof(SystickRegisters, strvr);
+static constexpr uintptr_t STCVR = SYSTICK_BASE + offsetof(SystickRegisters, stcvr);
+static constexpr uintptr_t STCR = SYSTICK_BASE + offsetof(SystickRegisters, stcr);
+static constexpr uintptr_t DWT_CTRL = DWT_BASE + offsetof(DwtRegisters, ctrl);
+static constexpr uintptr_t DWT_CYCCNT = DWT_BASE + offsetof(DwtRegisters, cyccnt);
+
+void CoreModel::reset() noexcept
+{
+    systick_on = false;
+    countflag = false;
+    reload = 0;
+    t_ref = 0;
+    cyc_offset = 0;
+    cancel();
+
+    // the SysTick is clocked by the core clock, there is no reference clock
+    raw<uint32_t>(STCSR) = systickregs::stcsr::clksrc.mask();
+    raw<uint32_t>(STRVR) = 0;
+    raw<uint32_t>(STCVR) = 0;
+    raw<uint32_t>(STCR) = systickregs::stcr::noref.mask();
+    raw<uint32_t>(DWT_CTRL) = 0;
+    raw<uint32_t>(DWT_CYCCNT) = 0;
+}
+
+void CoreModel::write(uintptr_t addr, uint32_t val) noexcept
+{
+    switch (addr) {
+    case STCSR: {
+        bool on = (val & systickregs::stcsr::enable.mask()) > 0;
+
+        if (on && !systick_on) {
+            systick_on = true;
+            systick_restart();
+        } else if (!on && systick_on) {
+            raw<uint32_t>(STCVR) = systick_value();
+            systick_on = false;
+            cancel();
+        }
+        break;
+    }
+    case STCVR:
+        // any write clears the counter and the COUNTFLAG
+        countflag = false;
+        raw<uint32_t>(STCVR) = 0;
+        if (systick_on)
+            systick_restart();
+        break;
+    case DWT_CTRL:
+        if ((val & dwtregs::ctrl::cyccntena.mask()) > 0)
+            cyc_offset = raw<uint32_t>(DWT_CYCCNT) - static_cast<uint32_t>(now());
+        break;
+    case DWT_CYCCNT:
+        cyc_offset = val - static_cast<uint32_t>(now());
+        break;
+    default:
+        break;
+    }
+}
+
+uint32_t CoreModel::read(uintptr_t addr, uint32_t val) noexcept
+{
+    switch (addr) {
+    case STCSR:
+        // COUNTFLAG is cleared by reading it
+        if (countflag)
+            val |= systickregs::stcsr::countflag.mask();
+
+        countflag = false;
+        return val;
+    case STCVR:
+        return systick_on ? systick_value() : val;
+    case DWT_CYCCNT:
+        if ((raw<uint32_t>(DWT_CTRL) & dwtregs::ctrl::cyccntena.mask()) > 0)
+            return static_cast<uint32_t>(now()) + cyc_offset;
+
+        return val;
+    default:
+        return val;
+    }
+}
+
+void CoreModel::event() noexcept
+{
+    // the counter reached 0, it's reloaded with the next clock cycle
+    countflag = true;
+    if ((raw<uint32_t>(STCSR) & systickregs::stcsr::tickint.mask()) > 0)
+        nvic().pend_systick();
+
+    reload = raw<uint32_t>(STRVR) & systickregs::strvr::reload.mask();
+    t_ref = now() + 1;
+
+    // a reload value of 0 stops the counter
+    if (reload > 0)
+        schedule(t_ref + reload);
+}
+
+uint32_t CoreModel::systick_value() const noexcept
+{
+    Cycles t = now();
+
+    if (t < t_ref)
+        return 0;
+
+    if ((t - t_ref) >= reload)
+        return 0;
+
+    return reload - static_cast<uint32_t>(t - t_ref);
+}
+
+void CoreModel::systick_restart() noexcept
+{
+    reload = raw<uint32_t>(STRVR) & systickregs::strvr::reload.mask();
+    t_ref = now() + 1;
+
+    if (reload > 0)
+        schedule(t_ref + reload);
+    else
+        cancel();
+}
+}
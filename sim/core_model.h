@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ *
+ * Model of the SysTick and the cycle counter of the DWT. The SysTick always counts MCLK cycles,
+ * after writing STCVR the counter is reloaded with the next clock cycle.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "sim.h"
+
+namespace sim {
+class CoreModel : public Model {
+public:
+    constexpr explicit CoreModel() noexcept
+        : Model(), systick_on(false), countflag(false), reload(0), t_ref(0), cyc_offset(0) {}
+
+    void reset() noexcept override;
+    void write(uintptr_t addr, uint32_t val) noexcept override;
+    uint32_t read(uintptr_t addr, uint32_t val) noexcept override;
+    void event() noexcept override;
+
+private:
+    uint32_t systick_value() const noexcept;
+    void systick_restart() noexcept;
+
+    bool systick_on;
+    bool countflag;
+    uint32_t reload; // the reload value of the current period
+    Cycles t_ref; // the cycle at which the counter was loaded with 'reload'
+    uint32_t cyc_offset; // CYCCNT - now()
+};
+}
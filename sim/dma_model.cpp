@@ -0,0 +1,324 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ */
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include "dma.h"
+#include "dma_model.h"
+#include "dma_regs.h"
+#include "helpers.h"
+#include "irq_nr.h"
+#include "nvic_model.h"
+#include "sim.h"
+#include "usci_model.h"
+
+namespace sim {
+static constexpr uintptr_t DEVICE_CFG = DMA_BASE + offsetof(DmaRegisters, device_cfg);
+static constexpr uintptr_t SW_CHTRIG = DMA_BASE + offsetof(DmaRegisters, sw_chtrig);
+static constexpr uintptr_t CHX_SRCCFG = DMA_BASE + offsetof(DmaRegisters, chx_srccfg);
+static constexpr uintptr_t INT1_SRCCFG = DMA_BASE + offsetof(DmaRegisters, int1_srccfg);
+static constexpr uintptr_t INT0_SRCFLG = DMA_BASE + offsetof(DmaRegisters, int0_srcflg);
+static constexpr uintptr_t INT0_CLRFLG = DMA_BASE + offsetof(DmaRegisters, int0_clrflg);
+static constexpr uintptr_t STAT = DMA_BASE + offsetof(DmaRegisters, stat);
+static constexpr uintptr_t CFG = DMA_BASE + offsetof(DmaRegisters, cfg);
+static constexpr uintptr_t CTLBASE = DMA_BASE + offsetof(DmaRegisters, ctlbase);
+static constexpr uintptr_t ALTBASE = DMA_BASE + offsetof(DmaRegisters, altbase);
+static constexpr uintptr_t SWREQ = DMA_BASE + offsetof(DmaRegisters, swreq);
+static constexpr uintptr_t ENASET = DMA_BASE + offsetof(DmaRegisters, enaset);
+static constexpr uintptr_t ENACLR = DMA_BASE + offsetof(DmaRegisters, enaclr);
+static constexpr uintptr_t ALTSET = DMA_BASE + offsetof(DmaRegisters, altset);
+static constexpr uintptr_t ALTCLR = DMA_BASE + offsetof(DmaRegisters, altclr);
+
+// the alternate control structures follow the primary ones
+static constexpr uint32_t ALT_OFFSET = DMA_CHANNEL_CNT * sizeof(DmaChannelControl);
+
+static constexpr uint32_t MODE_STOP = 0;
+static constexpr uint32_t MODE_BASIC = 1;
+static constexpr uint32_t MODE_AUTO = 2;
+static constexpr uint32_t MODE_PING_PONG = 3;
+static constexpr uint32_t MODE_MEM_SG = 4;
+static constexpr uint32_t MODE_ALT_MEM_SG = 5;
+static constexpr uint32_t MODE_PERIPH_SG = 6;
+static constexpr uint32_t MODE_ALT_PERIPH_SG = 7;
+
+static constexpr IrqNr INT_IRQS[] = {IrqNr::DmaInt1, IrqNr::DmaInt2, IrqNr::DmaInt3};
+
+static uint32_t field(uint32_t val, const BitField<uint32_t>& f) noexcept
+{
+    return (val & f.mask()) >> std::countr_zero(f.mask());
+}
+
+void DmaModel::reset() noexcept
+{
+    masten = false;
+    enabled = 0;
+    alt = 0;
+    sw_req = 0;
+    auto_run = 0;
+    srcflg = 0;
+    cancel();
+
+    for (uintptr_t off = 0; off < sizeof(DmaRegisters); off += 4)
+        raw<uint32_t>(DMA_BASE + off) = 0;
+
+    raw<uint32_t>(DEVICE_CFG) = dmaregs::device_cfg::num_dma_channels.raw_value(DMA_CHANNEL_CNT)
+        | dmaregs::device_cfg::num_src_per_channel.raw_value(MAX_SRC_NR + 1);
+
+    reset_stats();
+    sync();
+}
+
+void DmaModel::write(uintptr_t addr, uint32_t val) noexcept
+{
+    uint32_t mask = val & (hlp::mask<uint32_t>(DMA_CHANNEL_CNT - 1, 0));
+
+    switch (addr) {
+    case SW_CHTRIG:
+    case SWREQ:
+        sw_req |= mask & enabled;
+        raw<uint32_t>(SW_CHTRIG) = 0;
+        break;
+    case INT0_CLRFLG:
+        srcflg &= ~mask;
+        break;
+    case CFG:
+        masten = (val & dmaregs::cfg::masten.mask()) > 0;
+        break;
+    case CTLBASE:
+        raw<uint32_t>(CTLBASE) = val & dmaregs::ctlbase::addr.mask();
+        break;
+    case ENASET:
+        enabled |= mask;
+        break;
+    case ENACLR:
+        enabled &= ~mask;
+        break;
+    case ALTSET:
+        alt |= mask;
+        break;
+    case ALTCLR:
+        alt &= ~mask;
+        break;
+    default:
+        break;
+    }
+
+    sync();
+    kick();
+}
+
+void DmaModel::event() noexcept
+{
+    for (uint32_t ch = 0; ch < DMA_CHANNEL_CNT; ch++) {
+        if (eligible(ch)) {
+            Cycles cycles = service(ch);
+
+            busy += cycles;
+            sync();
+            schedule(now() + cycles);
+            return;
+        }
+    }
+}
+
+void DmaModel::kick() noexcept
+{
+    if (scheduled() == NEVER)
+        schedule(now() + 1);
+}
+
+void DmaModel::print_stats() const noexcept
+{
+    for (size_t ch = 0; ch < DMA_CHANNEL_CNT; ch++) {
+        if (st[ch].transfers == 0)
+            continue;
+
+        std::printf("DMA ch%zu  transfers: %8llu  bytes: %8llu  done: %llu\n", ch,
+            static_cast<unsigned long long>(st[ch].transfers),
+            static_cast<unsigned long long>(st[ch].bytes),
+            static_cast<unsigned long long>(st[ch].done));
+    }
+
+    if (busy > 0)
+        std::printf("DMA busy: %llu cycles\n", static_cast<unsigned long long>(busy));
+}
+
+void DmaModel::reset_stats() noexcept
+{
+    st = {};
+    busy = 0;
+}
+
+bool DmaModel::requested(uint32_t ch) const noexcept
+{
+    uint32_t src = raw<uint32_t>(CHX_SRCCFG + ch * 4) & dmaregs::ch_srccfg::dma_src.mask();
+    bool tx = (ch % 2) == 0;
+
+    // only the USCI triggers are modelled, see the mapping in dma.h
+    if (src == 1)
+        return uscia(ch / 2).dma_request(tx, 0);
+
+    if ((src >= 2) && (src <= 5))
+        return uscib((ch / 2 + (6 - src) % 4) % 4).dma_request(tx, src - 2);
+
+    return false;
+}
+
+bool DmaModel::eligible(uint32_t ch) const noexcept
+{
+    uint32_t bit = hlp::bit<uint32_t>(ch);
+    uint32_t mode;
+
+    if (!masten || ((enabled & bit) == 0))
+        return false;
+
+    if ((auto_run & bit) || (sw_req & bit) || requested(ch))
+        return true;
+
+    // the primary structure of a peripheral scatter-gather transfer loads the next task without a
+    // request
+    mode = field(raw<uint32_t>(structure(ch) + 8), dmactrl::ctrl::cycle_ctrl);
+    return mode == MODE_PERIPH_SG;
+}
+
+uint32_t DmaModel::structure(uint32_t ch) const noexcept
+{
+    uint32_t addr = raw<uint32_t>(CTLBASE) + static_cast<uint32_t>(ch) * 16;
+
+    if ((alt & hlp::bit<uint32_t>(ch)) > 0)
+        addr += ALT_OFFSET;
+
+    return addr;
+}
+
+Cycles DmaModel::service(uint32_t ch) noexcept
+{
+    uint32_t bit = hlp::bit<uint32_t>(ch);
+    uint32_t base = structure(ch);
+    uint32_t ctrl = raw<uint32_t>(base + 8);
+    uint32_t mode = field(ctrl, dmactrl::ctrl::cycle_ctrl);
+    uint32_t src_end = raw<uint32_t>(base);
+    uint32_t dst_end = raw<uint32_t>(base + 4);
+    uint32_t src_inc = field(ctrl, dmactrl::ctrl::src_inc);
+    uint32_t dst_inc = field(ctrl, dmactrl::ctrl::dst_inc);
+    uint32_t size = hlp::bit<uint32_t>(field(ctrl, dmactrl::ctrl::src_size));
+    uint32_t n = field(ctrl, dmactrl::ctrl::n_minus_1) + 1;
+    uint32_t burst = hlp::bit<uint32_t>(field(ctrl, dmactrl::ctrl::r_power));
+    uint32_t cnt = (burst < n) ? burst : n;
+
+    sw_req &= ~bit;
+
+    // an invalid (or already finished) structure stops the channel
+    if (mode == MODE_STOP) {
+        disable(ch);
+        return ARBITRATION_CYCLES;
+    }
+
+    // the pointers point to the last transfer, the address of the current one is derived from the
+    // number of remaining transfers
+    for (uint32_t i = 0; i < cnt; i++) {
+        uint32_t rem = n - i;
+        uint32_t src = src_end;
+        uint32_t dst = dst_end;
+
+        if (src_inc != 3)
+            src -= (rem - 1) << src_inc;
+
+        // the primary structure of a scatter-gather transfer writes every task to the alternate
+        // structure, thus its destination only advances within a burst
+        if ((mode == MODE_MEM_SG) || (mode == MODE_PERIPH_SG))
+            dst -= (cnt - 1 - i) << dst_inc;
+        else if (dst_inc != 3)
+            dst -= (rem - 1) << dst_inc;
+
+        poke(dst, peek(src, size), size);
+    }
+
+    st[ch].transfers += cnt;
+    st[ch].bytes += cnt * size;
+    n -= cnt;
+
+    if ((mode == MODE_AUTO) || (mode == MODE_MEM_SG) || (mode == MODE_ALT_MEM_SG))
+        auto_run |= bit;
+
+    if (n > 0) {
+        ctrl = (ctrl & ~dmactrl::ctrl::n_minus_1.mask())
+            | dmactrl::ctrl::n_minus_1.raw_value(n - 1);
+        raw<uint32_t>(base + 8) = ctrl;
+
+        // the primary structure of a scatter-gather transfer copies one task per arbitration and
+        // switches over to the alternate structure which executes it
+        if ((mode == MODE_MEM_SG) || (mode == MODE_PERIPH_SG))
+            alt |= bit;
+    } else {
+        raw<uint32_t>(base + 8) = ctrl & ~(dmactrl::ctrl::n_minus_1.mask()
+            | dmactrl::ctrl::cycle_ctrl.mask());
+
+        switch (mode) {
+        case MODE_BASIC:
+        case MODE_AUTO:
+            done(ch);
+            disable(ch);
+            break;
+        case MODE_PING_PONG:
+            done(ch);
+            alt ^= bit;
+            break;
+        case MODE_MEM_SG:
+        case MODE_PERIPH_SG:
+            alt |= bit;
+            break;
+        case MODE_ALT_MEM_SG:
+        case MODE_ALT_PERIPH_SG:
+            alt &= ~bit;
+            break;
+        default:
+            break;
+        }
+    }
+
+    return ARBITRATION_CYCLES + cnt * TRANSFER_CYCLES;
+}
+
+void DmaModel::done(uint32_t ch) noexcept
+{
+    st[ch].done++;
+
+    // a channel which is routed to one of the interrupts INT1 to INT3 doesn't set its flag
+    for (size_t i = 0; i < 3; i++) {
+        uint32_t cfg = raw<uint32_t>(INT1_SRCCFG + i * 4);
+
+        if (((cfg & dmaregs::intx_srccfg::en.mask()) > 0)
+            && ((cfg & dmaregs::intx_srccfg::int_src.mask()) == ch)) {
+            nvic().pend(INT_IRQS[i]);
+            return;
+        }
+    }
+
+    srcflg |= hlp::bit<uint32_t>(ch);
+}
+
+void DmaModel::disable(uint32_t ch) noexcept
+{
+    enabled &= ~(hlp::bit<uint32_t>(ch));
+    auto_run &= ~(hlp::bit<uint32_t>(ch));
+}
+
+void DmaModel::sync() noexcept
+{
+    raw<uint32_t>(INT0_SRCFLG) = srcflg;
+    raw<uint32_t>(STAT) = (masten ? dmaregs::stat::masten.mask() : 0)
+        | dmaregs::stat::dmachans.raw_value(DMA_CHANNEL_CNT - 1);
+    raw<uint32_t>(ALTBASE) = raw<uint32_t>(CTLBASE) + ALT_OFFSET;
+    raw<uint32_t>(ENASET) = enabled;
+    raw<uint32_t>(ALTSET) = alt;
+    nvic().set_line(IrqNr::DmaInt0, srcflg != 0);
+}
+}
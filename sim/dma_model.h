@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ *
+ * Model of the µDMA controller. The control structures are read from (and written back to) the
+ * memory configured by CTLBASE, the channels are triggered by the level of the TXIFGn / RXIFGn
+ * flags of the USCI modules according to the source mapping of chx_srccfg (see periph/dma/dma.h),
+ * by SW_CHTRIG / SWREQ or automatically (auto-request and memory scatter-gather).
+ *
+ * The modes basic, auto-request, ping-pong and both scatter-gather modes are supported. After
+ * every arbitration the channel with the lowest number which has a pending request is served (the
+ * priorities are ignored), 2^R transfers take TRANSFER_CYCLES each. The timer- and AES-triggers
+ * and the bus errors are not modelled.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "dma_regs.h"
+#include "sim.h"
+
+namespace sim {
+struct DmaStats {
+    uint64_t transfers;
+    uint64_t bytes;
+    uint64_t done;
+};
+
+class DmaModel : public Model {
+public:
+    static constexpr Cycles ARBITRATION_CYCLES = 3;
+    static constexpr Cycles TRANSFER_CYCLES = 4;
+
+    constexpr explicit DmaModel() noexcept
+        : Model(), masten(false), enabled(0), alt(0), sw_req(0), auto_run(0), srcflg(0), busy(0),
+        st() {}
+
+    void reset() noexcept override;
+    void write(uintptr_t addr, uint32_t val) noexcept override;
+    void event() noexcept override;
+
+    // invoked by the peripherals whenever one of their DMA triggers was raised
+    void kick() noexcept;
+
+    const DmaStats& stats(size_t ch) const noexcept { return st[ch]; }
+    void print_stats() const noexcept;
+    void reset_stats() noexcept;
+
+private:
+    bool requested(uint32_t ch) const noexcept;
+    bool eligible(uint32_t ch) const noexcept;
+    uint32_t structure(uint32_t ch) const noexcept;
+    Cycles service(uint32_t ch) noexcept;
+    void done(uint32_t ch) noexcept;
+    void disable(uint32_t ch) noexcept;
+    void sync() noexcept;
+
+    bool masten;
+    uint32_t enabled;
+    uint32_t alt;
+    uint32_t sw_req;
+    uint32_t auto_run; // the channel continues without a further request
+    uint32_t srcflg;
+    Cycles busy;
+    std::array<DmaStats, DMA_CHANNEL_CNT> st;
+};
+}
@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ */
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include "gpio.h"
+#include "gpio_model.h"
+#include "gpio_regs.h"
+#include "helpers.h"
+#include "irq_nr.h"
+#include "nvic_model.h"
+#include "sim.h"
+
+namespace sim {
+static constexpr size_t PINS_PER_PORT = 8;
+static constexpr size_t PORTJ = 10;
+
+// the ports share their register blocks pairwise, the odd ports use the low bytes
+static uintptr_t reg_addr(size_t port, size_t offset) noexcept
+{
+    if (port == PORTJ)
+        return GPIO_BASES[5] + offset;
+
+    return GPIO_BASES[port / 2] + offset + port % 2;
+}
+
+static size_t port_of(uintptr_t addr) noexcept
+{
+    uintptr_t off = addr - GPIO_BASES[0];
+
+    if (addr >= GPIO_BASES[5])
+        return PORTJ;
+
+    return (off / sizeof(GpioRegisters)) * 2 + off % 2;
+}
+
+static constexpr size_t port_nr(IntPinNr nr) noexcept
+{
+    return static_cast<size_t>(nr) / PINS_PER_PORT;
+}
+
+static constexpr size_t port_nr(PinNr nr) noexcept
+{
+    return static_cast<size_t>(nr) / PINS_PER_PORT + GpioPins::INT_PORT_CNT;
+}
+
+static constexpr uint8_t pin_mask(size_t nr) noexcept
+{
+    return hlp::bit<uint8_t>(static_cast<uint8_t>(nr % PINS_PER_PORT));
+}
+
+void GpioModel::reset() noexcept
+{
+    driven.fill(0);
+    ext.fill(0);
+
+    for (uintptr_t addr = GPIO_BASES[0]; addr < (GPIO_BASES[5] + sizeof(GpioRegisters)); addr++)
+        raw<uint8_t>(addr) = 0;
+
+    for (size_t port = 0; port < GpioPins::INT_PORT_CNT; port++)
+        nvic().set_line(static_cast<IrqNr>(irq_idx(IrqNr::Port1) + port), false);
+
+    reset_stats();
+}
+
+void GpioModel::write(uintptr_t addr, uint32_t val) noexcept
+{
+    // every register may change the level (DIR, OUT, REN) or the interrupt line (IE, IFG)
+    update(port_of(addr));
+}
+
+void GpioModel::drive(IntPinNr nr, bool level) noexcept
+{
+    set_driven(port_nr(nr), static_cast<size_t>(nr) % PINS_PER_PORT, true, level);
+}
+
+void GpioModel::drive(PinNr nr, bool level) noexcept
+{
+    set_driven(port_nr(nr), static_cast<size_t>(nr) % PINS_PER_PORT, true, level);
+}
+
+void GpioModel::release(IntPinNr nr) noexcept
+{
+    set_driven(port_nr(nr), static_cast<size_t>(nr) % PINS_PER_PORT, false, false);
+}
+
+void GpioModel::release(PinNr nr) noexcept
+{
+    set_driven(port_nr(nr), static_cast<size_t>(nr) % PINS_PER_PORT, false, false);
+}
+
+bool GpioModel::level(IntPinNr nr) const noexcept
+{
+    uint8_t in = raw<uint8_t>(reg_addr(port_nr(nr), offsetof(GpioRegisters, in)));
+    return (in & pin_mask(static_cast<size_t>(nr))) > 0;
+}
+
+bool GpioModel::level(PinNr nr) const noexcept
+{
+    uint8_t in = raw<uint8_t>(reg_addr(port_nr(nr), offsetof(GpioRegisters, in)));
+    return (in & pin_mask(static_cast<size_t>(nr))) > 0;
+}
+
+void GpioModel::set_driven(size_t port, size_t pin, bool drive, bool level) noexcept
+{
+    uint8_t bit = pin_mask(pin);
+
+    driven[port] = static_cast<uint8_t>(drive ? (driven[port] | bit) : (driven[port] & ~bit));
+    ext[port] = static_cast<uint8_t>(level ? (ext[port] | bit) : (ext[port] & ~bit));
+    update(port);
+}
+
+void GpioModel::update(size_t port) noexcept
+{
+    uint8_t dir = raw<uint8_t>(reg_addr(port, offsetof(GpioRegisters, dir)));
+    uint8_t out = raw<uint8_t>(reg_addr(port, offsetof(GpioRegisters, out)));
+    uint8_t ren = raw<uint8_t>(reg_addr(port, offsetof(GpioRegisters, ren)));
+    uint8_t prev = raw<uint8_t>(reg_addr(port, offsetof(GpioRegisters, in)));
+    uint8_t in = prev;
+    uint8_t ies;
+    uint8_t ie;
+    uint8_t ifg;
+    uint8_t set;
+
+    // outputs > external drivers > pull resistors > floating (keeps the previous level)
+    in = static_cast<uint8_t>((in & ~ren) | (out & ren));
+    in = static_cast<uint8_t>((in & ~driven[port]) | (ext[port] & driven[port]));
+    in = static_cast<uint8_t>((in & ~dir) | (out & dir));
+    raw<uint8_t>(reg_addr(port, offsetof(GpioRegisters, in))) = in;
+
+    if (port >= GpioPins::INT_PORT_CNT)
+        return;
+
+    // PxIES selects the falling edge for a set bit and the rising edge otherwise
+    ies = raw<uint8_t>(reg_addr(port, offsetof(GpioRegisters, ies)));
+    ie = raw<uint8_t>(reg_addr(port, offsetof(GpioRegisters, ie)));
+    set = static_cast<uint8_t>((~prev & in & ~ies) | (prev & ~in & ies));
+    ifg = static_cast<uint8_t>(raw<uint8_t>(reg_addr(port, offsetof(GpioRegisters, ifg))) | set);
+
+    raw<uint8_t>(reg_addr(port, offsetof(GpioRegisters, ifg))) = ifg;
+    edges += static_cast<uint64_t>(std::popcount(set));
+    nvic().set_line(static_cast<IrqNr>(irq_idx(IrqNr::Port1) + port), (ifg & ie) != 0);
+}
+}
@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ *
+ * Model of the digital I/O ports P1 to P10 and PJ. The level of an input pin is set by drive(), an
+ * input pin which isn't driven follows its pull resistor (or keeps its level if it has none). The
+ * ports P1 to P6 set their interrupt flags on the configured edge of PxIN, the interrupt vector
+ * registers PxIV are not modelled.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "gpio.h"
+#include "sim.h"
+
+namespace sim {
+class GpioModel : public Model {
+public:
+    // P1 to P10 and PJ
+    static constexpr size_t PORT_CNT = 11;
+
+    constexpr explicit GpioModel() noexcept
+        : Model(), driven(), ext(), edges(0) {}
+
+    void reset() noexcept override;
+    void write(uintptr_t addr, uint32_t val) noexcept override;
+
+    // drives the level of an external signal on the pin
+    void drive(IntPinNr nr, bool level) noexcept;
+    void drive(PinNr nr, bool level) noexcept;
+
+    // stops driving the pin, it follows its pull resistor afterwards
+    void release(IntPinNr nr) noexcept;
+    void release(PinNr nr) noexcept;
+
+    // the level of the pin, as it can be observed from outside (including the outputs)
+    bool level(IntPinNr nr) const noexcept;
+    bool level(PinNr nr) const noexcept;
+
+    // number of edges which set an interrupt flag since the last reset of the statistics
+    uint64_t detected_edges() const noexcept { return edges; }
+    void reset_stats() noexcept { edges = 0; }
+
+private:
+    void set_driven(size_t port, size_t pin, bool drive, bool level) noexcept;
+    void update(size_t port) noexcept;
+
+    std::array<uint8_t, PORT_CNT> driven;
+    std::array<uint8_t, PORT_CNT> ext;
+    uint64_t edges;
+};
+}
@@ -0,0 +1,280 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ */
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include "irq_nr.h"
+#include "irq_vector.h"
+#include "nvic_model.h"
+#include "nvic_regs.h"
+#include "scb/scb_regs.h"
+#include "sim.h"
+
+namespace sim {
+static void unhandled_interrupt(void) noexcept
+{
+    fault("unhandled interrupt");
+}
+
+static constexpr std::array<void(*)(void), IRQ_CNT> IRQ_VECTOR =
+    make_irq_vector(unhandled_interrupt);
+
+static constexpr uintptr_t ICSR_ADDR = SCB_BASE + offsetof(ScbRegisters, icsr);
+
+// offsets of the register arrays within the NVIC
+static constexpr uintptr_t ISER = offsetof(NvicRegisters, iser);
+static constexpr uintptr_t ICER = offsetof(NvicRegisters, icer);
+static constexpr uintptr_t ISPR = offsetof(NvicRegisters, ispr);
+static constexpr uintptr_t ICPR = offsetof(NvicRegisters, icpr);
+static constexpr uintptr_t IABR = offsetof(NvicRegisters, iabr);
+
+static const char* irq_name(size_t idx) noexcept
+{
+    if (idx == NvicModel::SYSTICK_IDX)
+        return "SysTick";
+
+    switch (static_cast<IrqNr>(idx)) {
+    case IrqNr::EusciA0: return "eUSCI_A0";
+    case IrqNr::EusciA1: return "eUSCI_A1";
+    case IrqNr::EusciA2: return "eUSCI_A2";
+    case IrqNr::EusciA3: return "eUSCI_A3";
+    case IrqNr::EusciB0: return "eUSCI_B0";
+    case IrqNr::EusciB1: return "eUSCI_B1";
+    case IrqNr::EusciB2: return "eUSCI_B2";
+    case IrqNr::EusciB3: return "eUSCI_B3";
+    case IrqNr::T32Int1: return "T32_INT1";
+    case IrqNr::T32Int2: return "T32_INT2";
+    case IrqNr::DmaErr: return "DMA_ERR";
+    case IrqNr::DmaInt0: return "DMA_INT0";
+    case IrqNr::DmaInt1: return "DMA_INT1";
+    case IrqNr::DmaInt2: return "DMA_INT2";
+    case IrqNr::DmaInt3: return "DMA_INT3";
+    case IrqNr::Port1: return "PORT1";
+    case IrqNr::Port2: return "PORT2";
+    case IrqNr::Port3: return "PORT3";
+    case IrqNr::Port4: return "PORT4";
+    case IrqNr::Port5: return "PORT5";
+    case IrqNr::Port6: return "PORT6";
+    default: return "IRQ";
+    }
+}
+
+void NvicModel::reset() noexcept
+{
+    enabled = 0;
+    pending = 0;
+    lines = 0;
+    active = 0;
+    systick_pending = false;
+    primask = 1;
+    in_handler = false;
+    reset_stats();
+    sync();
+}
+
+void NvicModel::write(uintptr_t addr, uint32_t val) noexcept
+{
+    if (addr == ICSR_ADDR) {
+        if ((val & scbregs::icsr::pendstset.mask()) > 0)
+            pend_systick();
+        else if ((val & scbregs::icsr::pendstclr.mask()) > 0)
+            systick_pending = false;
+
+        sync();
+        return;
+    }
+
+    uintptr_t off = addr - NVIC_BASE;
+    uintptr_t reg = off & ~static_cast<uintptr_t>(0x7F);
+    size_t word = (off & 0x7F) >> 2;
+    uint64_t bits;
+
+    if (word > 1) {
+        sync();
+        return;
+    }
+
+    bits = static_cast<uint64_t>(val) << (32 * word);
+    if (reg == ISER) {
+        enabled |= bits;
+    } else if (reg == ICER) {
+        enabled &= ~bits;
+    } else if (reg == ISPR) {
+        for (uint64_t b = bits; b != 0; b &= b - 1)
+            set_pending(static_cast<size_t>(std::countr_zero(b)));
+    } else if (reg == ICPR) {
+        // a level-sensitive interrupt becomes pending again if its line is still asserted
+        pending &= ~bits | lines;
+    }
+
+    sync();
+}
+
+uint32_t NvicModel::read(uintptr_t addr, uint32_t val) noexcept
+{
+    // the register memory is always kept in sync with the state
+    return val;
+}
+
+void NvicModel::set_line(IrqNr nr, bool level) noexcept
+{
+    uint64_t bit = static_cast<uint64_t>(1) << irq_idx(nr);
+
+    if (level && ((lines & bit) == 0))
+        set_pending(irq_idx(nr));
+
+    lines = level ? (lines | bit) : (lines & ~bit);
+    sync();
+}
+
+void NvicModel::pend(IrqNr nr) noexcept
+{
+    set_pending(irq_idx(nr));
+    sync();
+}
+
+void NvicModel::pend_systick() noexcept
+{
+    if (!systick_pending) {
+        systick_pending = true;
+        since[SYSTICK_IDX] = now();
+    }
+
+    sync();
+}
+
+bool NvicModel::is_pending() const noexcept
+{
+    return systick_pending || ((pending & enabled) != 0);
+}
+
+void NvicModel::dispatch() noexcept
+{
+    // all interrupts have the same priority, thus a running handler is never preempted
+    if (in_handler)
+        return;
+
+    while (primask == 0) {
+        if (systick_pending) {
+            systick_pending = false;
+            sync();
+            enter(SYSTICK_IDX, systick_handler);
+            continue;
+        }
+
+        uint64_t irqs = pending & enabled;
+        if (irqs == 0)
+            break;
+
+        size_t idx = static_cast<size_t>(std::countr_zero(irqs));
+        uint64_t bit = static_cast<uint64_t>(1) << idx;
+
+        pending &= ~bit;
+        active |= bit;
+        sync();
+
+        enter(idx, IRQ_VECTOR[idx]);
+
+        active &= ~bit;
+        if ((lines & bit) > 0)
+            set_pending(idx);
+        sync();
+    }
+}
+
+uint32_t NvicModel::set_primask(uint32_t val) noexcept
+{
+    uint32_t prev = primask;
+
+    primask = val & 0x01;
+    if (primask == 0)
+        dispatch();
+
+    return prev;
+}
+
+void NvicModel::print_stats() const noexcept
+{
+    std::printf("interrupt   count      latency avg/max [cyc]   duration avg/max [cyc]\n");
+    for (size_t i = 0; i < stats.size(); i++) {
+        const IrqStats& s = stats[i];
+
+        if (s.count == 0)
+            continue;
+
+        std::printf("%-8s %2zu %8llu %12llu/%-10llu %12llu/%llu\n", irq_name(i), i,
+            static_cast<unsigned long long>(s.count),
+            static_cast<unsigned long long>(s.latency_sum / s.count),
+            static_cast<unsigned long long>(s.latency_max),
+            static_cast<unsigned long long>(s.duration_sum / s.count),
+            static_cast<unsigned long long>(s.duration_max));
+    }
+}
+
+void NvicModel::reset_stats() noexcept
+{
+    stats.fill(IrqStats{});
+    taken = 0;
+}
+
+void NvicModel::set_pending(size_t idx) noexcept
+{
+    uint64_t bit = static_cast<uint64_t>(1) << idx;
+
+    if ((pending & bit) == 0) {
+        pending |= bit;
+        since[idx] = now();
+    }
+}
+
+void NvicModel::sync() noexcept
+{
+    for (size_t i = 0; i < 2; i++) {
+        uint32_t en = static_cast<uint32_t>(enabled >> (32 * i));
+        uint32_t pend = static_cast<uint32_t>(pending >> (32 * i));
+
+        raw<uint32_t>(NVIC_BASE + ISER + 4 * i) = en;
+        raw<uint32_t>(NVIC_BASE + ICER + 4 * i) = en;
+        raw<uint32_t>(NVIC_BASE + ISPR + 4 * i) = pend;
+        raw<uint32_t>(NVIC_BASE + ICPR + 4 * i) = pend;
+        raw<uint32_t>(NVIC_BASE + IABR + 4 * i) = static_cast<uint32_t>(active >> (32 * i));
+    }
+
+    raw<uint32_t>(ICSR_ADDR) = systick_pending ? scbregs::icsr::pendstset.mask() : 0;
+}
+
+void NvicModel::enter(size_t idx, void (*handler)(void)) noexcept
+{
+    IrqStats& s = stats[idx];
+    Cycles pended = since[idx]; // the interrupt can become pending again within its handler
+    Cycles start;
+    Cycles latency;
+    Cycles duration;
+
+    in_handler = true;
+
+    // stacking of the registers, the handler starts afterwards
+    advance(ENTRY_CYCLES);
+    start = now();
+    handler();
+    duration = now() - start;
+    advance(EXIT_CYCLES);
+
+    in_handler = false;
+
+    latency = start - pended;
+    s.count++;
+    s.latency_sum += latency;
+    s.latency_max = (latency > s.latency_max) ? latency : s.latency_max;
+    s.duration_sum += duration;
+    s.duration_max = (duration > s.duration_max) ? duration : s.duration_max;
+    taken++;
+}
+}
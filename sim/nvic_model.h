@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ *
+ * Model of the NVIC and the interrupt related part of the SCB (ICSR). The peripheral models drive
+ * level-sensitive interrupt lines, an interrupt stays pending as long as its line is asserted and
+ * becomes pending again after its handler returned if the line is still asserted.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "irq_nr.h"
+#include "sim.h"
+
+namespace sim {
+struct IrqStats {
+    uint64_t count;
+    Cycles latency_sum; // cycles from becoming pending until entering the handler
+    Cycles latency_max;
+    Cycles duration_sum; // cycles spent within the handler
+    Cycles duration_max;
+};
+
+class NvicModel : public Model {
+public:
+    // cycles of the exception entry and exit of the Cortex-M4F
+    static constexpr Cycles ENTRY_CYCLES = 12;
+    static constexpr Cycles EXIT_CYCLES = 10;
+
+    // index of the SysTick within the statistics
+    static constexpr size_t SYSTICK_IDX = IRQ_CNT;
+
+    constexpr explicit NvicModel() noexcept
+        : Model(), enabled(0), pending(0), lines(0), active(0), systick_pending(false), primask(1),
+        in_handler(false), taken(0), since(), stats() {}
+
+    void reset() noexcept override;
+    void write(uintptr_t addr, uint32_t val) noexcept override;
+    uint32_t read(uintptr_t addr, uint32_t val) noexcept override;
+
+    // level of the interrupt line of a peripheral
+    void set_line(IrqNr nr, bool level) noexcept;
+
+    // pulse on the interrupt line of a peripheral
+    void pend(IrqNr nr) noexcept;
+    void pend_systick() noexcept;
+
+    // true if an enabled interrupt is pending, independent of PRIMASK (used by WFI)
+    bool is_pending() const noexcept;
+
+    // true if the interrupt is pending or its line is asserted
+    bool is_pending(size_t idx) const noexcept { return (((pending | lines) >> idx) & 1) != 0; }
+
+    // enters the handlers of all pending interrupts if PRIMASK and the current context allow it
+    void dispatch() noexcept;
+
+    uint32_t set_primask(uint32_t val) noexcept;
+
+    const IrqStats& irq_stats(size_t idx) const noexcept { return stats[idx]; }
+    uint64_t handled() const noexcept { return taken; }
+    void print_stats() const noexcept;
+    void reset_stats() noexcept;
+
+private:
+    void set_pending(size_t idx) noexcept;
+    void sync() noexcept;
+    void enter(size_t idx, void (*handler)(void)) noexcept;
+
+    uint64_t enabled;
+    uint64_t pending;
+    uint64_t lines;
+    uint64_t active;
+    bool systick_pending;
+    uint32_t primask;
+    bool in_handler;
+    uint64_t taken;
+    std::array<Cycles, IRQ_CNT + 1> since;
+    std::array<IrqStats, IRQ_CNT + 1> stats;
+};
+}
@@ -0,0 +1,488 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ */
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/mman.h>
+
+#include "core_model.h"
+#include "dma_model.h"
+#include "dma_regs.h"
+#include "dwt_regs.h"
+#include "gpio_model.h"
+#include "gpio_regs.h"
+#include "helpers.h"
+#include "nvic_model.h"
+#include "nvic_regs.h"
+#include "scb/scb_regs.h"
+#include "sim.h"
+#include "systick_regs.h"
+#include "timer32_model.h"
+#include "timer32_regs.h"
+#include "usci_model.h"
+#include "uscia_regs.h"
+#include "uscib_regs.h"
+
+namespace sim {
+// the address ranges which are backed by host memory
+struct Window {
+    uintptr_t base;
+    size_t size;
+};
+
+// a register block which is handled by a model
+struct Region {
+    uintptr_t base;
+    size_t size;
+    Model* model;
+};
+
+struct Stats {
+    Cycles start;
+    uint64_t bus_accesses;
+};
+
+static constexpr std::array<Window, 2> WINDOWS = {{
+    {0x40000000, 0x20000},  // peripherals
+    {0xE0000000, 0x50000},  // private peripheral bus
+}};
+
+// every bit of the peripheral window is aliased by a word within the bit-band region
+static constexpr Window PERIPH_BITBAND = {0x42000000, 0x20000 * 32};
+
+static constinit NvicModel nvic_model{};
+static constinit CoreModel core_model{};
+static constinit DmaModel dma_model{};
+static constinit GpioModel gpio_model{};
+static constinit std::array<Timer32Model, 2> t32_models = {{
+    Timer32Model{TIMER32_1_BASE, IrqNr::T32Int1},
+    Timer32Model{TIMER32_2_BASE, IrqNr::T32Int2},
+}};
+static constinit std::array<UsciModel, 4> uscia_models = {{
+    UsciModel{USCIA0_BASE, IrqNr::EusciA0, false},
+    UsciModel{USCIA1_BASE, IrqNr::EusciA1, false},
+    UsciModel{USCIA2_BASE, IrqNr::EusciA2, false},
+    UsciModel{USCIA3_BASE, IrqNr::EusciA3, false},
+}};
+static constinit std::array<UsciModel, 4> uscib_models = {{
+    UsciModel{USCIB0_BASE, IrqNr::EusciB0, true},
+    UsciModel{USCIB1_BASE, IrqNr::EusciB1, true},
+    UsciModel{USCIB2_BASE, IrqNr::EusciB2, true},
+    UsciModel{USCIB3_BASE, IrqNr::EusciB3, true},
+}};
+
+// the NVIC comes first, the other models drive its interrupt lines when they are reset
+static constinit std::array<Model*, 14> models = {{
+    &nvic_model, &core_model, &dma_model, &gpio_model, &t32_models[0], &t32_models[1],
+    &uscia_models[0], &uscia_models[1], &uscia_models[2], &uscia_models[3],
+    &uscib_models[0], &uscib_models[1], &uscib_models[2], &uscib_models[3],
+}};
+
+static constinit std::array<Region, 16> regions = {{
+    {NVIC_BASE, sizeof(NvicRegisters), &nvic_model},
+    {SCB_BASE + offsetof(ScbRegisters, icsr), sizeof(uint32_t), &nvic_model},
+    {SYSTICK_BASE, sizeof(SystickRegisters), &core_model},
+    {DWT_BASE, sizeof(DwtRegisters), &core_model},
+    {DMA_BASE, sizeof(DmaRegisters), &dma_model},
+    {GPIO_BASES[0], GPIO_BASES[5] + sizeof(GpioRegisters) - GPIO_BASES[0], &gpio_model},
+    {TIMER32_1_BASE, sizeof(Timer32Registers), &t32_models[0]},
+    {TIMER32_2_BASE, sizeof(Timer32Registers), &t32_models[1]},
+    {USCIA0_BASE, sizeof(UsciARegisters), &uscia_models[0]},
+    {USCIA1_BASE, sizeof(UsciARegisters), &uscia_models[1]},
+    {USCIA2_BASE, sizeof(UsciARegisters), &uscia_models[2]},
+    {USCIA3_BASE, sizeof(UsciARegisters), &uscia_models[3]},
+    {USCIB0_BASE, sizeof(UsciBRegisters), &uscib_models[0]},
+    {USCIB1_BASE, sizeof(UsciBRegisters), &uscib_models[1]},
+    {USCIB2_BASE, sizeof(UsciBRegisters), &uscib_models[2]},
+    {USCIB3_BASE, sizeof(UsciBRegisters), &uscib_models[3]},
+}};
+
+static constinit Cycles cycle = 0;
+static constinit Clocks clk = DEFAULT_CLOCKS;
+static constinit Stats stats{};
+static constinit uint32_t fpscr_reg = 0;
+
+// The register memory has to exist before any driver is used, thus it's mapped before the
+// constructors of the application run.
+__attribute__((constructor(101))) static void map_registers() noexcept
+{
+    for (const Window& w : WINDOWS) {
+        void* mem = mmap(reinterpret_cast<void*>(w.base), w.size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+        if (mem != reinterpret_cast<void*>(w.base)) {
+            std::fprintf(stderr, "sim: mapping 0x%08zx failed: %s\n", w.base, std::strerror(errno));
+            std::abort();
+        }
+    }
+
+    for (Model* m : models)
+        m->reset();
+}
+
+static bool in_window(uintptr_t addr, size_t size) noexcept
+{
+    for (const Window& w : WINDOWS) {
+        if ((addr >= w.base) && ((addr + size) <= (w.base + w.size)))
+            return true;
+    }
+
+    return false;
+}
+
+static Model* find_model(uintptr_t addr) noexcept
+{
+    for (const Region& r : regions) {
+        if ((addr >= r.base) && (addr < (r.base + r.size)))
+            return r.model;
+    }
+
+    return nullptr;
+}
+
+static Model* next_event() noexcept
+{
+    Model* next = nullptr;
+
+    for (Model* m : models) {
+        if ((m->scheduled() != NEVER) && ((next == nullptr) || (m->scheduled() < next->scheduled())))
+            next = m;
+    }
+
+    return next;
+}
+
+static void store(uintptr_t addr, uint32_t val, size_t size) noexcept
+{
+    if (size == 1)
+        raw<uint8_t>(addr) = static_cast<uint8_t>(val);
+    else if (size == 2)
+        raw<uint16_t>(addr) = static_cast<uint16_t>(val);
+    else
+        raw<uint32_t>(addr) = val;
+}
+
+static uint32_t load(uintptr_t addr, size_t size) noexcept
+{
+    if (size == 1)
+        return raw<uint8_t>(addr);
+    else if (size == 2)
+        return raw<uint16_t>(addr);
+
+    return raw<uint32_t>(addr);
+}
+
+// Translates an address within the bit-band region to the address of the byte containing the bit
+// and the mask of the bit. Returns false if the address isn't part of the bit-band region.
+static bool bitband_target(uintptr_t& addr, uint8_t& bit) noexcept
+{
+    uintptr_t off = addr - PERIPH_BITBAND.base;
+
+    if ((addr < PERIPH_BITBAND.base) || (off >= PERIPH_BITBAND.size))
+        return false;
+
+    addr = WINDOWS[0].base + off / 32;
+    bit = hlp::bit<uint8_t>(static_cast<uint8_t>((off % 32) / 4));
+    return true;
+}
+
+// the CPU accesses registers only through the register classes (core/register.h)
+static void check_access(uintptr_t addr, size_t size) noexcept
+{
+    if (!in_window(addr, size))
+        fault("register access outside of the peripheral address space");
+}
+
+void bus_write(volatile void* addr, uint32_t val, size_t size) noexcept
+{
+    uintptr_t a = reinterpret_cast<uintptr_t>(addr);
+    uint8_t bit;
+    Model* m;
+
+    // the bus performs a read-modify-write of the byte containing the bit
+    if (bitband_target(a, bit)) {
+        val = ((val & 1) > 0) ? (load(a, 1) | bit) : (load(a, 1) & ~static_cast<uint32_t>(bit));
+        size = 1;
+    }
+
+    check_access(a, size);
+    advance(ACCESS_CYCLES);
+    stats.bus_accesses++;
+
+    store(a, val, size);
+    m = find_model(a);
+    if (m)
+        m->write(a, val);
+
+    nvic_model.dispatch();
+}
+
+uint32_t bus_read(const volatile void* addr, size_t size) noexcept
+{
+    uintptr_t a = reinterpret_cast<uintptr_t>(addr);
+    bool bitband;
+    uint8_t bit = 0;
+    uint32_t val;
+    Model* m;
+
+    bitband = bitband_target(a, bit);
+    if (bitband)
+        size = 1;
+
+    check_access(a, size);
+    advance(ACCESS_CYCLES);
+    stats.bus_accesses++;
+
+    val = load(a, size);
+    m = find_model(a);
+    if (m)
+        val = m->read(a, val);
+
+    if (bitband)
+        val = static_cast<uint32_t>((val & bit) > 0);
+
+    nvic_model.dispatch();
+    return val;
+}
+
+void poke(uint32_t addr, uint32_t val, size_t size) noexcept
+{
+    Model* m;
+
+    store(addr, val, size);
+    if (!in_window(addr, size))
+        return;
+
+    m = find_model(addr);
+    if (m)
+        m->write(addr, val);
+}
+
+uint32_t peek(uint32_t addr, size_t size) noexcept
+{
+    uint32_t val = load(addr, size);
+    Model* m;
+
+    if (!in_window(addr, size))
+        return val;
+
+    m = find_model(addr);
+    if (m)
+        val = m->read(addr, val);
+
+    return val;
+}
+
+void Model::schedule(Cycles time) noexcept
+{
+    at = time;
+}
+
+Cycles now() noexcept
+{
+    return cycle;
+}
+
+void advance(Cycles cycles) noexcept
+{
+    Cycles target = cycle + cycles;
+
+    // The handlers invoked by the events advance the time on their own, thus the time can be
+    // beyond the target afterwards. Events which are due by then are still handled.
+    while (true) {
+        Model* next = next_event();
+        Cycles limit = (target > cycle) ? target : cycle;
+
+        if ((next == nullptr) || (next->at > limit))
+            break;
+
+        if (next->at > cycle)
+            cycle = next->at;
+
+        next->at = NEVER;
+        next->event();
+        nvic_model.dispatch();
+    }
+
+    if (target > cycle)
+        cycle = target;
+}
+
+const Clocks& clocks() noexcept
+{
+    return clk;
+}
+
+void set_clocks(const Clocks& c) noexcept
+{
+    clk = c;
+}
+
+Cycles to_cycles(uint64_t ticks, uint32_t freq_hz) noexcept
+{
+    return (ticks * clk.mclk + freq_hz - 1) / freq_hz;
+}
+
+void run(Cycles cycles) noexcept
+{
+    nvic_model.dispatch();
+    advance(cycles);
+}
+
+bool run_until(bool (*cond)(void* ctx), void* ctx, Cycles timeout) noexcept
+{
+    Cycles end = cycle + timeout;
+    bool ret = true;
+
+    nvic_model.dispatch();
+    while (!cond(ctx)) {
+        Model* next = next_event();
+
+        if ((next == nullptr) || (next->scheduled() > end)) {
+            if (end > cycle)
+                cycle = end;
+
+            ret = cond(ctx);
+            break;
+        }
+
+        advance((next->scheduled() > cycle) ? (next->scheduled() - cycle) : 0);
+    }
+
+    return ret;
+}
+
+void wait_for_interrupt() noexcept
+{
+    uint64_t taken = nvic_model.handled();
+
+    // WFI also wakes up if the pending interrupt is masked by PRIMASK
+    while ((nvic_model.handled() == taken) && !nvic_model.is_pending()) {
+        Model* next = next_event();
+
+        if (next == nullptr)
+            fault("WFI without any pending event, the CPU would sleep forever");
+
+        advance((next->scheduled() > cycle) ? (next->scheduled() - cycle) : 0);
+    }
+
+    nvic_model.dispatch();
+}
+
+uint32_t set_primask(uint32_t primask) noexcept
+{
+    return nvic_model.set_primask(primask);
+}
+
+uint32_t& fpscr() noexcept
+{
+    return fpscr_reg;
+}
+
+void fault(const char* msg) noexcept
+{
+    std::fprintf(stderr, "sim: fault at cycle %llu: %s\n", static_cast<unsigned long long>(cycle),
+        msg);
+    std::abort();
+}
+
+void print_stats() noexcept
+{
+    Cycles elapsed = cycle - stats.start;
+    // the code itself takes no time, the CPU is only busy with register accesses and the
+    // exception entries and exits
+    Cycles busy = stats.bus_accesses * ACCESS_CYCLES
+        + nvic_model.handled() * (NvicModel::ENTRY_CYCLES + NvicModel::EXIT_CYCLES);
+    static constexpr std::array<const char*, 4> A_NAMES = {"UCA0", "UCA1", "UCA2", "UCA3"};
+    static constexpr std::array<const char*, 4> B_NAMES = {"UCB0", "UCB1", "UCB2", "UCB3"};
+
+    std::printf("elapsed: %llu cycles (%.3f ms), bus accesses: %llu, cpu load: %.2f%%\n",
+        static_cast<unsigned long long>(elapsed),
+        static_cast<double>(elapsed) * 1000.0 / static_cast<double>(clk.mclk),
+        static_cast<unsigned long long>(stats.bus_accesses),
+        (elapsed > 0) ? 100.0 * static_cast<double>(busy) / static_cast<double>(elapsed) : 0.0);
+
+    nvic_model.print_stats();
+    dma_model.print_stats();
+
+    if (gpio_model.detected_edges() > 0) {
+        std::printf("GPIO     edges: %llu\n",
+            static_cast<unsigned long long>(gpio_model.detected_edges()));
+    }
+
+    for (size_t i = 0; i < t32_models.size(); i++) {
+        if (t32_models[i].expirations() > 0) {
+            std::printf("T32_%zu    expirations: %llu\n", i + 1,
+                static_cast<unsigned long long>(t32_models[i].expirations()));
+        }
+    }
+
+    for (size_t i = 0; i < uscia_models.size(); i++)
+        uscia_models[i].print_stats(A_NAMES[i]);
+
+    for (size_t i = 0; i < uscib_models.size(); i++)
+        uscib_models[i].print_stats(B_NAMES[i]);
+}
+
+void reset_stats() noexcept
+{
+    stats = Stats{cycle, 0};
+    nvic_model.reset_stats();
+    dma_model.reset_stats();
+    gpio_model.reset_stats();
+
+    for (Timer32Model& t : t32_models)
+        t.reset_stats();
+
+    for (UsciModel& u : uscia_models)
+        u.reset_stats();
+
+    for (UsciModel& u : uscib_models)
+        u.reset_stats();
+}
+
+Cycles stats_start() noexcept
+{
+    return stats.start;
+}
+
+NvicModel& nvic() noexcept
+{
+    return nvic_model;
+}
+
+DmaModel& dma() noexcept
+{
+    return dma_model;
+}
+
+GpioModel& gpio() noexcept
+{
+    return gpio_model;
+}
+
+Timer32Model& timer32(size_t idx) noexcept
+{
+    return t32_models[idx];
+}
+
+UsciModel& uscia(size_t idx) noexcept
+{
+    return uscia_models[idx];
+}
+
+UsciModel& uscib(size_t idx) noexcept
+{
+    return uscib_models[idx];
+}
+}
@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ *
+ * Register-level simulation of the MSP432 which allows running the peripheral drivers and the
+ * drivers on top of them on a Linux host. The simulation is enabled by building a project with
+ * 'make HOST_SIM=1' (which defines HOST_SIM):
+ * - The register blocks of the peripherals are backed by host memory, which is mapped to the same
+ *   addresses as on the MSP432. Thus, the drivers use their usual base addresses.
+ * - Every register access of ReadWrite/ReadOnly/WriteOnly (see core/register.h) is forwarded to the
+ *   simulated bus, which invokes the behavioral model of the peripheral. Models exist for the USCI
+ *   (UART, SPI master, I2C master), the DMA, the GPIO ports, Timer32, the NVIC and the SysTick. All
+ *   other register blocks behave like plain memory. Accesses to the bit-band alias of the
+ *   peripheral region are translated to the aliased bit.
+ * - The simulated time is counted in MCLK cycles. Every register access takes ACCESS_CYCLES, the
+ *   code in between takes no time at all. WFI advances the time up to the next interrupt.
+ * - Interrupts are dispatched between two register accesses if PRIMASK allows it. They don't
+ *   preempt each other, which equals the NVIC configuration of this codebase (all priorities 0).
+ *
+ * Restrictions:
+ * - Waiting for a flag in RAM which is set by an interrupt doesn't advance the time, use
+ *   cm4f::wait_for_interrupt(), sim::run() or sim::run_until() within such loops.
+ * - The DMA only handles 32-bit addresses, thus buffers used for DMA transfers must be static (the
+ *   executable is linked without PIE and its data is located within the lower 4GiB).
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "irq_nr.h"
+
+namespace sim {
+using Cycles = uint64_t;
+
+constexpr Cycles NEVER = std::numeric_limits<Cycles>::max();
+
+// number of MCLK cycles a single register access takes
+constexpr Cycles ACCESS_CYCLES = 1;
+
+// the clock frequencies which are configured by Msp432::init()
+struct Clocks {
+    uint32_t mclk;
+    uint32_t smclk;
+    uint32_t aclk;
+};
+
+constexpr Clocks DEFAULT_CLOCKS = {48'000'000, 12'000'000, 32'768};
+
+// Base class of the behavioral models. The hooks are invoked for every access to the register
+// block the model is registered for, the value is always stored to (or loaded from) the register
+// memory before invoking them.
+class Model {
+public:
+    Model(const Model&) = delete;
+    Model(const Model&&) = delete;
+    Model& operator=(const Model&) = delete;
+    Model& operator=(const Model&&) = delete;
+    virtual ~Model() noexcept {}
+
+    // sets the register memory to its reset values
+    virtual void reset() noexcept {}
+
+    // invoked after 'val' was written to the register at 'addr'
+    virtual void write(uintptr_t addr, uint32_t val) noexcept {}
+
+    // invoked with the value of the register memory, the returned value is handed to the driver
+    virtual uint32_t read(uintptr_t addr, uint32_t val) noexcept { return val; }
+
+    // invoked once the time scheduled by schedule() is reached
+    virtual void event() noexcept {}
+
+    Cycles scheduled() const noexcept { return at; }
+
+    friend void advance(Cycles cycles) noexcept;
+protected:
+    constexpr explicit Model() noexcept : at(NEVER) {}
+
+    // (re-)schedules the event of the model, a model has at most one pending event
+    void schedule(Cycles time) noexcept;
+    void cancel() noexcept { at = NEVER; }
+
+private:
+    Cycles at;
+};
+
+// direct access to the register memory, bypasses the models
+template<typename T>
+inline volatile T& raw(uintptr_t addr) noexcept
+{
+    return *reinterpret_cast<volatile T*>(addr);
+}
+
+// Accesses of bus masters other than the CPU (the DMA): the models are invoked, but no time
+// elapses. Addresses outside of the register blocks are plain memory accesses.
+void poke(uint32_t addr, uint32_t val, size_t size) noexcept;
+uint32_t peek(uint32_t addr, size_t size) noexcept;
+
+Cycles now() noexcept;
+void advance(Cycles cycles) noexcept;
+const Clocks& clocks() noexcept;
+void set_clocks(const Clocks& clk) noexcept;
+
+// converts ticks of the clock with the given frequency to MCLK cycles (rounded up)
+Cycles to_cycles(uint64_t ticks, uint32_t freq_hz) noexcept;
+
+// Lets the time elapse like an idle CPU, interrupts are handled meanwhile.
+void run(Cycles cycles) noexcept;
+
+// Lets the time elapse until 'cond' returns true or 'timeout' cycles passed. The condition is
+// checked after every handled event, returns false on a timeout.
+bool run_until(bool (*cond)(void* ctx), void* ctx, Cycles timeout) noexcept;
+
+template<typename F>
+bool run_until(F cond, Cycles timeout) noexcept
+{
+    return run_until([](void* ctx) -> bool { return (*static_cast<F*>(ctx))(); }, &cond, timeout);
+}
+
+// prints the statistics of all models to stdout, reset_stats() restarts the measurement
+void print_stats() noexcept;
+void reset_stats() noexcept;
+
+// the cycle at which the current measurement started
+Cycles stats_start() noexcept;
+
+class NvicModel;
+class DmaModel;
+class GpioModel;
+class Timer32Model;
+class UsciModel;
+
+NvicModel& nvic() noexcept;
+DmaModel& dma() noexcept;
+GpioModel& gpio() noexcept;
+Timer32Model& timer32(size_t idx) noexcept;
+UsciModel& uscia(size_t idx) noexcept;
+UsciModel& uscib(size_t idx) noexcept;
+}
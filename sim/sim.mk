@@ -0,0 +1,23 @@
+# SPDX-License-Identifier: MIT
+
+##################################
+# Created by lebakassemmerl 2024 #
+# E-Mail: hotschi@gmx.at         #
+##################################
+
+SIM_DIR = $(ROOT)/sim
+
+INCLUDES += $(SIM_DIR)
+
+SRCS += \
+	$(SIM_DIR)/sim.cpp \
+	$(SIM_DIR)/core_model.cpp \
+	$(SIM_DIR)/dma_model.cpp \
+	$(SIM_DIR)/gpio_model.cpp \
+	$(SIM_DIR)/nvic_model.cpp \
+	$(SIM_DIR)/timer32_model.cpp \
+	$(SIM_DIR)/usci_model.cpp
+
+# the models use the register definitions and the vector table of the MSP432
+PERIPHERALS += \
+	msp432
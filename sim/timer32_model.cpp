@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include "nvic_model.h"
+#include "sim.h"
+#include "timer32_model.h"
+#include "timer32_regs.h"
+
+namespace sim {
+static constexpr uintptr_t LOAD = offsetof(Timer32Registers, load);
+static constexpr uintptr_t VALUE = offsetof(Timer32Registers, value);
+static constexpr uintptr_t CONTROL = offsetof(Timer32Registers, control);
+static constexpr uintptr_t INTCLR = offsetof(Timer32Registers, intclr);
+static constexpr uintptr_t RIS = offsetof(Timer32Registers, ris);
+static constexpr uintptr_t MIS = offsetof(Timer32Registers, mis);
+static constexpr uintptr_t BGLOAD = offsetof(Timer32Registers, bgload);
+
+void Timer32Model::reset() noexcept
+{
+    running = false;
+    cnt_ref = 0;
+    t_ref = 0;
+    cancel();
+
+    raw<uint32_t>(base + LOAD) = 0;
+    raw<uint32_t>(base + VALUE) = 0xFFFFFFFF;
+    raw<uint32_t>(base + CONTROL) = timer32regs::control::ie.mask();
+    raw<uint32_t>(base + RIS) = 0;
+    raw<uint32_t>(base + MIS) = 0;
+    raw<uint32_t>(base + BGLOAD) = 0;
+    update_irq();
+}
+
+void Timer32Model::write(uintptr_t addr, uint32_t val) noexcept
+{
+    switch (addr - base) {
+    case LOAD:
+        // writing LOAD reloads the counter immediately
+        val &= counter_mask();
+        raw<uint32_t>(base + LOAD) = val;
+        raw<uint32_t>(base + BGLOAD) = val;
+        raw<uint32_t>(base + VALUE) = val;
+        if (running)
+            start(val);
+        break;
+    case BGLOAD:
+        // the new value is used with the next reload
+        raw<uint32_t>(base + LOAD) = val & counter_mask();
+        break;
+    case CONTROL: {
+        bool enable = (val & timer32regs::control::enable.mask()) > 0;
+
+        if (enable && !running) {
+            running = true;
+            start(raw<uint32_t>(base + VALUE) & counter_mask());
+        } else if (!enable && running) {
+            raw<uint32_t>(base + VALUE) = value();
+            running = false;
+            cancel();
+        }
+        break;
+    }
+    case INTCLR:
+        raw<uint32_t>(base + RIS) = 0;
+        break;
+    default:
+        break;
+    }
+
+    update_irq();
+}
+
+uint32_t Timer32Model::read(uintptr_t addr, uint32_t val) noexcept
+{
+    if (((addr - base) == VALUE) && running)
+        return value();
+
+    return val;
+}
+
+void Timer32Model::event() noexcept
+{
+    uint32_t control = raw<uint32_t>(base + CONTROL);
+
+    expired++;
+    raw<uint32_t>(base + RIS) = timer32regs::ris::raw_ifg.mask();
+
+    if ((control & timer32regs::control::oneshot.mask()) > 0) {
+        // the counter halts at 0
+        raw<uint32_t>(base + VALUE) = 0;
+        running = false;
+    } else if ((control & timer32regs::control::mode.mask()) > 0) {
+        start(raw<uint32_t>(base + LOAD));
+    } else {
+        // free-running mode wraps around to the maximum value
+        start(counter_mask());
+    }
+
+    update_irq();
+}
+
+uint32_t Timer32Model::divider() const noexcept
+{
+    uint32_t prescale = (raw<uint32_t>(base + CONTROL) & timer32regs::control::prescale.mask())
+        >> 2;
+
+    if (prescale == 1)
+        return 16;
+    else if (prescale == 2)
+        return 256;
+
+    return 1;
+}
+
+uint32_t Timer32Model::counter_mask() const noexcept
+{
+    if ((raw<uint32_t>(base + CONTROL) & timer32regs::control::size.mask()) > 0)
+        return 0xFFFFFFFF;
+
+    return 0xFFFF;
+}
+
+uint32_t Timer32Model::value() const noexcept
+{
+    Cycles ticks = (now() - t_ref) / divider();
+
+    if (ticks >= cnt_ref)
+        return 0;
+
+    return cnt_ref - static_cast<uint32_t>(ticks);
+}
+
+void Timer32Model::start(uint32_t cnt) noexcept
+{
+    cnt_ref = cnt;
+    t_ref = now();
+
+    // a counter value of 0 expires with the next clock
+    schedule(t_ref + static_cast<Cycles>((cnt > 0) ? cnt : 1) * divider());
+}
+
+void Timer32Model::update_irq() noexcept
+{
+    uint32_t mis = 0;
+
+    if ((raw<uint32_t>(base + CONTROL) & timer32regs::control::ie.mask()) > 0)
+        mis = raw<uint32_t>(base + RIS);
+
+    raw<uint32_t>(base + MIS) = mis;
+    nvic().set_line(irq, mis > 0);
+}
+}
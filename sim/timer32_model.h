@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ *
+ * Model of a single Timer32 counter, clocked by MCLK. The counter counts down from the load value
+ * and raises the interrupt when reaching 0, in periodic mode it's reloaded within the same clock
+ * cycle. Thus, an interrupt occurs every LOAD cycles (times the prescaler).
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "irq_nr.h"
+#include "sim.h"
+
+namespace sim {
+class Timer32Model : public Model {
+public:
+    constexpr explicit Timer32Model(uintptr_t base, IrqNr irq) noexcept
+        : Model(), base(base), irq(irq), running(false), cnt_ref(0), t_ref(0), expired(0) {}
+
+    void reset() noexcept override;
+    void write(uintptr_t addr, uint32_t val) noexcept override;
+    uint32_t read(uintptr_t addr, uint32_t val) noexcept override;
+    void event() noexcept override;
+
+    // number of interrupts raised since the last reset of the statistics
+    uint64_t expirations() const noexcept { return expired; }
+    void reset_stats() noexcept { expired = 0; }
+
+    const uintptr_t base;
+
+private:
+    uint32_t divider() const noexcept;
+    uint32_t counter_mask() const noexcept;
+    uint32_t value() const noexcept;
+    void start(uint32_t cnt) noexcept;
+    void update_irq() noexcept;
+
+    const IrqNr irq;
+    bool running;
+    uint32_t cnt_ref; // the value of the counter at t_ref
+    Cycles t_ref;
+    uint64_t expired;
+};
+}
@@ -0,0 +1,611 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+
+#include "dma_model.h"
+#include "err.h"
+#include "nvic_model.h"
+#include "sim.h"
+#include "uscia_regs.h"
+#include "uscib_regs.h"
+#include "usci_model.h"
+
+namespace sim {
+#define USCI_OFFSET(name) offsetof(UsciARegisters, name), offsetof(UsciBRegisters, name)
+
+// the flags which are shared by all modes (RXIFG0 and TXIFG0 in I2C mode)
+static constexpr uint16_t RXIFG = usciaregs::ifg::rxifg.mask();
+static constexpr uint16_t TXIFG = usciaregs::ifg::txifg.mask();
+
+// the DMA triggers of all modes
+static constexpr uint16_t DMA_FLAGS = RXIFG | TXIFG | uscibregs::ifg::rxifg1.mask()
+    | uscibregs::ifg::txifg1.mask() | uscibregs::ifg::rxifg2.mask()
+    | uscibregs::ifg::txifg2.mask() | uscibregs::ifg::rxifg3.mask()
+    | uscibregs::ifg::txifg3.mask();
+
+static constexpr uint16_t UART_ERRORS = usciaregs::statw::rxerr.mask()
+    | usciaregs::statw::oe.mask() | usciaregs::statw::fe.mask() | usciaregs::statw::pe.mask();
+
+// duration of the parts of an I2C transfer in SCL periods
+static constexpr uint32_t I2C_ADDRESS_BITS = 10; // START, 7-bit address, R/W and ACK
+static constexpr uint32_t I2C_ADDRESS10_BITS = 19; // START, two address bytes and two ACKs
+static constexpr uint32_t I2C_BYTE_BITS = 9;
+static constexpr uint32_t I2C_STOP_BITS = 1;
+
+bool I2cRegisterTarget::start(bool read) noexcept
+{
+    first = !read;
+    return true;
+}
+
+bool I2cRegisterTarget::write(uint8_t byte) noexcept
+{
+    if (first) {
+        ptr = byte;
+        first = false;
+    } else {
+        regs[ptr++] = byte;
+    }
+
+    return true;
+}
+
+uint8_t I2cRegisterTarget::read(bool last) noexcept
+{
+    return regs[ptr++];
+}
+
+void UsciModel::reset() noexcept
+{
+    state = State::Idle;
+    swrst = true;
+    tx_pending = false;
+    start_pending = false;
+    count = 0;
+    tx_at = NEVER;
+    rx_at = NEVER;
+    target = nullptr;
+    rx_head = 0;
+    rx_tail = 0;
+    cancel();
+
+    for (uintptr_t off = 0; off < (usci_b ? sizeof(UsciBRegisters) : sizeof(UsciARegisters));
+        off += 2) {
+        put(base + off, 0);
+    }
+
+    put(reg(USCI_OFFSET(ctlw0)), usci_b ? 0x01C1 : 0x0001);
+    put(reg(USCI_OFFSET(ctlw1)), 0x0003);
+    put(reg(USCI_OFFSET(ifg)), TXIFG);
+    last_ifg = TXIFG;
+    reset_stats();
+    update();
+}
+
+void UsciModel::write(uintptr_t addr, uint32_t val) noexcept
+{
+    uintptr_t off = addr - base;
+
+    if (off == reg(USCI_OFFSET(ctlw0)) - base) {
+        bool rst = (val & usciaregs::ctlw0::swrst.mask()) > 0;
+
+        if (rst && !swrst) {
+            swrst = true;
+            state = State::Idle;
+            tx_pending = false;
+            start_pending = false;
+            tx_at = NEVER;
+            target = nullptr;
+        } else if (!rst && swrst) {
+            // the transmit buffer is empty after the reset, except in I2C mode where TXIFG0 is set
+            // by a START condition
+            swrst = false;
+            if (!is_i2c())
+                set_flags(TXIFG);
+        }
+
+        if (!swrst && is_i2c()) {
+            if (((val & uscibregs::ctlw0::txstt.mask()) > 0) && (state != State::Address)) {
+                if ((state == State::Idle) || (state == State::TxWait) || (state == State::Nacked))
+                    i2c_start();
+                else
+                    start_pending = true;
+            } else if ((val & uscibregs::ctlw0::txstp.mask()) > 0) {
+                if ((state == State::TxWait) || (state == State::Nacked))
+                    i2c_stop();
+                else if (state == State::Idle)
+                    put(base, get(base) & ~uscibregs::ctlw0::txstp.mask());
+            }
+        }
+    } else if (off == reg(USCI_OFFSET(txbuf)) - base) {
+        if (!swrst) {
+            clear_flags(TXIFG);
+            tx_pending = true;
+
+            if (is_i2c()) {
+                if (state == State::TxWait)
+                    i2c_next_tx();
+            } else if (state != State::Shift) {
+                load_shifter();
+            }
+        }
+    } else if (off == reg(USCI_OFFSET(ifg)) - base) {
+        // the flags can also be cleared by software
+        if ((state == State::RxStall) && ((get(base + off) & RXIFG) == 0))
+            i2c_rx_done();
+    }
+
+    update();
+    reschedule();
+}
+
+uint32_t UsciModel::read(uintptr_t addr, uint32_t val) noexcept
+{
+    uintptr_t off = addr - base;
+
+    if (off == reg(USCI_OFFSET(rxbuf)) - base) {
+        clear_flags(RXIFG);
+
+        if (!usci_b) {
+            uintptr_t statw = reg(USCI_OFFSET(statw));
+            put(statw, get(statw) & ~UART_ERRORS);
+        }
+
+        // reading RXBUF releases SCL
+        if (state == State::RxStall)
+            i2c_rx_done();
+
+        update();
+        reschedule();
+    }
+
+    return val;
+}
+
+void UsciModel::event() noexcept
+{
+    Cycles t = now();
+
+    if (tx_at <= t) {
+        tx_at = NEVER;
+
+        if (is_i2c())
+            i2c_event();
+        else
+            shift_done();
+    }
+
+    if ((rx_at <= t) && (rx_head != rx_tail)) {
+        rx_at = NEVER;
+        receive(rx_queue[rx_tail]);
+        rx_tail = (rx_tail + 1) % RX_QUEUE_SIZE;
+
+        if (rx_head != rx_tail)
+            rx_at = t + frame_cycles();
+    }
+
+    update();
+    reschedule();
+}
+
+void UsciModel::set_tx_sink(void (*fn)(uint8_t byte, void* ctx) noexcept, void* ctx) noexcept
+{
+    sink = fn;
+    sink_ctx = ctx;
+}
+
+Err UsciModel::inject(std::span<const uint8_t> data) noexcept
+{
+    for (uint8_t byte : data) {
+        size_t next = (rx_head + 1) % RX_QUEUE_SIZE;
+
+        if (next == rx_tail)
+            return Err::NoMem;
+
+        rx_queue[rx_head] = byte;
+        rx_head = next;
+    }
+
+    if ((rx_at == NEVER) && (rx_head != rx_tail)) {
+        rx_at = now() + frame_cycles();
+        reschedule();
+    }
+
+    return Err::Ok;
+}
+
+void UsciModel::set_spi_slave(uint8_t (*fn)(uint8_t mosi, void* ctx) noexcept, void* ctx) noexcept
+{
+    spi_slave = fn;
+    spi_ctx = ctx;
+}
+
+Err UsciModel::attach(uint16_t addr, I2cTarget& target) noexcept
+{
+    for (TargetEntry& entry : targets) {
+        if (entry.target == nullptr) {
+            entry.addr = addr;
+            entry.target = &target;
+            return Err::Ok;
+        }
+    }
+
+    return Err::NoMem;
+}
+
+bool UsciModel::dma_request(bool tx, size_t n) const noexcept
+{
+    uint16_t bit;
+
+    if (swrst)
+        return false;
+
+    if (n == 0)
+        bit = tx ? TXIFG : RXIFG;
+    else
+        bit = static_cast<uint16_t>(1 << (8 + 2 * (n - 1) + (tx ? 1 : 0)));
+
+    return (get(reg(USCI_OFFSET(ifg))) & bit) > 0;
+}
+
+void UsciModel::print_stats(const char* name) const noexcept
+{
+    Cycles elapsed = now() - stats_start();
+    double secs = static_cast<double>(elapsed) / static_cast<double>(clocks().mclk);
+
+    if ((st.tx_bytes == 0) && (st.rx_bytes == 0))
+        return;
+
+    std::printf("%-8s tx: %8llu B  rx: %8llu B  overruns: %llu  busy: %5.1f%%  %8.1f kB/s\n",
+        name, static_cast<unsigned long long>(st.tx_bytes),
+        static_cast<unsigned long long>(st.rx_bytes), static_cast<unsigned long long>(st.overruns),
+        (elapsed > 0) ? 100.0 * static_cast<double>(st.busy) / static_cast<double>(elapsed) : 0.0,
+        (secs > 0.0) ? static_cast<double>(st.tx_bytes + st.rx_bytes) / secs / 1000.0 : 0.0);
+}
+
+void UsciModel::set_flags(uint16_t flags) noexcept
+{
+    uintptr_t ifg = reg(USCI_OFFSET(ifg));
+    put(ifg, get(ifg) | flags);
+    update();
+}
+
+void UsciModel::clear_flags(uint16_t flags) noexcept
+{
+    uintptr_t ifg = reg(USCI_OFFSET(ifg));
+    put(ifg, get(ifg) & ~flags);
+    update();
+}
+
+void UsciModel::update() noexcept
+{
+    uint16_t ifg = get(reg(USCI_OFFSET(ifg)));
+    uint16_t ie = get(reg(USCI_OFFSET(ie)));
+
+    // the DMA triggers on the rising edge of a flag and afterwards as long as it is set
+    if ((ifg & ~last_ifg & DMA_FLAGS) > 0)
+        dma().kick();
+
+    last_ifg = ifg;
+    nvic().set_line(irq, !swrst && ((ifg & ie) > 0));
+}
+
+void UsciModel::reschedule() noexcept
+{
+    Cycles at = (tx_at < rx_at) ? tx_at : rx_at;
+
+    if (at == NEVER)
+        cancel();
+    else
+        schedule(at);
+}
+
+bool UsciModel::is_i2c() const noexcept
+{
+    // an eUSCI_B is always synchronous, the drivers don't necessarily set UCSYNC
+    return usci_b && ((get(base) & uscibregs::ctlw0::mode.mask()) == uscibregs::ctlw0::mode.mask());
+}
+
+bool UsciModel::is_spi() const noexcept
+{
+    if (usci_b)
+        return !is_i2c();
+
+    return (get(base) & usciaregs::ctlw0::sync.mask()) > 0;
+}
+
+uint32_t UsciModel::clock() const noexcept
+{
+    uint16_t ssel = (get(base) & usciaregs::ctlw0::ssel.mask()) >> 6;
+
+    // UCLK isn't available, it's treated like SMCLK
+    return (ssel == 1) ? clocks().aclk : clocks().smclk;
+}
+
+Cycles UsciModel::bit_ticks(uint32_t bits) const noexcept
+{
+    uint64_t brw = get(reg(USCI_OFFSET(brw)));
+    uint64_t ticks = (brw > 0) ? brw : 1;
+
+    if (!usci_b && !is_spi()) {
+        uint16_t mctlw = get(base + offsetof(UsciARegisters, mctlw));
+
+        // with oversampling a bit takes BRW * 16 + BRF clock cycles, the modulation of BRS is
+        // ignored
+        if ((mctlw & usciaregs::mctlw::os16.mask()) > 0)
+            ticks = brw * 16 + ((mctlw & usciaregs::mctlw::brf.mask()) >> 4);
+    }
+
+    return to_cycles(ticks * bits, clock());
+}
+
+Cycles UsciModel::frame_cycles() const noexcept
+{
+    uint16_t ctlw0 = get(base);
+    uint32_t bits = ((ctlw0 & usciaregs::ctlw0::sevenbit.mask()) > 0) ? 7 : 8;
+
+    if (!usci_b && !is_spi()) {
+        // start bit, parity and stop bit(s)
+        bits += 1;
+        bits += ((ctlw0 & usciaregs::ctlw0::pen.mask()) > 0) ? 1 : 0;
+        bits += ((ctlw0 & usciaregs::ctlw0::spb.mask()) > 0) ? 2 : 1;
+    }
+
+    return bit_ticks(bits);
+}
+
+void UsciModel::load_shifter() noexcept
+{
+    Cycles frame = frame_cycles();
+    uintptr_t statw = reg(USCI_OFFSET(statw));
+
+    shift = static_cast<uint8_t>(get(reg(USCI_OFFSET(txbuf))));
+    tx_pending = false;
+    state = State::Shift;
+    tx_at = now() + frame;
+    st.busy += frame;
+
+    put(statw, get(statw) | usciaregs::statw::busy.mask());
+    set_flags(TXIFG);
+}
+
+void UsciModel::shift_done() noexcept
+{
+    bool spi = is_spi();
+
+    st.tx_bytes++;
+    if (spi) {
+        receive(spi_slave ? spi_slave(shift, spi_ctx) : 0xFF);
+    } else {
+        if (sink)
+            sink(shift, sink_ctx);
+
+        if (peer)
+            peer->receive(shift);
+    }
+
+    if (tx_pending) {
+        load_shifter();
+        return;
+    }
+
+    uintptr_t statw = reg(USCI_OFFSET(statw));
+    put(statw, get(statw) & ~usciaregs::statw::busy.mask());
+    state = State::Idle;
+
+    if (!spi)
+        set_flags(usciaregs::ifg::txcptifg.mask());
+}
+
+void UsciModel::receive(uint8_t byte) noexcept
+{
+    if (swrst)
+        return;
+
+    if ((get(reg(USCI_OFFSET(ifg))) & RXIFG) > 0) {
+        uintptr_t statw = reg(USCI_OFFSET(statw));
+
+        st.overruns++;
+        put(statw, get(statw) | usciaregs::statw::oe.mask() | usciaregs::statw::rxerr.mask());
+    }
+
+    st.rx_bytes++;
+    put(reg(USCI_OFFSET(rxbuf)), byte);
+    set_flags(RXIFG);
+}
+
+void UsciModel::i2c_start() noexcept
+{
+    uint16_t ctlw0 = get(base);
+    uint16_t addr = get(base + offsetof(UsciBRegisters, i2csa)) & 0x03FF;
+    bool addr10 = (ctlw0 & uscibregs::ctlw0::sla10.mask()) > 0;
+    uintptr_t statw = base + offsetof(UsciBRegisters, statw);
+
+    start_pending = false;
+    count = 0;
+
+    // a repeated START ends the transfer of the previous target if the address changed
+    target = nullptr;
+    for (const TargetEntry& entry : targets) {
+        if ((entry.target != nullptr) && (entry.addr == addr)) {
+            target = entry.target;
+            break;
+        }
+    }
+
+    // in transmitter mode the first byte can be written while the address is sent
+    if ((ctlw0 & uscibregs::ctlw0::tr.mask()) > 0)
+        set_flags(TXIFG);
+
+    put(statw, get(statw) | uscibregs::statw::bbusy.mask());
+    state = State::Address;
+    i2c_wait(addr10 ? I2C_ADDRESS10_BITS : I2C_ADDRESS_BITS);
+}
+
+void UsciModel::i2c_nack() noexcept
+{
+    put(base, get(base) & ~uscibregs::ctlw0::txstt.mask());
+    clear_flags(TXIFG);
+    set_flags(uscibregs::ifg::nackifg.mask());
+    tx_pending = false;
+
+    // a STOP condition which was already requested is sent right after the NACK
+    if ((get(base) & uscibregs::ctlw0::txstp.mask()) > 0)
+        i2c_stop();
+    else
+        state = State::Nacked;
+}
+
+void UsciModel::i2c_next_tx() noexcept
+{
+    if (start_pending) {
+        i2c_start();
+        return;
+    }
+
+    if ((get(base) & uscibregs::ctlw0::txstp.mask()) > 0) {
+        i2c_stop();
+        return;
+    }
+
+    if (i2c_auto_stop()) {
+        set_flags(uscibregs::ifg::bcntifg.mask());
+        i2c_stop();
+        return;
+    }
+
+    if (!tx_pending) {
+        // SCL is held low until TXBUF is written
+        state = State::TxWait;
+        return;
+    }
+
+    shift = static_cast<uint8_t>(get(base + offsetof(UsciBRegisters, txbuf)));
+    tx_pending = false;
+    count++;
+
+    // no further byte is requested once the byte counter is reached
+    if (!i2c_auto_stop())
+        set_flags(TXIFG);
+
+    state = State::TxShift;
+    i2c_wait(I2C_BYTE_BITS);
+}
+
+void UsciModel::i2c_next_rx() noexcept
+{
+    if (start_pending) {
+        i2c_start();
+        return;
+    }
+
+    state = State::RxShift;
+    i2c_wait(I2C_BYTE_BITS);
+}
+
+void UsciModel::i2c_rx_done() noexcept
+{
+    bool auto_stop;
+    bool last;
+
+    count++;
+    auto_stop = i2c_auto_stop();
+    last = auto_stop || ((get(base) & uscibregs::ctlw0::txstp.mask()) > 0);
+
+    st.rx_bytes++;
+    put(base + offsetof(UsciBRegisters, rxbuf), target ? target->read(last) : 0xFF);
+    set_flags(RXIFG);
+
+    if (last) {
+        if (auto_stop)
+            set_flags(uscibregs::ifg::bcntifg.mask());
+
+        i2c_stop();
+    } else {
+        i2c_next_rx();
+    }
+}
+
+void UsciModel::i2c_stop() noexcept
+{
+    state = State::Stop;
+    i2c_wait(I2C_STOP_BITS);
+}
+
+void UsciModel::i2c_event() noexcept
+{
+    uintptr_t statw = base + offsetof(UsciBRegisters, statw);
+
+    switch (state) {
+    case State::Address: {
+        bool rx = (get(base) & uscibregs::ctlw0::tr.mask()) == 0;
+
+        if ((target == nullptr) || !target->start(rx)) {
+            i2c_nack();
+            break;
+        }
+
+        put(base, get(base) & ~uscibregs::ctlw0::txstt.mask());
+        if (rx)
+            i2c_next_rx();
+        else
+            i2c_next_tx();
+        break;
+    }
+    case State::TxShift:
+        st.tx_bytes++;
+        if (!target->write(shift))
+            i2c_nack();
+        else
+            i2c_next_tx();
+        break;
+    case State::RxShift:
+        // the byte is only completed once the previous one was read
+        if ((get(base + offsetof(UsciBRegisters, ifg)) & RXIFG) > 0)
+            state = State::RxStall;
+        else
+            i2c_rx_done();
+        break;
+    case State::Stop:
+        if (target)
+            target->stop();
+
+        target = nullptr;
+        put(base, get(base) & ~(uscibregs::ctlw0::txstp.mask() | uscibregs::ctlw0::txstt.mask()));
+        put(statw, get(statw) & ~uscibregs::statw::bbusy.mask());
+        state = State::Idle;
+        set_flags(uscibregs::ifg::stpifg.mask());
+
+        if (start_pending)
+            i2c_start();
+        break;
+    default:
+        break;
+    }
+}
+
+void UsciModel::i2c_wait(uint32_t bits) noexcept
+{
+    Cycles cycles = bit_ticks(bits);
+
+    tx_at = now() + cycles;
+    st.busy += cycles;
+}
+
+bool UsciModel::i2c_auto_stop() const noexcept
+{
+    uint16_t astp = (get(base + offsetof(UsciBRegisters, ctlw1)) & uscibregs::ctlw1::astp.mask())
+        >> 2;
+    uint16_t tbcnt = get(base + offsetof(UsciBRegisters, tbcnt));
+
+    return (astp == 2) && (tbcnt > 0) && (count >= tbcnt);
+}
+}
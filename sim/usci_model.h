@@ -0,0 +1,192 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ *
+ * Model of an eUSCI_A (UART, SPI master) or eUSCI_B (SPI master, I2C master) module. The duration
+ * of a frame is derived from the configured clock source and the bit rate, the flags are updated
+ * when the shift register is loaded and when a frame is complete.
+ *
+ * The other side of the bus is provided by the test:
+ * - UART: the transmitted bytes are passed to a sink or to the receiver of another (or the same)
+ *   module, received bytes are injected with inject().
+ * - SPI: a callback returns the byte which is shifted in for every transmitted byte.
+ * - I2C: targets implementing I2cTarget are attached to their addresses, if no target acknowledges
+ *   an address, the transfer ends with a NACK.
+ *
+ * Not modelled: the IV register, the STE pin, multi-master operation and the I2C slave mode.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "err.h"
+#include "irq_nr.h"
+#include "sim.h"
+
+namespace sim {
+class I2cTarget {
+public:
+    virtual ~I2cTarget() noexcept {}
+
+    // the target was addressed by a (repeated) START, returns true to acknowledge
+    virtual bool start(bool read) noexcept = 0;
+
+    // returns true to acknowledge the byte
+    virtual bool write(uint8_t byte) noexcept = 0;
+
+    // 'last' is true if the master doesn't acknowledge this byte
+    virtual uint8_t read(bool last) noexcept = 0;
+
+    virtual void stop() noexcept {}
+};
+
+// I2C target with 256 byte-registers: the first byte of a write selects the register, the following
+// bytes are written to consecutive registers. Reads start at the selected register.
+class I2cRegisterTarget : public I2cTarget {
+public:
+    constexpr explicit I2cRegisterTarget() noexcept : regs(), ptr(0), first(false) {}
+
+    bool start(bool read) noexcept override;
+    bool write(uint8_t byte) noexcept override;
+    uint8_t read(bool last) noexcept override;
+
+    std::array<uint8_t, 256> regs;
+
+private:
+    uint8_t ptr;
+    bool first;
+};
+
+struct UsciStats {
+    uint64_t tx_bytes;
+    uint64_t rx_bytes;
+    uint64_t overruns;
+    Cycles busy; // cycles the shift register was active
+};
+
+class UsciModel : public Model {
+public:
+    constexpr explicit UsciModel(uintptr_t base, IrqNr irq, bool usci_b) noexcept
+        : Model(), base(base), irq(irq), usci_b(usci_b), state(State::Idle), swrst(true),
+        tx_pending(false), start_pending(false), shift(0), count(0), last_ifg(0), tx_at(NEVER),
+        rx_at(NEVER),
+        peer(nullptr), sink(nullptr), sink_ctx(nullptr), spi_slave(nullptr), spi_ctx(nullptr),
+        targets(), target(nullptr), rx_queue(), rx_head(0), rx_tail(0), st() {}
+
+    void reset() noexcept override;
+    void write(uintptr_t addr, uint32_t val) noexcept override;
+    uint32_t read(uintptr_t addr, uint32_t val) noexcept override;
+    void event() noexcept override;
+
+    // UART: the transmitted bytes are received by 'peer' (pass 'this' for a loopback)
+    void connect(UsciModel* peer) noexcept { this->peer = peer; }
+    void set_tx_sink(void (*fn)(uint8_t byte, void* ctx) noexcept, void* ctx) noexcept;
+
+    // UART: the bytes are received back-to-back, starting one frame from now
+    Err inject(std::span<const uint8_t> data) noexcept;
+
+    // SPI: the callback returns the byte which is received for the transmitted one
+    void set_spi_slave(uint8_t (*fn)(uint8_t mosi, void* ctx) noexcept, void* ctx) noexcept;
+
+    // I2C: attaches a target to the (7- or 10-bit) address
+    Err attach(uint16_t addr, I2cTarget& target) noexcept;
+
+    // state of the DMA trigger TXIFGn / RXIFGn
+    bool dma_request(bool tx, size_t n) const noexcept;
+
+    // I2C: the bus is held after a NACK until a STOP or a repeated START is issued
+    bool i2c_held() const noexcept { return state == State::Nacked; }
+
+    const UsciStats& stats() const noexcept { return st; }
+    void print_stats(const char* name) const noexcept;
+    void reset_stats() noexcept { st = UsciStats{}; }
+
+    const uintptr_t base;
+
+private:
+    enum class State : uint8_t {
+        Idle,
+        Shift,      // UART / SPI: a frame is shifted out
+        Address,    // I2C: START and address
+        TxWait,     // I2C: waiting for TXBUF, SCL is held low
+        TxShift,
+        RxShift,
+        RxStall,    // I2C: RXBUF wasn't read yet, SCL is held low
+        Stop,
+        Nacked,     // I2C: waiting for a STOP or a repeated START
+    };
+
+    struct TargetEntry {
+        uint16_t addr;
+        I2cTarget* target;
+    };
+
+    static constexpr size_t MAX_TARGETS = 8;
+    static constexpr size_t RX_QUEUE_SIZE = 4096;
+
+    uintptr_t reg(uintptr_t a_off, uintptr_t b_off) const noexcept
+    {
+        return base + (usci_b ? b_off : a_off);
+    }
+
+    uint16_t get(uintptr_t addr) const noexcept { return raw<uint16_t>(addr); }
+    void put(uintptr_t addr, uint16_t val) noexcept { raw<uint16_t>(addr) = val; }
+    void set_flags(uint16_t flags) noexcept;
+    void clear_flags(uint16_t flags) noexcept;
+    void update() noexcept;
+    void reschedule() noexcept;
+
+    bool is_i2c() const noexcept;
+    bool is_spi() const noexcept;
+    uint32_t clock() const noexcept;
+    Cycles bit_ticks(uint32_t bits) const noexcept;
+    Cycles frame_cycles() const noexcept;
+
+    void load_shifter() noexcept;
+    void shift_done() noexcept;
+    void receive(uint8_t byte) noexcept;
+
+    void i2c_start() noexcept;
+    void i2c_nack() noexcept;
+    void i2c_next_tx() noexcept;
+    void i2c_next_rx() noexcept;
+    void i2c_rx_done() noexcept;
+    void i2c_stop() noexcept;
+    void i2c_event() noexcept;
+    void i2c_wait(uint32_t bits) noexcept;
+    bool i2c_auto_stop() const noexcept;
+
+    const IrqNr irq;
+    const bool usci_b;
+
+    State state;
+    bool swrst;
+    bool tx_pending; // TXBUF contains a byte which wasn't moved to the shift register yet
+    bool start_pending; // a repeated START is issued after the current byte
+    uint8_t shift;
+    uint16_t count; // I2C: bytes since the last START
+    uint16_t last_ifg;
+    Cycles tx_at;
+    Cycles rx_at;
+
+    UsciModel* peer;
+    void (*sink)(uint8_t byte, void* ctx) noexcept;
+    void* sink_ctx;
+    uint8_t (*spi_slave)(uint8_t mosi, void* ctx) noexcept;
+    void* spi_ctx;
+    std::array<TargetEntry, MAX_TARGETS> targets;
+    I2cTarget* target;
+
+    std::array<uint8_t, RX_QUEUE_SIZE> rx_queue;
+    size_t rx_head;
+    size_t rx_tail;
+
+    UsciStats st;
+};
+}
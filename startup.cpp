@@ -9,12 +9,15 @@
  * configuration in order to invoke the main-function.
  */
 
+#include <array>
 #include <cstdint>
 #include <cstddef>
 
 #include "libc.h"
 
 #include "flctl.h"
+#include "irq_nr.h"
+#include "irq_vector.h"
 #include "pcm.h"
 #include "sysctl.h"
 #include "wdt.h"
@@ -37,11 +40,6 @@ extern void (*_dtors_end[])(void);
 // entrance to the application
 extern int main(void); 
 
-// the individual interrupt handlers defined in the peripheral drivers
-extern void systick_handler(void);
-extern void fpu_handler(void);
-extern void periph_int_handler(void);
-
 void __attribute__((weak)) hard_fault(void)
 {
     while (true)
@@ -142,70 +140,9 @@ static VECTOR_TABLE(".arm_vector") void(*ARM_VECTOR[16])(void) = {
     systick_handler,        // SysTick
 };
 
-// vector table for the peripheral interrupts
-static VECTOR_TABLE(".irq_vector") void(*IRQ_VECTOR[64])(void) = {
-    periph_int_handler, // Power Supply System (PSS) (0)
-    periph_int_handler, // Clock System (CS) (1)
-    periph_int_handler, // Power Control Manager (PCM) (2)
-    periph_int_handler, // Watchdog Timer A (WDT_A) (3)
-    fpu_handler,        // FPU_INT, Combined interrupt from flags in FPSCR (4)
-    periph_int_handler, // FLash Controller (FLCTL) (5)
-    periph_int_handler, // Comparator E0 (6)
-    periph_int_handler, // Comparator E1 (7)
-    periph_int_handler, // Timer A0 TA0CCTL0.CCIFG (8)
-    periph_int_handler, // Timer A0 TA0CCTLx.CCIFG (x = 1 to 4), TA0CTL.TAIFG (9)
-    periph_int_handler, // Timer A1 TA1CCTL0.CCIFG (10)
-    periph_int_handler, // Timer A1 TA1CCTLx.CCIFG (x = 1 to 4), TA1CTL.TAIFG (11)
-    periph_int_handler, // Timer A2 TA2CCTL0.CCIFG (12)
-    periph_int_handler, // Timer A2 TA2CCTLx.CCIFG (x = 1 to 4), TA2CTL.TAIFG (13)
-    periph_int_handler, // Timer A3 TA3CCTL0.CCIFG (13)
-    periph_int_handler, // Timer A3 TA3CCTLx.CCIFG (x = 1 to 4), TA3CTL.TAIFG (15)
-    periph_int_handler, // eUSCI A0 (16)
-    periph_int_handler, // eUSCI A1 (17)
-    periph_int_handler, // eUSCI A2 (18)
-    periph_int_handler, // eUSCI A3 (19)
-    periph_int_handler, // eUSCI B0 (20)
-    periph_int_handler, // eUSCI B1 (21)
-    periph_int_handler, // eUSCI B2 (22)
-    periph_int_handler, // eUSCI B3 (23)
-    periph_int_handler, // Precision ADC (24)
-    periph_int_handler, // Timer32 INT1 (25)
-    periph_int_handler, // Timer32 INT2 (26)
-    periph_int_handler, // Timer32 combined interrupt (27)
-    periph_int_handler, // AES256 (28)
-    periph_int_handler, // RTC_C (29)
-    periph_int_handler, // DMA error (30)
-    periph_int_handler, // DMA INT3 (31)
-    periph_int_handler, // DMA INT2 (32)
-    periph_int_handler, // DMA INT1 (33)
-    periph_int_handler, // DMA INT0 (34)
-    periph_int_handler, // IO Port 1 (35)
-    periph_int_handler, // IO Port 2 (36)
-    periph_int_handler, // IO Port 3 (37)
-    periph_int_handler, // IO Port 4 (38)
-    periph_int_handler, // IO Port 5 (39)
-    periph_int_handler, // IO Port 6 (40)
-    periph_int_handler, // Reserved (41)
-    periph_int_handler, // Reserved (42)
-    periph_int_handler, // Reserved (43)
-    periph_int_handler, // Reserved (44)
-    periph_int_handler, // Reserved (45)
-    periph_int_handler, // Reserved (46)
-    periph_int_handler, // Reserved (47)
-    periph_int_handler, // Reserved (48)
-    periph_int_handler, // Reserved (49)
-    periph_int_handler, // Reserved (50)
-    periph_int_handler, // Reserved (51)
-    periph_int_handler, // Reserved (52)
-    periph_int_handler, // Reserved (53)
-    periph_int_handler, // Reserved (54)
-    periph_int_handler, // Reserved (55)
-    periph_int_handler, // Reserved (56)
-    periph_int_handler, // Reserved (57)
-    periph_int_handler, // Reserved (58)
-    periph_int_handler, // Reserved (59)
-    periph_int_handler, // Reserved (60)
-    periph_int_handler, // Reserved (61)
-    periph_int_handler, // Reserved (62)
-    periph_int_handler, // Reserved (63)
-};
+// vector table for the peripheral interrupts, see irq_vector.h
+static VECTOR_TABLE(".irq_vector") const std::array<void(*)(void), IRQ_CNT> IRQ_VECTOR =
+    make_irq_vector(unhandled_interrupt);
+
+static_assert(sizeof(IRQ_VECTOR) == IRQ_CNT * sizeof(void(*)(void)),
+    "the peripheral vector table has an invalid size");
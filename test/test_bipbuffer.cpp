@@ -0,0 +1,212 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <thread>
+
+#include "../core/bip_buffer.h"
+
+// The test is compiled for the host, libc.h only declares the functions of the firmware. Since
+// they have C-linkage, this definition replaces the memcpy of the host for this test.
+namespace libc {
+extern "C" {
+    void* memcpy(void* dst, const void* src, size_t nr_bytes)
+    {
+        volatile uint8_t* d = reinterpret_cast<volatile uint8_t*>(dst);
+        const uint8_t* s = reinterpret_cast<const uint8_t*>(src);
+
+        while (nr_bytes-- > 0)
+            *d++ = *s++;
+
+        return dst;
+    }
+}
+}
+
+constexpr uint64_t MAX_VAL = 20000000;
+constexpr size_t SIZE = 128;
+
+BipBuffer<uint64_t, SIZE> fifo{};
+std::atomic<uint64_t> fails{0};
+
+static void check_contiguous()
+{
+    BipBuffer<uint8_t, 16> bb{};
+    uint8_t data[10] = {0};
+
+    // fill up 10 elements and read them, a reservation of 8 elements doesn't fit behind the data
+    // anymore and has to start at the beginning of the buffer
+    bb.put_range(std::span<const uint8_t>{data, 10});
+    bb.peek_range();
+    bb.drop_range();
+
+    auto res = bb.reserve(8);
+    if (!res.has_value() || (res.value().size() != 8)) {
+        std::cout << "FAIL: reservation of 8 elements not possible" << std::endl;
+        fails++;
+        return;
+    }
+
+    for (size_t i = 0; i < 8; i++)
+        res.value()[i] = static_cast<uint8_t>(i);
+    bb.commit(8);
+
+    auto range = bb.peek_range();
+    if (!range.has_value() || (range.value().size() != 8) || (range.value()[7] != 7)) {
+        std::cout << "FAIL: wrapped data not returned as one contiguous range" << std::endl;
+        fails++;
+    }
+    bb.drop_range();
+
+    // the write-index must never reach the read-index after wrapping around
+    if (bb.reserve(2).has_value() && bb.reserve(9).has_value()) {
+        std::cout << "FAIL: reservation overlaps with unread data" << std::endl;
+        fails++;
+    }
+
+    if (!bb.is_empty()) {
+        std::cout << "FAIL: buffer not empty, used: " << bb.used() << std::endl;
+        fails++;
+    }
+}
+
+// randomly interleaves producer and consumer calls and compares the content with a std::deque
+static void check_random()
+{
+    BipBuffer<uint32_t, 64> bb{};
+    std::deque<uint32_t> model{};
+    std::mt19937 rng{42};
+    uint32_t val = 0;
+
+    for (size_t it = 0; it < 1000000; it++) {
+        if ((rng() & 1) == 0) {
+            size_t len = (rng() % 40) + 1;
+            auto res = bb.reserve(len);
+            if (!res.has_value())
+                continue;
+
+            size_t cnt = rng() % (len + 1);
+            for (size_t j = 0; j < cnt; j++, val++) {
+                res.value()[j] = val;
+                model.push_back(val);
+            }
+            bb.commit(cnt);
+        } else {
+            auto range = bb.peek_range();
+            if (!range.has_value()) {
+                if (!model.empty()) {
+                    std::cout << "FAIL: buffer empty, expected " << model.size() << " elements"
+                        << std::endl;
+                    fails++;
+                    return;
+                }
+                continue;
+            }
+
+            size_t cnt = rng() % (range.value().size() + 1);
+            for (size_t j = 0; j < cnt; j++) {
+                if (model.empty() || (range.value()[j] != model.front())) {
+                    std::cout << "FAIL: wrong element within the random test" << std::endl;
+                    fails++;
+                    return;
+                }
+                model.pop_front();
+            }
+            bb.drop(cnt);
+        }
+
+        if (bb.used() != model.size()) {
+            std::cout << "FAIL: used: " << bb.used() << ", expected: " << model.size() << std::endl;
+            fails++;
+            return;
+        }
+    }
+}
+
+void producer()
+{
+    uint64_t i = 0;
+    size_t len = 1;
+
+    std::cout << "producer thread started" << std::endl;
+    while (i < MAX_VAL) {
+        // use different sizes of reservations and commit only a part of them
+        len = (len % 37) + 1;
+        auto res = fifo.reserve(len);
+        if (!res.has_value()) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        size_t commit = (len > 4) ? len - (i % 3) : len;
+        for (size_t j = 0; j < commit; j++, i++)
+            res.value()[j] = i;
+
+        fifo.commit(commit);
+    }
+
+    std::cout << "producer thread finished" << std::endl;
+}
+
+void consumer()
+{
+    uint64_t compare = 0;
+    std::span<uint64_t> data;
+
+    std::cout << "consumer thread started" << std::endl;
+    while (true) {
+        auto range = fifo.peek_range();
+        if (!range.has_value()) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        data = range.value();
+
+        // drop only a part of the range from time to time
+        size_t cnt = ((compare & 0x07) == 0) ? (data.size() + 1) / 2 : data.size();
+        for (size_t i = 0; i < cnt; i++, compare++) {
+            if (data[i] != compare) {
+                std::cout << "consumer: entry: 0x" << std::hex << data[i] << ", expected: 0x"
+                << compare << ", diff: " << static_cast<int64_t>(data[i] - compare) << std::dec
+                << std::endl;
+                fails++;
+                compare = data[i];
+            }
+        }
+
+        fifo.drop(cnt);
+
+        if (compare >= (MAX_VAL - 1))
+            break;
+    }
+
+    std::cout << "consumer thread finished" << std::endl;
+}
+
+int main(void)
+{
+    std::cout << "Start test of core/bip_buffer.h" << std::endl;
+
+    check_contiguous();
+    check_random();
+
+    std::thread t1{producer};
+    std::thread t2{consumer};
+
+    t1.join();
+    t2.join();
+
+    std::cout << "finished with " << fails << " failure(s)" << std::endl;
+    return fails > 0 ? 1 : 0;
+}
@@ -6,12 +6,15 @@
  */
 
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <cstddef>
 #include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <span>
 #include <thread>
+#include <vector>
 
 #include "../core/fifo.h"
 
@@ -90,6 +93,85 @@ void consumer()
     std::cout << "consumer thread finished" << std::endl;
 }
 
+constexpr uint32_t BENCH_ITEMS = 0x4000000;
+
+Fifo<uint32_t, 256> bench_fifo{};
+std::atomic<uint32_t> bench_fails{0};
+
+// Moves BENCH_ITEMS values through the FIFO, either one by one or in batches of size batch. If the
+// FIFO is full or empty, the thread yields which keeps the benchmark usable on a single core.
+double bench(size_t batch)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread prod{[batch]() {
+        std::vector<uint32_t> vals(batch);
+        uint32_t i = 0;
+
+        while (i < BENCH_ITEMS) {
+            if (batch == 1) {
+                if (bench_fifo.push(i) == Err::Ok)
+                    i++;
+                else
+                    std::this_thread::yield();
+                continue;
+            }
+
+            size_t cnt = std::min<size_t>(batch, BENCH_ITEMS - i);
+            for (size_t j = 0; j < cnt; j++)
+                vals[j] = i + static_cast<uint32_t>(j);
+
+            size_t pushed = 0;
+            while (pushed < cnt) {
+                size_t n = bench_fifo.push_n(std::span<const uint32_t>{&vals[pushed], cnt - pushed});
+                if (n == 0)
+                    std::this_thread::yield();
+                pushed += n;
+            }
+
+            i += static_cast<uint32_t>(cnt);
+        }
+    }};
+
+    std::thread cons{[batch]() {
+        std::vector<uint32_t> vals(batch);
+        uint32_t expected = 0;
+
+        while (expected < BENCH_ITEMS) {
+            if (batch == 1) {
+                auto v = bench_fifo.pop_elem();
+                if (!v.has_value()) {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                if (v.value() != expected)
+                    bench_fails++;
+                expected++;
+                continue;
+            }
+
+            size_t cnt = bench_fifo.pop_n(std::span<uint32_t>{vals});
+            if (cnt == 0)
+                std::this_thread::yield();
+
+            for (size_t j = 0; j < cnt; j++) {
+                if (vals[j] != expected)
+                    bench_fails++;
+                expected++;
+            }
+        }
+    }};
+
+    prod.join();
+    cons.join();
+
+    auto end = std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(end - start).count();
+
+    return static_cast<double>(BENCH_ITEMS) / secs / 1e6;
+}
+
 int main(void)
 {
     std::cout << "Start test of core/fifo.h" << std::endl;
@@ -99,5 +181,23 @@ int main(void)
     t1.join();
     t2.join();
 
+    // all N slots have to be usable
+    Fifo<uint32_t, 4> small{};
+    for (uint32_t i = 0; i < 4; i++) {
+        if (small.push(i) != Err::Ok)
+            std::cout << "FAIL: push " << i << " into a FIFO of size 4" << std::endl;
+    }
+    if (!small.is_full() || (small.push(4) != Err::NoMem))
+        std::cout << "FAIL: FIFO of size 4 not full after 4 elements" << std::endl;
+
+    std::cout << "throughput benchmark:" << std::endl;
+    for (size_t batch : {1, 8, 64}) {
+        double mitems = bench(batch);
+        std::cout << "batch size " << batch << ": " << mitems << " Mitems/s" << std::endl;
+    }
+
+    if (bench_fails > 0)
+        std::cout << "FAIL: " << bench_fails << " wrong values within the benchmark" << std::endl;
+
     return 0;
 }
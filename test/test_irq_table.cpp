@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ *
+ * Checks the interrupt numbers of periph/msp432/irq_nr.h, which define the layout of the peripheral
+ * vector table in startup.cpp, against the interrupts described in the SVD-file.
+ *
+ * Usage: ./test_irq_table [path to msp432p4xx.svd]
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "../periph/msp432/irq_nr.h"
+
+struct IrqEntry {
+    IrqNr nr;
+    const char* svd_name;
+};
+
+constexpr IrqEntry IRQ_ENTRIES[] = {
+    {IrqNr::Pss, "PSS_IRQ"},
+    {IrqNr::Cs, "CS_IRQ"},
+    {IrqNr::Pcm, "PCM_IRQ"},
+    {IrqNr::WdtA, "WDT_A_IRQ"},
+    {IrqNr::Fpu, "FPU_IRQ"},
+    {IrqNr::FlCtl, "FLCTL_IRQ"},
+    {IrqNr::CompE0, "COMP_E0_IRQ"},
+    {IrqNr::CompE1, "COMP_E1_IRQ"},
+    {IrqNr::Ta0_0, "TA0_0_IRQ"},
+    {IrqNr::Ta0_N, "TA0_N_IRQ"},
+    {IrqNr::Ta1_0, "TA1_0_IRQ"},
+    {IrqNr::Ta1_N, "TA1_N_IRQ"},
+    {IrqNr::Ta2_0, "TA2_0_IRQ"},
+    {IrqNr::Ta2_N, "TA2_N_IRQ"},
+    {IrqNr::Ta3_0, "TA3_0_IRQ"},
+    {IrqNr::Ta3_N, "TA3_N_IRQ"},
+    {IrqNr::EusciA0, "EUSCIA0_IRQ"},
+    {IrqNr::EusciA1, "EUSCIA1_IRQ"},
+    {IrqNr::EusciA2, "EUSCIA2_IRQ"},
+    {IrqNr::EusciA3, "EUSCIA3_IRQ"},
+    {IrqNr::EusciB0, "EUSCIB0_IRQ"},
+    {IrqNr::EusciB1, "EUSCIB1_IRQ"},
+    {IrqNr::EusciB2, "EUSCIB2_IRQ"},
+    {IrqNr::EusciB3, "EUSCIB3_IRQ"},
+    {IrqNr::Adc14, "ADC14_IRQ"},
+    {IrqNr::T32Int1, "T32_INT1_IRQ"},
+    {IrqNr::T32Int2, "T32_INT2_IRQ"},
+    {IrqNr::T32IntC, "T32_INTC_IRQ"},
+    {IrqNr::Aes256, "AES256_IRQ"},
+    {IrqNr::RtcC, "RTC_C_IRQ"},
+    {IrqNr::DmaErr, "DMA_ERR_IRQ"},
+    {IrqNr::DmaInt3, "DMA_INT3_IRQ"},
+    {IrqNr::DmaInt2, "DMA_INT2_IRQ"},
+    {IrqNr::DmaInt1, "DMA_INT1_IRQ"},
+    {IrqNr::DmaInt0, "DMA_INT0_IRQ"},
+    {IrqNr::Port1, "PORT1_IRQ"},
+    {IrqNr::Port2, "PORT2_IRQ"},
+    {IrqNr::Port3, "PORT3_IRQ"},
+    {IrqNr::Port4, "PORT4_IRQ"},
+    {IrqNr::Port5, "PORT5_IRQ"},
+    {IrqNr::Port6, "PORT6_IRQ"},
+};
+
+// returns the text between <tag> and </tag> or an empty string if the line doesn't contain the tag
+static std::string tag_content(const std::string& line, const std::string& tag)
+{
+    std::string open = "<" + tag + ">";
+    std::string close = "</" + tag + ">";
+
+    size_t start = line.find(open);
+    size_t end = line.find(close);
+    if ((start == std::string::npos) || (end == std::string::npos))
+        return std::string{};
+
+    start += open.size();
+    return line.substr(start, end - start);
+}
+
+// collects all <interrupt> entries of the SVD-file, interrupts shared by several peripherals are
+// listed multiple times within the file
+static std::map<std::string, unsigned> parse_svd(std::ifstream& svd)
+{
+    std::map<std::string, unsigned> irqs{};
+    std::string line;
+    std::string name;
+    bool in_irq = false;
+
+    while (std::getline(svd, line)) {
+        if (line.find("<interrupt>") != std::string::npos) {
+            in_irq = true;
+            name.clear();
+        } else if (line.find("</interrupt>") != std::string::npos) {
+            in_irq = false;
+        } else if (in_irq) {
+            std::string tmp = tag_content(line, "name");
+            if (!tmp.empty())
+                name = tmp;
+
+            tmp = tag_content(line, "value");
+            if (!tmp.empty() && !name.empty())
+                irqs[name] = static_cast<unsigned>(std::stoul(tmp));
+        }
+    }
+
+    return irqs;
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = (argc > 1) ? argv[1] : "../msp432p4xx.svd";
+    std::map<std::string, unsigned> svd_irqs;
+    std::map<unsigned, const char*> used{};
+    int fails = 0;
+
+    std::cout << "Start test of periph/msp432/irq_nr.h" << std::endl;
+
+    std::ifstream svd{path};
+    if (!svd.is_open()) {
+        std::cout << "FAIL: unable to open " << path << std::endl;
+        return 1;
+    }
+
+    svd_irqs = parse_svd(svd);
+    if (svd_irqs.size() != (sizeof(IRQ_ENTRIES) / sizeof(IRQ_ENTRIES[0]))) {
+        std::cout << "FAIL: SVD describes " << svd_irqs.size() << " interrupts, irq_nr.h "
+            << (sizeof(IRQ_ENTRIES) / sizeof(IRQ_ENTRIES[0])) << std::endl;
+        fails++;
+    }
+
+    for (const IrqEntry& e : IRQ_ENTRIES) {
+        unsigned idx = static_cast<unsigned>(irq_idx(e.nr));
+
+        if (idx >= IRQ_CNT) {
+            std::cout << "FAIL: " << e.svd_name << " (" << idx << ") exceeds the vector table"
+                << std::endl;
+            fails++;
+        }
+
+        auto dup = used.find(idx);
+        if (dup != used.end()) {
+            std::cout << "FAIL: " << e.svd_name << " and " << dup->second << " share slot " << idx
+                << std::endl;
+            fails++;
+        }
+        used[idx] = e.svd_name;
+
+        auto it = svd_irqs.find(e.svd_name);
+        if (it == svd_irqs.end()) {
+            std::cout << "FAIL: " << e.svd_name << " not found in the SVD-file" << std::endl;
+            fails++;
+        } else if (it->second != idx) {
+            std::cout << "FAIL: " << e.svd_name << ": expected: " << it->second << ", got: " << idx
+                << std::endl;
+            fails++;
+        }
+    }
+
+    std::cout << "checked " << used.size() << " interrupts, " << fails << " failure(s)" << std::endl;
+    return fails > 0 ? 1 : 0;
+}
@@ -1,49 +1,220 @@
+// SPDX-License-Identifier: MIT
+
+/*
+ * Created by lebakassemmerl 2024
+ * E-Mail: hotschi@gmx.at
+ *
+ * Correctness and benchmark suite of the memset/memcpy/memmove implementation of core/libc, the
+ * functions are compiled for the host and renamed to not collide with the libc of the host.
+ *
+ * Usage: ./test_libc [--bench]
+ */
+
 #include <array>
+#include <chrono>
 #include <cstdint>
 #include <cstddef>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <vector>
+
+#define memset libc_memset
+#define memcpy libc_memcpy
+#define memmove libc_memmove
+#define strlen libc_strlen
+#define atexit libc_atexit
+#define abort libc_abort
+#define __cxa_pure_virtual libc_cxa_pure_virtual
+
+#include "../core/libc_no_lto.cpp"
+
+#undef memset
+#undef memcpy
+#undef memmove
+#undef strlen
+#undef atexit
+#undef abort
+#undef __cxa_pure_virtual
+
+void hard_fault(void)
+{
+    std::abort();
+}
+
+constexpr size_t MAX_SIZE = 300;
+constexpr size_t MAX_OFFSET = 8;
+constexpr size_t GUARD = 16;
+constexpr size_t BUF_SIZE = GUARD + MAX_OFFSET + MAX_SIZE + MAX_OFFSET + GUARD;
+constexpr uint8_t GUARD_VAL = 0xA5;
 
-constexpr size_t SIZE = 47;
+static int fails = 0;
 
-constexpr auto TEST_ARR = []() {
-    std::array<uint8_t, SIZE> ret{};
-    for (size_t i = 0; i < SIZE; i++) {
-        ret[i] = i;
+static void fill_pattern(uint8_t* buf, size_t len, uint8_t seed)
+{
+    for (size_t i = 0; i < len; i++)
+        buf[i] = static_cast<uint8_t>((i * 7) + seed);
+}
+
+static void check(const uint8_t* got, const uint8_t* expected, size_t len, const char* func,
+    size_t size, size_t dst_off, size_t src_off)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (got[i] != expected[i]) {
+            std::cout << "FAIL: " << func << " size: " << size << ", dst offset: " << dst_off
+                << ", src offset: " << src_off << ", index: " << i << ", expected: "
+                << static_cast<unsigned>(expected[i]) << ", got: " << static_cast<unsigned>(got[i])
+                << std::endl;
+            fails++;
+            return;
+        }
     }
-    return ret;
-}();
+}
+
+static void test_memcpy()
+{
+    alignas(8) std::array<uint8_t, BUF_SIZE> src;
+    alignas(8) std::array<uint8_t, BUF_SIZE> dst;
+    alignas(8) std::array<uint8_t, BUF_SIZE> ref;
+
+    fill_pattern(src.data(), src.size(), 1);
+    for (size_t size = 0; size <= MAX_SIZE; size++) {
+        for (size_t dst_off = 0; dst_off < MAX_OFFSET; dst_off++) {
+            for (size_t src_off = 0; src_off < MAX_OFFSET; src_off++) {
+                uint8_t* d = &dst[GUARD + dst_off];
+                const uint8_t* s = &src[GUARD + src_off];
+
+                dst.fill(GUARD_VAL);
+                ref.fill(GUARD_VAL);
+                std::memcpy(&ref[GUARD + dst_off], s, size);
+
+                if (libc::libc_memcpy(d, s, size) != d) {
+                    std::cout << "FAIL: memcpy returned a wrong pointer" << std::endl;
+                    fails++;
+                }
+
+                check(dst.data(), ref.data(), dst.size(), "memcpy", size, dst_off, src_off);
+            }
+        }
+    }
+}
+
+static void test_memset()
+{
+    alignas(8) std::array<uint8_t, BUF_SIZE> dst;
+    alignas(8) std::array<uint8_t, BUF_SIZE> ref;
+
+    for (size_t size = 0; size <= MAX_SIZE; size++) {
+        for (size_t dst_off = 0; dst_off < MAX_OFFSET; dst_off++) {
+            uint8_t* d = &dst[GUARD + dst_off];
+            uint8_t val = static_cast<uint8_t>(size + dst_off);
 
-static uint8_t dst[SIZE] = {0};
+            dst.fill(GUARD_VAL);
+            ref.fill(GUARD_VAL);
+            std::memset(&ref[GUARD + dst_off], val, size);
 
-void* mymemcpy(void* dst, const void* src, size_t nr_bytes)
+            if (libc::libc_memset(d, val, size) != d) {
+                std::cout << "FAIL: memset returned a wrong pointer" << std::endl;
+                fails++;
+            }
+
+            check(dst.data(), ref.data(), dst.size(), "memset", size, dst_off, 0);
+        }
+    }
+}
+
+static void test_memmove()
 {
-    constexpr int INT_SIZE = sizeof(unsigned);
+    alignas(8) std::array<uint8_t, BUF_SIZE> buf;
+    alignas(8) std::array<uint8_t, BUF_SIZE> ref;
+
+    // overlapping in both directions, the distance between source and destination is given by the
+    // offsets
+    for (size_t size = 0; size <= MAX_SIZE; size++) {
+        for (size_t dst_off = 0; dst_off < MAX_OFFSET; dst_off++) {
+            for (size_t src_off = 0; src_off < MAX_OFFSET; src_off++) {
+                uint8_t* d = &buf[GUARD + dst_off];
+                const uint8_t* s = &buf[GUARD + src_off];
+
+                fill_pattern(buf.data(), buf.size(), 3);
+                fill_pattern(ref.data(), ref.size(), 3);
+                std::memmove(&ref[GUARD + dst_off], &ref[GUARD + src_off], size);
 
-    size_t i;
-    uint8_t* dst_small;
-    const uint8_t* src_small;
+                if (libc::libc_memmove(d, s, size) != d) {
+                    std::cout << "FAIL: memmove returned a wrong pointer" << std::endl;
+                    fails++;
+                }
 
-    for (i = 0; i < (nr_bytes / INT_SIZE); i++)
-        reinterpret_cast<unsigned*>(dst)[i] = reinterpret_cast<const unsigned*>(src)[i];
+                check(buf.data(), ref.data(), buf.size(), "memmove", size, dst_off, src_off);
+            }
+        }
+    }
+}
 
-    dst_small = &reinterpret_cast<uint8_t*>(dst)[INT_SIZE * i];
-    src_small = &reinterpret_cast<const uint8_t*>(src)[INT_SIZE * i];
-    
-    for (i = 0; i < (nr_bytes & (INT_SIZE - 1)); i++)
-        dst_small[i] = src_small[i];
+// reference implementation which copies bytewise
+static void* byte_memcpy(void* dst, const void* src, size_t nr_bytes)
+{
+    volatile uint8_t* d = reinterpret_cast<volatile uint8_t*>(dst);
+    const uint8_t* s = reinterpret_cast<const uint8_t*>(src);
+
+    while (nr_bytes-- > 0)
+        *d++ = *s++;
 
     return dst;
 }
 
-int main()
+template<typename F>
+static double bench(F func, uint8_t* dst, const uint8_t* src, size_t size, size_t iterations)
 {
-    mymemcpy(dst, TEST_ARR.data(), TEST_ARR.size() * sizeof(TEST_ARR[0]));
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        func(dst, src, size);
+        // prevent the compiler from optimizing the copies away
+        __asm__ __volatile__("" ::: "memory");
+    }
+    auto end = std::chrono::steady_clock::now();
 
-    for (size_t i = 0; i < SIZE; i++) {
-        if (dst[i] != TEST_ARR[i]) {
-            std::cout << "FAIL: expected: " << TEST_ARR[i] << ", got: " << dst[i] << std::endl;
+    double secs = std::chrono::duration<double>(end - start).count();
+    return (static_cast<double>(size) * static_cast<double>(iterations)) / secs / 1e6;
+}
+
+static void benchmark()
+{
+    constexpr size_t SIZES[] = {16, 64, 256, 1024, 4096};
+    constexpr size_t TOTAL_BYTES = 256 * 1024 * 1024;
+
+    std::vector<uint8_t> src(4096 + MAX_OFFSET);
+    std::vector<uint8_t> dst(4096 + MAX_OFFSET);
+
+    fill_pattern(src.data(), src.size(), 5);
+
+    std::cout << "size  src-off   bytewise [MB/s]   libc [MB/s]   host [MB/s]" << std::endl;
+    for (size_t size : SIZES) {
+        for (size_t off : {0, 1, 2, 3}) {
+            size_t it = TOTAL_BYTES / size;
+
+            double bytewise = bench(byte_memcpy, dst.data(), &src[off], size, it);
+            double own = bench(libc::libc_memcpy, dst.data(), &src[off], size, it);
+            double host = bench(std::memcpy, dst.data(), &src[off], size, it);
+
+            std::cout << size << "\t" << off << "\t" << bytewise << "\t\t" << own << "\t\t" << host
+                << std::endl;
         }
     }
+}
+
+int main(int argc, char** argv)
+{
+    std::cout << "Start test of core/libc" << std::endl;
+
+    test_memcpy();
+    test_memset();
+    test_memmove();
+
+    std::cout << "finished with " << fails << " failure(s)" << std::endl;
+
+    if ((argc > 1) && (std::strcmp(argv[1], "--bench") == 0))
+        benchmark();
 
-    return 0;
+    return fails > 0 ? 1 : 0;
 }